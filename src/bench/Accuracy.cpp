@@ -0,0 +1,223 @@
+#include "Accuracy.hpp"
+#include "../parser/VirtualMachine.hpp"
+#include "../parser/simd/Kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <type_traits>
+
+namespace bench
+{
+	namespace
+	{
+		using parser::simd::MathFunction;
+		using parser::simd::SimdLevel;
+
+		constexpr std::size_t floatSamples = std::size_t(1) << 24;
+		constexpr std::size_t doubleSamples = std::size_t(1) << 20;
+		constexpr std::size_t chunkSize = 1 << 16;
+
+		struct Domain
+		{
+			MathFunction function;
+			const char* name;
+			double low;
+			double high;
+			double maxUlp; // as in the table of VectorMath.inl
+		};
+
+		// exponents cycled through by the pow samples, negative bases only have integral ones
+		constexpr double powExponents[] = { -3.5, -1.0, 0.5, 2.0, 7.25 };
+
+		template <typename T>
+		long double exactValue(MathFunction function, T a, T b)
+		{
+			using Wide = std::conditional_t<std::is_same_v<T, float>, double, long double>;
+			Wide x = a, y = b;
+
+			switch (function)
+			{
+			case MathFunction::Sin: return std::sin(x);
+			case MathFunction::Cos: return std::cos(x);
+			case MathFunction::Tan: return std::tan(x);
+			case MathFunction::Log:
+			case MathFunction::FastLog: return std::log(x);
+			case MathFunction::Exp:
+			case MathFunction::FastExp: return std::exp(x);
+			case MathFunction::Sqrt: return std::sqrt(x);
+			case MathFunction::Pow:
+			case MathFunction::FastPow: return std::pow(x, y);
+			}
+
+			return x;
+		}
+
+		// distance in units of the last place of T around the exact value
+		template <typename T>
+		double ulpError(T result, long double exact)
+		{
+			int exponent = 0;
+			std::frexp(static_cast<double>(exact), &exponent);
+
+			int digits = std::numeric_limits<T>::digits;
+			int minimum = std::numeric_limits<T>::min_exponent - digits;
+			long double ulp = std::ldexp(1.0L, std::max(exponent - digits, minimum));
+
+			return static_cast<double>(std::fabs(static_cast<long double>(result) - exact) / ulp);
+		}
+
+		// maps floats onto integers so that neighbouring values are one apart
+		template <typename T, typename Bits>
+		long long toOrdered(T value)
+		{
+			Bits bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+
+			constexpr Bits sign = Bits(1) << (sizeof(Bits) * 8 - 1);
+			long long magnitude = static_cast<long long>(bits & ~sign);
+			return (bits & sign) ? -magnitude : magnitude;
+		}
+
+		template <typename T, typename Bits>
+		T fromOrdered(long long ordered)
+		{
+			constexpr Bits sign = Bits(1) << (sizeof(Bits) * 8 - 1);
+			Bits bits = ordered < 0 ? (static_cast<Bits>(-ordered) | sign) : static_cast<Bits>(ordered);
+
+			T value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		template <typename T>
+		void measure(const Domain& domain, const std::vector<T>& xs, const std::vector<T>& ys,
+			const std::vector<SimdLevel>& levels, std::vector<AccuracyResult>& results, std::size_t first)
+		{
+			std::vector<long double> exact(xs.size());
+			std::vector<T> expected(xs.size());
+			for (std::size_t i = 0; i < xs.size(); i++)
+			{
+				exact[i] = exactValue(domain.function, xs[i], ys[i]);
+				expected[i] = static_cast<T>(exact[i]);
+			}
+
+			std::vector<T> out(xs.size());
+			for (std::size_t level = 0; level < levels.size(); level++)
+			{
+				parser::simd::vectorMath(levels[level], domain.function, xs.data(), ys.data(), out.data(), xs.size());
+				AccuracyResult& result = results[first + level];
+
+				for (std::size_t i = 0; i < xs.size(); i++)
+				{
+					result.samples++;
+
+					if (!std::isfinite(expected[i]) || !std::isfinite(out[i]))
+					{
+						bool same = (std::isnan(expected[i]) && std::isnan(out[i])) || expected[i] == out[i];
+						if (!same)
+							result.mismatches++;
+						continue;
+					}
+
+					result.maxUlp = std::max(result.maxUlp, ulpError(out[i], exact[i]));
+				}
+			}
+		}
+
+		// the reference is rounded to Wide itself; where that is no wider than T (long double is double
+		// with msvc) libm's own error of up to an ulp adds to the one measured
+		template <typename T>
+		double referenceError()
+		{
+			using Wide = std::conditional_t<std::is_same_v<T, float>, double, long double>;
+			constexpr int extra = std::numeric_limits<Wide>::digits - std::numeric_limits<T>::digits;
+			return extra > 0 ? std::ldexp(0.5, -extra) : 1.0;
+		}
+
+		template <typename T, typename Bits>
+		void sweep(const char* typeName, const Domain& domain, std::size_t samples, bool random,
+			const std::vector<SimdLevel>& levels, std::vector<AccuracyResult>& results)
+		{
+			std::size_t first = results.size();
+			for (SimdLevel level : levels)
+			{
+				results.push_back({
+					std::string(domain.name) + " " + typeName + " " + parser::simd::levelName(level), 0.0,
+					domain.maxUlp + referenceError<T>(), 0, 0
+				});
+			}
+
+			long long low = toOrdered<T, Bits>(static_cast<T>(domain.low));
+			long long high = toOrdered<T, Bits>(static_cast<T>(domain.high));
+			long long stride = std::max<long long>(1, (high - low) / static_cast<long long>(samples));
+
+			std::mt19937_64 engine(42);
+			std::uniform_int_distribution<long long> distribution(low, high);
+
+			std::vector<T> xs, ys;
+			xs.reserve(chunkSize);
+			ys.reserve(chunkSize);
+
+			std::size_t index = 0;
+			for (long long ordered = low; ordered <= high && index < samples; ordered += stride, index++)
+			{
+				xs.push_back(fromOrdered<T, Bits>(random ? distribution(engine) : ordered));
+				ys.push_back(static_cast<T>(powExponents[index % std::size(powExponents)]));
+
+				if (xs.size() == chunkSize)
+				{
+					measure(domain, xs, ys, levels, results, first);
+					xs.clear();
+					ys.clear();
+				}
+			}
+
+			if (!xs.empty())
+				measure(domain, xs, ys, levels, results, first);
+		}
+	}
+
+	std::vector<AccuracyResult> accuracy()
+	{
+		std::vector<SimdLevel> levels;
+		for (int level = 0; level <= static_cast<int>(parser::simd::detectedLevel()); level++)
+			levels.push_back(static_cast<SimdLevel>(level));
+
+		// a relative error e is at most e * 2^24 ulp in float
+		const double fastUlp = parser::fastMathError * 0x1p24;
+
+		const Domain floatDomains[] = {
+			{ MathFunction::Sin, "sin", -8192.0, 8192.0, 1.5 },
+			{ MathFunction::Cos, "cos", -8192.0, 8192.0, 1.5 },
+			{ MathFunction::Tan, "tan", -8192.0, 8192.0, 2.51 },
+			{ MathFunction::Exp, "exp", -104.0, 89.0, 1.01 },
+			{ MathFunction::Log, "log", 0.0, std::numeric_limits<float>::max(), 0.9 },
+			{ MathFunction::Sqrt, "sqrt", 0.0, std::numeric_limits<float>::max(), 0.5 },
+			{ MathFunction::Pow, "pow", -1000.0, 1000.0, 1.5 },
+			{ MathFunction::FastExp, "fast exp", -104.0, 89.0, fastUlp },
+			{ MathFunction::FastLog, "fast log", 0.0, std::numeric_limits<float>::max(), fastUlp },
+			{ MathFunction::FastPow, "fast pow", -1000.0, 1000.0, fastUlp }
+		};
+
+		const Domain doubleDomains[] = {
+			{ MathFunction::Sin, "sin", -823549.0, 823549.0, 2.01 },
+			{ MathFunction::Cos, "cos", -823549.0, 823549.0, 2.0 },
+			{ MathFunction::Tan, "tan", -823549.0, 823549.0, 2.5 },
+			{ MathFunction::Exp, "exp", -746.0, 710.0, 1.3 },
+			{ MathFunction::Log, "log", 0.0, std::numeric_limits<double>::max(), 0.8 },
+			{ MathFunction::Sqrt, "sqrt", 0.0, std::numeric_limits<double>::max(), 0.5 },
+			{ MathFunction::Pow, "pow", -1000.0, 1000.0, 1.61 }
+		};
+
+		std::vector<AccuracyResult> results;
+		for (const Domain& domain : floatDomains)
+			sweep<float, std::uint32_t>("float", domain, floatSamples, false, levels, results);
+		for (const Domain& domain : doubleDomains)
+			sweep<double, std::uint64_t>("double", domain, doubleSamples, true, levels, results);
+
+		return results;
+	}
+}
\ No newline at end of file
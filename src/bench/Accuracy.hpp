@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	struct AccuracyResult
+	{
+		std::string name;
+		double maxUlp;
+		double bound; // what the table in VectorMath.inl promises, plus the error of the reference
+		std::size_t samples;
+		std::size_t mismatches; // nan/inf results where libm returns something else
+	};
+
+	// max ulp error of the vector math library on every supported simd level,
+	// measured against libm evaluated in the next wider precision. Passes if maxUlp is within
+	// bound and there are no mismatches
+	std::vector<AccuracyResult> accuracy();
+}
\ No newline at end of file
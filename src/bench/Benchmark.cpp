@@ -0,0 +1,275 @@
+#include "Benchmark.hpp"
+#include "../parser/ExpressionParser.hpp"
+#include "../parser/VirtualMachine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace bench
+{
+	namespace
+	{
+		constexpr std::size_t sampleCount = 4096;
+		constexpr double minimumDuration = 0.1; // seconds per strategy
+
+		std::vector<float> makeSamples()
+		{
+			std::vector<float> xs(sampleCount);
+			for (std::size_t i = 0; i < sampleCount; i++)
+				xs[i] = -10.f + 20.f * static_cast<float>(i) / sampleCount;
+
+			return xs;
+		}
+
+		// runs func over all samples until enough time has passed
+		template <typename Func>
+		double measure(const std::vector<float>& xs, Func&& func)
+		{
+			using clock = std::chrono::steady_clock;
+
+			volatile float sink = 0.f;
+			std::size_t evaluated = 0;
+			auto start = clock::now();
+			std::chrono::duration<double> elapsed{};
+
+			do
+			{
+				float sum = 0.f;
+				for (float x : xs)
+					sum += func(x);
+
+				sink = sink + sum;
+				evaluated += xs.size();
+				elapsed = clock::now() - start;
+			} while (elapsed.count() < minimumDuration);
+
+			return elapsed.count() * 1e9 / static_cast<double>(evaluated);
+		}
+
+		// same as measure, but hands all samples to func in one call
+		template <typename T, typename Func>
+		double measureBatch(const std::vector<T>& xs, Func&& func)
+		{
+			using clock = std::chrono::steady_clock;
+
+			std::vector<T> ys(xs.size());
+			std::size_t evaluated = 0;
+			auto start = clock::now();
+			std::chrono::duration<double> elapsed{};
+
+			do
+			{
+				func(xs.data(), ys.data(), xs.size());
+				evaluated += xs.size();
+				elapsed = clock::now() - start;
+			} while (elapsed.count() < minimumDuration);
+
+			return elapsed.count() * 1e9 / static_cast<double>(evaluated);
+		}
+
+		double measureLevel(const std::vector<float>& xs, const parser::Program& program, parser::simd::SimdLevel level)
+		{
+			return measureBatch(xs, [&](const float* in, float* out, std::size_t count) {
+				parser::executeBatch(program, in, out, count, level);
+			});
+		}
+
+		constexpr std::size_t parseInputSize = 1 << 20;
+
+		std::string repeat(const std::string& pattern, std::size_t times)
+		{
+			std::string text;
+			text.reserve(pattern.size() * times);
+			for (std::size_t i = 0; i < times; i++)
+				text += pattern;
+
+			return text;
+		}
+
+		// open repeated until the text is about parseInputSize long, then closed again
+		std::string nested(const std::string& open, const std::string& inner, const std::string& close)
+		{
+			std::size_t depth = parseInputSize / (open.size() + close.size());
+			return repeat(open, depth) + inner + repeat(close, depth);
+		}
+
+		double measureParse(const std::string& text)
+		{
+			using clock = std::chrono::steady_clock;
+
+			std::size_t parsed = 0;
+			auto start = clock::now();
+			std::chrono::duration<double> elapsed{};
+
+			do
+			{
+				parser::Ast ast = parser::parseTree(text);
+				parsed += text.size();
+				elapsed = clock::now() - start;
+			} while (elapsed.count() < minimumDuration);
+
+			return static_cast<double>(parsed) / 1e6 / elapsed.count();
+		}
+
+		// every level up to the one detected on this cpu
+		std::vector<parser::simd::SimdLevel> supportedLevels()
+		{
+			std::vector<parser::simd::SimdLevel> levels;
+			for (int level = 0; level <= static_cast<int>(parser::simd::detectedLevel()); level++)
+				levels.push_back(static_cast<parser::simd::SimdLevel>(level));
+
+			return levels;
+		}
+	}
+
+	std::vector<Result> evaluation(const parser::CompiledExpression& expression)
+	{
+		std::vector<float> xs = makeSamples();
+		const parser::Ast& ast = expression.tree();
+		const parser::Program& program = expression.program();
+
+		std::vector<Result> results = {
+			{ "tree walk", measure(xs, [&](float x) { return parser::evaluateTree(ast, ast.root, x); }) },
+			{ "bytecode vm", measure(xs, [&](float x) { return parser::execute(program, x); }) }
+		};
+
+		for (parser::simd::SimdLevel level : supportedLevels())
+			results.push_back({ std::string("batch ") + parser::simd::levelName(level), measureLevel(xs, program, level) });
+
+		// value and derivative together, per sample of both
+		parser::simd::SimdLevel widest = parser::simd::detectedLevel();
+		std::vector<float> slopes(xs.size());
+		results.push_back({ std::string("dual batch ") + parser::simd::levelName(widest),
+			measureBatch(xs, [&](const float* in, float* out, std::size_t count) {
+				parser::differentiateBatch(program, in, out, slopes.data(), count, widest);
+			}) });
+
+		std::vector<double> wideXs(xs.begin(), xs.end());
+		for (parser::simd::SimdLevel level : supportedLevels())
+		{
+			results.push_back({ std::string("batch double ") + parser::simd::levelName(level),
+				measureBatch(wideXs, [&](const double* in, double* out, std::size_t count) {
+					parser::executeBatch(program, in, out, count, level);
+				}) });
+		}
+
+		// one sample at a time like the wider types below, so the three show what the extra bits cost
+		results.push_back({ "double vm", measure(xs, [&](float x) {
+			return static_cast<float>(parser::execute(program, static_cast<double>(x)));
+		}) });
+
+		std::vector<long double> longXs(xs.begin(), xs.end());
+		results.push_back({ "long double vm", measureBatch(longXs, [&](const long double* in, long double* out, std::size_t count) {
+			parser::executeBatch(program, in, out, count);
+		}) });
+
+		std::vector<parser::DoubleDouble> doubleDoubleXs(xs.begin(), xs.end());
+		results.push_back({ "double-double vm", measureBatch(doubleDoubleXs,
+			[&](const parser::DoubleDouble* in, parser::DoubleDouble* out, std::size_t count) {
+				parser::executeBatch(program, in, out, count);
+			}) });
+
+		if (const parser::jit::NativeFunction* native = expression.nativeCode())
+		{
+			results.push_back({ "native avx", measureBatch(xs, [&](const float* in, float* out, std::size_t count) {
+				native->evaluate(in, out, count);
+			}) });
+		}
+
+		return results;
+	}
+
+	NativeComparison compareNative(const parser::CompiledExpression& expression)
+	{
+		const parser::jit::NativeFunction* native = expression.nativeCode();
+		if (!native)
+			return { false, 0, 0, 0, 0.0 };
+
+		// wider than the benchmark range, odd count so the padded tail block is covered too
+		constexpr std::size_t count = 100003;
+		std::vector<float> xs(count);
+		for (std::size_t i = 0; i < count; i++)
+			xs[i] = -1000.f + 2000.f * static_cast<float>(i) / count;
+
+		std::vector<float> expected(count), actual(count);
+		parser::executeBatch(expression.program(), xs.data(), expected.data(), count, parser::simd::SimdLevel::Avx2);
+		native->evaluate(xs.data(), actual.data(), count);
+
+		NativeComparison comparison{ true, native->codeSize(), count, 0, 0.0 };
+		for (std::size_t i = 0; i < count; i++)
+		{
+			if (std::isnan(expected[i]) && std::isnan(actual[i]))
+				continue;
+
+			if (std::memcmp(&expected[i], &actual[i], sizeof(float)) != 0)
+			{
+				comparison.mismatches++;
+				comparison.maxDifference = std::max(comparison.maxDifference,
+					std::fabs(static_cast<double>(expected[i]) - static_cast<double>(actual[i])));
+			}
+		}
+
+		return comparison;
+	}
+
+	std::vector<NativeCheck> nativeChecks()
+	{
+		// every op the native code translates, stored and reloaded values, selects with both branches taken
+		const char* expressions[] = {
+			"x*x+2*x-1", "-x/3+1/(x+0.5)", "sin(x)*cos(x)-tan(x/7)", "exp(x/300)+log(abs(x)+1)",
+			"sqrt(abs(x))/(1+x^2)", "x^2.5", "min(x,1)-max(-x,2)", "x<0?-x:x^3", "x<=1?sin(x):cos(x)*x",
+			"(x+1)^3-(x+1)^2+sin(x+1)"
+		};
+
+		std::vector<NativeCheck> checks;
+		for (const char* expression : expressions)
+			checks.push_back({ expression, compareNative(*parser::compileExpression(expression)) });
+
+		return checks;
+	}
+
+	std::vector<Result> simdLevels()
+	{
+		const char* builtins[] = { "x*x+2*x-1", "sqrt(x)", "sin(x)", "cos(x)", "tan(x)", "log(x)", "exp(x)", "x^2.5" };
+		std::vector<float> xs = makeSamples();
+		std::vector<Result> results;
+
+		for (const char* expression : builtins)
+		{
+			auto compiled = parser::compileExpression(expression);
+
+			for (parser::simd::SimdLevel level : supportedLevels())
+			{
+				results.push_back({
+					std::string(expression) + " " + parser::simd::levelName(level),
+					measureLevel(xs, compiled->program(), level)
+				});
+			}
+		}
+
+		return results;
+	}
+
+	std::vector<Throughput> parsing()
+	{
+		std::string terms = "sin(x)*1.25+sqrt(x)/3.5-";
+
+		std::pair<const char*, std::string> inputs[] = {
+			{ "wide terms", repeat(terms, parseInputSize / terms.size()) + "x" },
+			{ "wide sum", repeat("x+", parseInputSize / 2) + "x" },
+			{ "power chain", repeat("x^", parseInputSize / 2) + "x" },
+			{ "deep parentheses", nested("(", "x", ")") },
+			{ "deep functions", nested("sin(cos(", "x", "))") },
+			{ "deep signs", repeat("-", parseInputSize) + "x" }
+		};
+
+		std::vector<Throughput> results;
+		for (const auto& [name, text] : inputs)
+			results.push_back({ name, text.size(), measureParse(text) });
+
+		return results;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include "../parser/CompiledExpression.hpp"
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	struct Result
+	{
+		std::string name;
+		double nanosecondsPerSample;
+	};
+
+	struct NativeComparison
+	{
+		bool compiled;
+		std::size_t codeBytes;
+		std::size_t samples;
+		std::size_t mismatches; // samples where native code and the avx2 batch kernel differ in any bit
+		double maxDifference;
+	};
+
+	struct NativeCheck
+	{
+		std::string name; // the expression
+		NativeComparison comparison;
+	};
+
+	struct Throughput
+	{
+		std::string name;
+		std::size_t bytes; // size of the parsed expression
+		double megabytesPerSecond;
+	};
+
+	// times every evaluation strategy on the same set of x values
+	std::vector<Result> evaluation(const parser::CompiledExpression& expression);
+
+	// checks the jitted code of the expression against the interpreter it replaces
+	NativeComparison compareNative(const parser::CompiledExpression& expression);
+
+	// compareNative on a fixed set of expressions; a check passes if it has no mismatches, also
+	// when the expression is not jitted
+	std::vector<NativeCheck> nativeChecks();
+
+	// batch evaluation of the built-in functions on every simd level the cpu supports
+	std::vector<Result> simdLevels();
+
+	// parses generated expressions of about a megabyte each, from long flat sums to deep nesting
+	std::vector<Throughput> parsing();
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "Consistency.hpp"
+#include "../parser/Domain.hpp"
+#include "../parser/ExpressionParser.hpp"
+#include "../parser/Interval.hpp"
+#include <cmath>
+
+namespace bench
+{
+	namespace
+	{
+		constexpr std::size_t checkSamples = 1001;
+
+		struct Case
+		{
+			const char* expression;
+			double lo;
+			double hi;
+		};
+
+		// comparisons on nan are 0, min and max pass their second operand on, a nan condition holds.
+		// The last ones are undefined on part of the range only, or turn nan through inf - inf, sin(inf)
+		// and zeros that come out positive where the bounds end at 0
+		constexpr Case enclosureCases[] = {
+			{ "step(sqrt(x))", -2.0, -1.0 },
+			{ "min(sqrt(-1 - x*x), log(x + 3))", -1.0, 1.0 },
+			{ "max(log(x), 3)", -3.0, -1.0 },
+			{ "min(2, sqrt(x))", -3.0, -1.0 },
+			{ "sqrt(x) < 1 ? 1 : 2", -2.0, -1.0 },
+			{ "x <= log(x)", -2.0, -1.0 },
+			{ "sqrt(x) ? x : -x", -2.0, -1.0 },
+			{ "min(x, 1 - x) + max(sqrt(x), x)", 0.0, 1.0 },
+			{ "max(sqrt(x), 0) + (log(x) < 1)", -5.0, 5.0 },
+			{ "sin(x / (x < -1)) <= 2", -1.0, 3.0 },
+			{ "step(1 / min(0, x - x))", 1.0, 2.0 }
+		};
+
+		// the operand is undefined on [-5, 0), the root is defined everywhere
+		constexpr Case domainCases[] = {
+			{ "max(sqrt(x), 0)", -5.0, 5.0 },
+			{ "sqrt(x) < 1 ? 1 : 2", -5.0, 5.0 },
+			{ "min(log(x), 3)", -5.0, 5.0 },
+			{ "step(sqrt(x))", -5.0, 5.0 }
+		};
+
+		// never negative, the factors of the squares the optimizer expands them to are the same node
+		constexpr Case signCases[] = {
+			{ "x^2", -1.0, 1.0 },
+			{ "x^4 + x^6", -2.0, 1.0 },
+			{ "sin(x)^2", -3.0, 3.0 },
+			{ "x * x", -1.0, 1.0 },
+			{ "x^2 / (1 + x^2)", -1.0, 1.0 },
+			{ "(x - 1)^2 * x^2", -1.0, 2.0 }
+		};
+
+		double sampleAt(const Case& check, std::size_t i)
+		{
+			return check.lo + (check.hi - check.lo) * static_cast<double>(i) / (checkSamples - 1);
+		}
+
+		std::string describe(const Case& check)
+		{
+			return std::string(check.expression) + " on [" + std::to_string(check.lo) + ", " + std::to_string(check.hi) + "]";
+		}
+	}
+
+	std::vector<ConsistencyResult> enclosure()
+	{
+		std::vector<ConsistencyResult> results;
+
+		for (const Case& check : enclosureCases)
+		{
+			auto compiled = parser::compileExpression(check.expression);
+			parser::Interval bounds = compiled->evaluate(parser::Interval(check.lo, check.hi));
+
+			ConsistencyResult result{ describe(check), checkSamples, 0 };
+			for (std::size_t i = 0; i < checkSamples; i++)
+			{
+				double y = compiled->evaluate(sampleAt(check, i));
+
+				if (std::isfinite(y) && !parser::contains(bounds, y))
+					result.failures++;
+			}
+
+			results.push_back(result);
+		}
+
+		return results;
+	}
+
+	std::vector<ConsistencyResult> domains()
+	{
+		std::vector<ConsistencyResult> results;
+
+		for (const Case& check : domainCases)
+		{
+			auto compiled = parser::compileExpression(check.expression);
+			double resolution = (check.hi - check.lo) / static_cast<double>(checkSamples - 1);
+			std::vector<parser::Interval> ranges = parser::definedRanges(compiled->tree(), { check.lo, check.hi }, resolution);
+
+			ConsistencyResult result{ describe(check), checkSamples, 0 };
+			for (std::size_t i = 0; i < checkSamples; i++)
+			{
+				double x = sampleAt(check, i);
+				bool kept = false;
+				for (const parser::Interval& range : ranges)
+					kept = kept || parser::contains(range, x);
+
+				if (std::isfinite(compiled->evaluate(x)) && !kept)
+					result.failures++;
+			}
+
+			results.push_back(result);
+		}
+
+		return results;
+	}
+
+	std::vector<ConsistencyResult> signs()
+	{
+		std::vector<ConsistencyResult> results;
+
+		for (const Case& check : signCases)
+		{
+			auto compiled = parser::compileExpression(check.expression);
+			parser::Interval bounds = compiled->evaluate(parser::Interval(check.lo, check.hi));
+			results.push_back({ describe(check), 1, bounds.lo < 0.0 ? 1u : 0u });
+		}
+
+		return results;
+	}
+}
\ No newline at end of file
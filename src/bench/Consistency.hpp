@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	struct ConsistencyResult
+	{
+		std::string name; // expression and range
+		std::size_t samples;
+		std::size_t failures;
+	};
+
+	// interval bounds over a range of x against the double values at samples across it, on expressions
+	// with operands that are undefined on all or part of the range; every finite value has to lie in the bounds
+	std::vector<ConsistencyResult> enclosure();
+
+	// the defined ranges of expressions that turn an undefined operand into a number against the double
+	// values at samples across the range; every finite value has to lie in one of the ranges
+	std::vector<ConsistencyResult> domains();
+
+	// interval bounds of expressions that are never negative, with a single sample: the whole range.
+	// It fails if the lower bound is below 0
+	std::vector<ConsistencyResult> signs();
+}
\ No newline at end of file
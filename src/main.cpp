@@ -1,22 +1,53 @@
 #include "console/Console.hpp"
 #include "parser/ExpressionParser.hpp"
+#include "parser/VirtualMachine.hpp"
+#include "parser/Optimizer.hpp"
+#include "parser/Compiler.hpp"
+#include "parser/FusedPlan.hpp"
+#include "parser/ExpressionCache.hpp"
+#include "parser/Precision.hpp"
+#include "parser/Parameters.hpp"
+#include "parser/Definitions.hpp"
 #include "utils/math/MathUtil.hpp"
 #include "utils/color/ColorUtils.hpp"
+#include "bench/Benchmark.hpp"
+#include "bench/Accuracy.hpp"
+#include "bench/Consistency.hpp"
 
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <optional>
 #include <thread>
 #include <mutex>
 #include <vector>
 #include <atomic>
 
 struct FunctionEntry {
-    std::function<float(float)> func;
+    std::string source; // compiled again when a function it calls is redefined
+    std::shared_ptr<const parser::CompiledExpression> func;
     sf::Color color;
+    parser::Precision precision;
+    bool proxied; // sampled through a chebyshev proxy
+    std::shared_ptr<const parser::ChebyshevProxy> proxy; // of func, rebuilt by the render thread when it no longer covers the view
 };
 
 std::vector<FunctionEntry> functions;
+parser::FusedPlan plan; // every entry of functions, in the same order
 std::mutex functions_mutex;
 
+// moves a parameter from one value to another over a few seconds, one step per frame
+struct Sweep {
+    std::uint32_t slot;
+    double from;
+    double to;
+    double seconds;
+    std::chrono::steady_clock::time_point start;
+};
+
+std::optional<Sweep> sweep; // guarded by functions_mutex
+
 math::Viewport viewport{ 1200.f, 800.f, 50.f, 0.f, 0.f };
 std::atomic<bool> running = true;
 
@@ -105,11 +136,59 @@ void renderLoop() {
         {
             std::lock_guard<std::mutex> lock(functions_mutex);
 
-            for (auto& f : functions) {
-                auto graph = math::sampleFunction(f.func, viewport, 0.01f);
+            if (sweep) {
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - sweep->start;
+                double t = std::min(elapsed.count() / sweep->seconds, 1.0);
+                parser::setParameter(sweep->slot, sweep->from + (sweep->to - sweep->from) * t);
+
+                if (t >= 1.0)
+                    sweep.reset();
+            }
+
+            // two samples per pixel
+            double step = 0.5 / viewport.scale;
+
+            // all plots share one pass unless they need different precisions
+            parser::Precision required = math::requiredPrecision(viewport);
+            parser::Precision fast = math::fastPrecision(viewport);
+            auto effective = [&](const FunctionEntry& f) {
+                if (f.precision == parser::Precision::Auto) return required;
+                if (f.precision == parser::Precision::Fast) return fast;
+                return f.precision;
+            };
+
+            // proxies evaluate in double, deeper zooms sample the function itself
+            auto usesProxy = [&](const FunctionEntry& f) {
+                parser::Precision p = effective(f);
+                return f.proxied && (p == parser::Precision::Float || p == parser::Precision::Double
+                    || p == parser::Precision::FastFloat);
+            };
+
+            bool uniform = std::all_of(functions.begin(), functions.end(), [&](const FunctionEntry& f) {
+                return !usesProxy(f) && effective(f) == effective(functions.front());
+            });
+
+            std::vector<sf::VertexArray> graphs;
+            if (uniform && !functions.empty())
+                graphs = math::sampleFunctions(plan, viewport, step, effective(functions.front()));
+            else
+                for (auto& f : functions) {
+                    if (!usesProxy(f)) {
+                        graphs.push_back(math::sampleFunction(*f.func, viewport, step, effective(f)));
+                        continue;
+                    }
+
+                    if (!f.proxy || &f.proxy->expression() != f.func.get() || !math::proxyCovers(*f.proxy, viewport))
+                        f.proxy = math::buildProxy(f.func, viewport);
+
+                    graphs.push_back(math::sampleFunction(*f.proxy, viewport, step));
+                }
+
+            for (std::size_t i = 0; i < graphs.size(); ++i) {
+                auto& graph = graphs[i];
 
                 for (std::size_t itr = 0; itr < graph.getVertexCount(); ++itr)
-                    graph[itr].color = f.color;
+                    graph[itr].color = functions[i].color;
 
                 window.draw(graph);
             }
@@ -119,12 +198,59 @@ void renderLoop() {
     }
 }
 
-int main() {
+// the checks of the check and accuracy commands and of jit on a fixed set of expressions, without a window
+// or console: Mathe Visualizer.exe --check, run after every release build. Returns 1 if any of them fails
+int runChecks() {
+    int failed = 0;
+    auto report = [&failed](bool passed, const std::string& name) {
+        failed += passed ? 0 : 1;
+        std::printf("%s %s: ", passed ? "ok  " : "FAIL", name.c_str());
+    };
+
+    for (const auto& result : bench::enclosure()) {
+        report(result.failures == 0, result.name);
+        std::printf("%zu of %zu samples outside the bounds\n", result.failures, result.samples);
+    }
+
+    for (const auto& result : bench::domains()) {
+        report(result.failures == 0, result.name);
+        std::printf("%zu of %zu samples outside the defined ranges\n", result.failures, result.samples);
+    }
+
+    for (const auto& result : bench::signs()) {
+        report(result.failures == 0, result.name);
+        std::printf("%s\n", result.failures == 0 ? "bounds not below 0" : "lower bound below 0");
+    }
+
+    for (const auto& result : bench::accuracy()) {
+        report(result.maxUlp <= result.bound && result.mismatches == 0, result.name);
+        std::printf("%g ulp (at most %g), %zu nan/inf mismatches\n", result.maxUlp, result.bound, result.mismatches);
+    }
+
+    for (const auto& check : bench::nativeChecks()) {
+        report(check.comparison.mismatches == 0, check.name);
+        if (check.comparison.compiled)
+            std::printf("%zu of %zu samples differ from the interpreter\n", check.comparison.mismatches, check.comparison.samples);
+        else
+            std::printf("not jitted\n");
+    }
+
+    std::printf("%d checks failed\n", failed);
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--check")
+        return runChecks();
+
     SetConsoleTitle("Math Visualizer");
     console::open("Math Visualizer v1");
 
     std::thread renderThread(renderLoop);
 
+    parser::Precision precision = parser::Precision::Auto;
+    bool proxied = false;
+
     while (running) {
         std::string cmd = console::input();
 
@@ -136,13 +262,49 @@ int main() {
         if (cmd == "help") {
             console::print(console::Color::Cyan, true, "\nAvailable Commands:");
             console::print(console::Color::White, true,
-                " plot <expression> - Plot a mathematical function (e.g., plot sin(x))");
+                " plot <expression> - Plot a mathematical function (e.g., plot sin(x), plot d/dx sin(x)*x^2, plot d2/dx2 x^3)");
+            console::print(console::Color::White, true,
+                "   piecewise: c ? a : b with <, <=, >, >=, and abs, min, max, step (e.g., plot x < 0 ? -x : x^2, plot max(sin(x), 0))");
+            console::print(console::Color::White, true,
+                "   series: sum(k, a, b, f) and prod(k, a, b, f) over whole k from a to b (e.g., plot sum(k, 1, 50, sin(k*x)/k))");
             console::print(console::Color::White, true,
                 " clear - Remove all plotted functions");
             console::print(console::Color::White, true,
                 " zoom <factor> - Zoom in/out (e.g., zoom 1.5 or zoom 0.5)");
             console::print(console::Color::White, true,
                 " pan <dx> <dy> - Move viewport (e.g., pan 10 5)");
+            console::print(console::Color::White, true,
+                " bench [expression] - Measure evaluation speed (ns per sample), built-in functions if omitted");
+            console::print(console::Color::White, true,
+                " bench parse - Measure parser throughput (MB/s) on large generated expressions");
+            console::print(console::Color::White, true,
+                " dump <expression> - Show the program before and after optimization");
+            console::print(console::Color::White, true,
+                " opt <on|off> - Enable or disable the optimizer for newly plotted functions");
+            console::print(console::Color::White, true,
+                " jit <expression> - Check the native code of an expression against the interpreter");
+            console::print(console::Color::White, true,
+                " accuracy - Measure the max ulp error of the vectorized math functions against libm");
+            console::print(console::Color::White, true,
+                " check - Check interval bounds and defined ranges against point values where operands are undefined, and the bounds of squares");
+            console::print(console::Color::White, true,
+                " exactmath <on|off> - Use libm instead of the vectorized math functions for bit-exact results");
+            console::print(console::Color::White, true,
+                " precision <auto|float|double|long|dd|fast> - Scalar type for newly plotted functions, auto promotes when zoomed in or panned far, dd is double-double for extreme zoom, fast approximates exp, log and pow while the error stays below the fastmath bound");
+            console::print(console::Color::White, true,
+                " proxy <on|off> - Sample newly plotted functions through piecewise Chebyshev polynomials, rebuilt when the view leaves them; makes heavy expressions pan smoothly");
+            console::print(console::Color::White, true,
+                " fastmath <pixels> - Largest error the fast precision may put into a plot before it falls back to auto (default 1)");
+            console::print(console::Color::White, true,
+                " cache [trim] - Show the compiled expression cache, or drop entries no function uses");
+            console::print(console::Color::White, true,
+                " bounds <a> <b> <expression> - Guaranteed range of the expression for x between a and b (e.g., bounds 0 1 1/x)");
+            console::print(console::Color::White, true,
+                " def <name>(<argument>) = <expression> - Define a function, inlined wherever it is called (e.g., def f(u) = u^2 + sin(u), plot f(x) + f(2*x))");
+            console::print(console::Color::White, true,
+                " set <name> <value> - Change a parameter, plots using it update without recompiling (e.g., plot a*sin(k*x), set k 3)");
+            console::print(console::Color::White, true,
+                " sweep <name> <from> <to> <seconds> - Animate a parameter from one value to another");
             console::print(console::Color::White, true,
                 " help - Show this help message");
             console::print(console::Color::White, true,
@@ -153,6 +315,7 @@ int main() {
         if (cmd == "clear") {
             std::lock_guard<std::mutex> lock(functions_mutex);
             functions.clear();
+            plan.clear();
             console::print(console::Color::Yellow, true, "Removed all functions");
             continue;
         }
@@ -175,23 +338,289 @@ int main() {
             continue;
         }
 
+        if (cmd == "bench") {
+            for (const auto& result : bench::simdLevels())
+                console::print(console::Color::White, true,
+                    " ", result.name, ": ", result.nanosecondsPerSample, " ns/sample");
+            continue;
+        }
+
+        if (cmd == "bench parse") {
+            for (const auto& result : bench::parsing())
+                console::print(console::Color::White, true,
+                    " ", result.name, " (", result.bytes / 1024, " KiB): ", result.megabytesPerSecond, " MB/s");
+            continue;
+        }
+
+        if (cmd.rfind("bench", 0) == 0) {
+            try {
+                auto compiled = parser::compileExpression(cmd.substr(6));
+
+                for (const auto& result : bench::evaluation(*compiled))
+                    console::print(console::Color::White, true,
+                        " ", result.name, ": ", result.nanosecondsPerSample, " ns/sample");
+            }
+            catch (const std::exception& e) {
+                console::print(console::Color::Red, true, "Error: ", e.what());
+            }
+
+            continue;
+        }
+
+        if (cmd.rfind("dump", 0) == 0) {
+            try {
+                parser::Ast tree = parser::parseTree(cmd.substr(5));
+                parser::Program before = parser::compile(tree);
+                parser::Program after = parser::compile(parser::optimize(tree));
+
+                console::print(console::Color::Cyan, true, "Before (", before.code.size(), " ops):");
+                console::print(console::Color::White, true, parser::disassemble(before));
+                console::print(console::Color::Cyan, true, "After (", after.code.size(), " ops):");
+                console::print(console::Color::White, true, parser::disassemble(after));
+            }
+            catch (const std::exception& e) {
+                console::print(console::Color::Red, true, "Error: ", e.what());
+            }
+
+            continue;
+        }
+
+        if (cmd == "opt on" || cmd == "opt off") {
+            parser::setOptimize(cmd == "opt on");
+            console::print(console::Color::Cyan, true,
+                parser::optimizeEnabled() ? "Optimizer enabled" : "Optimizer disabled");
+            continue;
+        }
+
+        if (cmd.rfind("jit", 0) == 0) {
+            try {
+                auto compiled = parser::compileExpression(cmd.substr(4));
+                auto comparison = bench::compareNative(*compiled);
+
+                if (!comparison.compiled) {
+                    console::print(console::Color::Yellow, true, "Not jitted, the interpreter is used");
+                    continue;
+                }
+
+                console::print(comparison.mismatches == 0 ? console::Color::Green : console::Color::Red, true,
+                    " ", comparison.codeBytes, " bytes of native code, ", comparison.mismatches, " of ",
+                    comparison.samples, " samples differ (max ", comparison.maxDifference, ")");
+            }
+            catch (const std::exception& e) {
+                console::print(console::Color::Red, true, "Error: ", e.what());
+            }
+
+            continue;
+        }
+
+        if (cmd == "accuracy") {
+            console::print(console::Color::Cyan, true, "Measuring, this takes a while...");
+
+            for (const auto& result : bench::accuracy())
+                console::print(console::Color::White, true,
+                    " ", result.name, ": ", result.maxUlp, " ulp over ", result.samples,
+                    " samples, ", result.mismatches, " nan/inf mismatches");
+            continue;
+        }
+
+        if (cmd == "check") {
+            for (const auto& result : bench::enclosure())
+                console::print(result.failures == 0 ? console::Color::Green : console::Color::Red, true,
+                    " ", result.name, ": ", result.failures, " of ", result.samples, " samples outside the bounds");
+            for (const auto& result : bench::domains())
+                console::print(result.failures == 0 ? console::Color::Green : console::Color::Red, true,
+                    " ", result.name, ": ", result.failures, " of ", result.samples, " samples outside the defined ranges");
+            for (const auto& result : bench::signs())
+                console::print(result.failures == 0 ? console::Color::Green : console::Color::Red, true,
+                    " ", result.name, result.failures == 0 ? ": bounds not below 0" : ": lower bound below 0");
+            continue;
+        }
+
+        if (cmd == "exactmath on" || cmd == "exactmath off") {
+            parser::setExactMath(cmd == "exactmath on");
+            console::print(console::Color::Cyan, true,
+                parser::exactMath() ? "Using libm math functions" : "Using vectorized math functions");
+            continue;
+        }
+
+        if (cmd == "cache" || cmd == "cache trim") {
+            if (cmd == "cache trim")
+                parser::expressionCache().trim();
+
+            auto stats = parser::expressionCache().stats();
+            console::print(console::Color::White, true,
+                " ", stats.entries, " cached (", stats.inUse, " in use), ", stats.hits, " hits, ",
+                stats.misses, " misses, ", stats.evictions, " evicted");
+            continue;
+        }
+
+        if (cmd.rfind("bounds", 0) == 0) {
+            double a = 0.0, b = 0.0;
+            int used = 0;
+            if (sscanf_s(cmd.c_str(), "bounds %lf %lf %n", &a, &b, &used) < 2 || used == 0 || a > b) {
+                console::print(console::Color::Red, true, "Usage: bounds <a> <b> <expression> with a <= b");
+                continue;
+            }
+
+            try {
+                auto compiled = parser::compileExpression(cmd.substr(used));
+                parser::Interval range = compiled->evaluate(parser::Interval(a, b));
+
+                if (parser::isEmpty(range))
+                    console::print(console::Color::Yellow, true, " undefined everywhere on [", a, ", ", b, "]");
+                else
+                    console::print(console::Color::White, true, " [", range.lo, ", ", range.hi, "]");
+            }
+            catch (const std::exception& e) {
+                console::print(console::Color::Red, true, "Error: ", e.what());
+            }
+
+            continue;
+        }
+
+        if (cmd.rfind("def", 0) == 0) {
+            try {
+                std::string name = parser::defineFunction(cmd.substr(3));
+
+                // this thread is the only one changing functions, reading it needs no lock.
+                // The plots calling the function are compiled before the render thread is stopped
+                std::vector<std::pair<std::size_t, std::shared_ptr<const parser::CompiledExpression>>> updated;
+                for (std::size_t i = 0; i < functions.size(); ++i)
+                    if (parser::callsFunction(functions[i].source, name))
+                        updated.push_back({ i, parser::compileExpression(functions[i].source) });
+
+                if (!updated.empty()) {
+                    std::lock_guard<std::mutex> lock(functions_mutex);
+                    for (auto& [index, func] : updated)
+                        functions[index].func = func;
+
+                    std::vector<const parser::CompiledExpression*> expressions;
+                    for (auto& f : functions)
+                        expressions.push_back(f.func.get());
+                    plan.assign(expressions);
+                }
+
+                console::print(console::Color::Green, true,
+                    "Defined ", name, " (", updated.size(), " plots recompiled)");
+            }
+            catch (const std::exception& e) {
+                console::print(console::Color::Red, true, "Error: ", e.what());
+            }
+
+            continue;
+        }
+
+        if (cmd.rfind("set", 0) == 0) {
+            char name[32] = {};
+            double value = 0.0;
+            if (sscanf_s(cmd.c_str(), "set %31s %lf", name, (unsigned)sizeof(name), &value) < 2 || std::string(name) == "x") {
+                console::print(console::Color::Red, true, "Usage: set <name> <value>, the name can not be x");
+                continue;
+            }
+
+            try {
+                std::uint32_t slot = parser::parameterSlot(name);
+
+                std::lock_guard<std::mutex> lock(functions_mutex);
+                if (sweep && sweep->slot == slot)
+                    sweep.reset();
+
+                parser::setParameter(slot, value);
+                console::print(console::Color::Cyan, true, name, " = ", value);
+            }
+            catch (const std::exception& e) {
+                console::print(console::Color::Red, true, "Error: ", e.what());
+            }
+
+            continue;
+        }
+
+        if (cmd.rfind("sweep", 0) == 0) {
+            char name[32] = {};
+            double from = 0.0, to = 0.0, seconds = 0.0;
+            if (sscanf_s(cmd.c_str(), "sweep %31s %lf %lf %lf", name, (unsigned)sizeof(name), &from, &to, &seconds) < 4
+                || std::string(name) == "x" || !(seconds > 0.0)) {
+                console::print(console::Color::Red, true, "Usage: sweep <name> <from> <to> <seconds> with seconds > 0");
+                continue;
+            }
+
+            try {
+                std::uint32_t slot = parser::parameterSlot(name);
+
+                std::lock_guard<std::mutex> lock(functions_mutex);
+                sweep = Sweep{ slot, from, to, seconds, std::chrono::steady_clock::now() };
+                console::print(console::Color::Cyan, true, "Sweeping ", name, " from ", from, " to ", to);
+            }
+            catch (const std::exception& e) {
+                console::print(console::Color::Red, true, "Error: ", e.what());
+            }
+
+            continue;
+        }
+
+        if (cmd.rfind("fastmath", 0) == 0) {
+            double pixels = 0.0;
+            if (sscanf_s(cmd.c_str(), "fastmath %lf", &pixels) < 1 || !(pixels > 0.0)) {
+                console::print(console::Color::Red, true, "Usage: fastmath <pixels>, a positive error bound");
+                continue;
+            }
+
+            math::setFastMathBound(pixels);
+            console::print(console::Color::Cyan, true, "Fast math error bound is ", pixels, " pixels");
+            continue;
+        }
+
+        if (cmd == "proxy on" || cmd == "proxy off") {
+            proxied = cmd == "proxy on";
+            console::print(console::Color::Cyan, true,
+                proxied ? "New plots are sampled through a Chebyshev proxy" : "New plots are sampled directly");
+            continue;
+        }
+
+        if (cmd.rfind("precision", 0) == 0) {
+            std::string name = cmd.size() > 10 ? cmd.substr(10) : "";
+
+            if (name == "auto") precision = parser::Precision::Auto;
+            else if (name == "float") precision = parser::Precision::Float;
+            else if (name == "double") precision = parser::Precision::Double;
+            else if (name == "long") precision = parser::Precision::LongDouble;
+            else if (name == "dd") precision = parser::Precision::DoubleDouble;
+            else if (name == "fast") precision = parser::Precision::Fast;
+            else {
+                console::print(console::Color::Red, true, "Usage: precision <auto|float|double|long|dd|fast>");
+                continue;
+            }
+
+            console::print(console::Color::Cyan, true, "New plots use ", name, " precision");
+            continue;
+        }
+
         if (cmd.rfind("plot", 0) == 0) {
             std::string expr = cmd.substr(5);
 
             try {
-                auto func = parser::parseExpression(expr);
+                auto func = parser::compileExpression(expr);
 
                 std::lock_guard<std::mutex> lock(functions_mutex);
                 functions.push_back({
+                    expr,
                     func,
                     sf::Color(
                         std::rand() % 255,
                         std::rand() % 255,
                         std::rand() % 255
-                    )
+                    ),
+                    precision,
+                    proxied,
+                    nullptr
                     });
 
-                console::print(console::Color::Green, true, "Function added");
+                std::size_t shared = plan.sharedNodes();
+                plan.add(*func);
+
+                console::print(console::Color::Green, true,
+                    "Function added (", func->deduplicatedNodes(), " duplicate nodes merged, ",
+                    plan.sharedNodes() - shared, " shared with other functions)");
             }
             catch (const std::exception& e) {
                 console::print(console::Color::Red, true, "Error: ", e.what());
@@ -0,0 +1,383 @@
+#include "Ast.hpp"
+#include "Parameters.hpp"
+#include "Piecewise.hpp"
+#include "Summation.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace parser
+{
+	NodeId Ast::add(const Node& node)
+	{
+		if ((nodes.size() + 1) * 2 > index.size())
+			rehash(index.empty() ? 16 : index.size() * 2);
+
+		std::size_t mask = index.size() - 1;
+		for (std::size_t slot = NodeHash()(node) & mask;; slot = (slot + 1) & mask)
+		{
+			NodeId entry = index[slot];
+			if (entry == 0)
+			{
+				index[slot] = static_cast<NodeId>(nodes.size() + 1);
+				nodes.push_back(node);
+				return static_cast<NodeId>(nodes.size() - 1);
+			}
+
+			if (NodeEqual()(nodes[entry - 1], node))
+				return entry - 1;
+		}
+	}
+
+	void Ast::reserve(std::size_t count)
+	{
+		nodes.reserve(count);
+
+		std::size_t slots = 16;
+		while (slots < count * 2)
+			slots *= 2;
+
+		if (slots > index.size())
+			rehash(slots);
+	}
+
+	void Ast::rehash(std::size_t slots)
+	{
+		index.assign(slots, 0);
+
+		std::size_t mask = slots - 1;
+		for (NodeId id = 0; id < nodes.size(); id++)
+		{
+			std::size_t slot = NodeHash()(nodes[id]) & mask;
+			while (index[slot] != 0)
+				slot = (slot + 1) & mask;
+
+			index[slot] = id + 1;
+		}
+	}
+
+	int arity(NodeType type)
+	{
+		switch (type)
+		{
+		case NodeType::Constant:
+		case NodeType::Variable:
+		case NodeType::Parameter:
+		case NodeType::Index:
+			return 0;
+		case NodeType::Add:
+		case NodeType::Subtract:
+		case NodeType::Multiply:
+		case NodeType::Divide:
+		case NodeType::Power:
+		case NodeType::Minimum:
+		case NodeType::Maximum:
+		case NodeType::Less:
+		case NodeType::LessEqual:
+			return 2;
+		case NodeType::Select:
+		case NodeType::Sum:
+		case NodeType::Product:
+			return 3;
+		default:
+			return 1;
+		}
+	}
+
+	std::vector<std::uint32_t> freeIndices(const Ast& ast)
+	{
+		std::vector<std::uint32_t> free(ast.size(), 0);
+
+		for (NodeId id = 0; id < ast.size(); id++)
+		{
+			const Node& node = ast[id];
+			int operands = arity(node.type);
+
+			if (node.type == NodeType::Index)
+				free[id] = 1u << static_cast<int>(node.value);
+			if (operands >= 1) free[id] |= free[node.lhs];
+			if (operands >= 2) free[id] |= free[node.rhs];
+
+			// the body's own index is bound, the bounds see the indices around the sum
+			if (node.type == NodeType::Sum || node.type == NodeType::Product)
+				free[id] |= free[node.third] & ~(1u << static_cast<int>(node.value));
+			else if (operands == 3)
+				free[id] |= free[node.third];
+		}
+
+		return free;
+	}
+
+	template <typename T>
+	T applyNode(NodeType type, T lhs, T rhs)
+	{
+		// unqualified so double-double and intervals find their own overloads
+		using std::pow, std::sin, std::cos, std::tan, std::log, std::exp, std::sqrt, std::fabs;
+
+		switch (type)
+		{
+		case NodeType::Negate: return -lhs;
+		case NodeType::Add: return lhs + rhs;
+		case NodeType::Subtract: return lhs - rhs;
+		case NodeType::Multiply: return lhs * rhs;
+		case NodeType::Divide: return lhs / rhs;
+		case NodeType::Power: return pow(lhs, rhs);
+		case NodeType::Sin: return sin(lhs);
+		case NodeType::Cos: return cos(lhs);
+		case NodeType::Tan: return tan(lhs);
+		case NodeType::Log: return log(lhs);
+		case NodeType::Exp: return exp(lhs);
+		case NodeType::Sqrt: return sqrt(lhs);
+		case NodeType::Abs: return fabs(lhs);
+		case NodeType::Minimum: return minimum(lhs, rhs);
+		case NodeType::Maximum: return maximum(lhs, rhs);
+		case NodeType::Less: return less(lhs, rhs);
+		case NodeType::LessEqual: return lessEqual(lhs, rhs);
+		default: return lhs;
+		}
+	}
+
+	Ast compact(const Ast& ast)
+	{
+		std::vector<bool> reachable(ast.size(), false);
+		reachable[ast.root] = true;
+
+		for (NodeId id = static_cast<NodeId>(ast.size()); id-- > 0;)
+		{
+			if (!reachable[id])
+				continue;
+
+			const Node& node = ast[id];
+			int operands = arity(node.type);
+			if (operands >= 1) reachable[node.lhs] = true;
+			if (operands >= 2) reachable[node.rhs] = true;
+			if (operands == 3) reachable[node.third] = true;
+		}
+
+		Ast result;
+		std::vector<NodeId> mapped(ast.size());
+
+		for (NodeId id = 0; id < ast.size(); id++)
+		{
+			if (!reachable[id])
+				continue;
+
+			Node node = ast[id];
+			int operands = arity(node.type);
+			if (operands >= 1) node.lhs = mapped[node.lhs];
+			if (operands >= 2) node.rhs = mapped[node.rhs];
+			if (operands == 3) node.third = mapped[node.third];
+
+			mapped[id] = result.add(node);
+		}
+
+		result.root = mapped[ast.root];
+		return result;
+	}
+
+	std::size_t treeSize(const Ast& ast)
+	{
+		if (ast.size() == 0)
+			return 0;
+
+		// operands come first, so one pass in order sees every operand's size before its users
+		constexpr std::size_t limit = std::numeric_limits<std::size_t>::max() / 2;
+		std::vector<std::size_t> sizes(ast.size());
+
+		for (NodeId id = 0; id < ast.size(); id++)
+		{
+			const Node& node = ast[id];
+			int operands = arity(node.type);
+
+			std::size_t size = 1;
+			if (operands >= 1) size += sizes[node.lhs];
+			if (operands >= 2) size += sizes[node.rhs];
+			if (operands == 3) size += sizes[node.third];
+			sizes[id] = std::min(size, limit);
+		}
+
+		return sizes[ast.root];
+	}
+
+	std::string canonicalForm(const Ast& ast)
+	{
+		if (ast.size() == 0)
+			return {};
+
+		// only what the root reaches counts, operands come first so one pass backwards marks it all
+		std::vector<bool> reached(ast.size());
+		reached[ast.root] = true;
+		for (NodeId id = ast.root + 1; id-- > 0;)
+		{
+			if (!reached[id])
+				continue;
+
+			const Node& node = ast[id];
+			int operands = arity(node.type);
+			if (operands >= 1) reached[node.lhs] = true;
+			if (operands >= 2) reached[node.rhs] = true;
+			if (operands == 3) reached[node.third] = true;
+		}
+
+		// nodes are numbered by height and then by their fields and the numbers of their operands, so the
+		// numbering does not depend on the order the parser added them in. The operands of + and * are
+		// taken smaller number first; min and max return b when either is nan, their order matters
+		std::vector<std::uint32_t> heights(ast.size());
+		std::vector<std::vector<NodeId>> levels;
+
+		for (NodeId id = 0; id < ast.size(); id++)
+		{
+			if (!reached[id])
+				continue;
+
+			const Node& node = ast[id];
+			int operands = arity(node.type);
+
+			std::uint32_t height = 0;
+			if (operands >= 1) height = std::max(height, heights[node.lhs] + 1);
+			if (operands >= 2) height = std::max(height, heights[node.rhs] + 1);
+			if (operands == 3) height = std::max(height, heights[node.third] + 1);
+
+			heights[id] = height;
+			if (levels.size() <= height)
+				levels.resize(height + 1);
+			levels[height].push_back(id);
+		}
+
+		using Key = std::array<std::uint64_t, 5>;
+		std::vector<Key> keys(ast.size());
+		std::vector<std::uint64_t> numbers(ast.size());
+		std::uint64_t next = 0;
+
+		std::string form;
+		form.reserve((ast.size() + 1) * sizeof(Key));
+
+		for (std::vector<NodeId>& level : levels)
+		{
+			for (NodeId id : level)
+			{
+				const Node& node = ast[id];
+				Key& key = keys[id];
+				key = { static_cast<std::uint64_t>(node.type), 0, 0, 0, 0 };
+
+				switch (arity(node.type))
+				{
+				case 0:
+					if (node.type == NodeType::Constant || node.type == NodeType::Index)
+						std::memcpy(&key[1], &node.value, sizeof(node.value));
+					if (node.type == NodeType::Parameter)
+						key[2] = node.lhs;
+					break;
+				case 1:
+					key[2] = numbers[node.lhs];
+					break;
+				case 2:
+					key[2] = numbers[node.lhs];
+					key[3] = numbers[node.rhs];
+					if ((node.type == NodeType::Add || node.type == NodeType::Multiply) && key[3] < key[2])
+						std::swap(key[2], key[3]);
+					break;
+				default:
+					if (node.type != NodeType::Select)
+						std::memcpy(&key[1], &node.value, sizeof(node.value));
+					key[2] = numbers[node.lhs];
+					key[3] = numbers[node.rhs];
+					key[4] = numbers[node.third];
+					break;
+				}
+			}
+
+			std::sort(level.begin(), level.end(), [&keys](NodeId a, NodeId b) { return keys[a] < keys[b]; });
+
+			// nodes that only differ in the order of commutative operands get the same number
+			for (std::size_t i = 0; i < level.size(); i++)
+			{
+				if (i == 0 || keys[level[i]] != keys[level[i - 1]])
+				{
+					form.append(reinterpret_cast<const char*>(keys[level[i]].data()), sizeof(Key));
+					next++;
+				}
+				numbers[level[i]] = next - 1;
+			}
+		}
+
+		form.append(reinterpret_cast<const char*>(&numbers[ast.root]), sizeof(numbers[ast.root]));
+		return form;
+	}
+
+	namespace
+	{
+		// indices holds the current index of every level of sum or product around the node
+		template <typename T>
+		T evaluateNode(const Ast& ast, NodeId id, T x, T* indices)
+		{
+			const Node& node = ast[id];
+
+			switch (node.type)
+			{
+			case NodeType::Constant: return static_cast<T>(node.value);
+			case NodeType::Variable: return x;
+			case NodeType::Parameter: return static_cast<T>(parameterValue(node.lhs));
+			case NodeType::Index: return indices[static_cast<int>(node.value)];
+			default: break;
+			}
+
+			T lhs = evaluateNode(ast, node.lhs, x, indices);
+
+			// only the branch taken is evaluated, both where an interval condition goes either way
+			if (node.type == NodeType::Select)
+			{
+				T a = canBeTrue(lhs) ? evaluateNode(ast, node.rhs, x, indices) : T(0);
+				T b = canBeFalse(lhs) ? evaluateNode(ast, node.third, x, indices) : T(0);
+				return choose(lhs, a, b);
+			}
+
+			T rhs = arity(node.type) >= 2 ? evaluateNode(ast, node.rhs, x, indices) : T(0);
+			if (node.type != NodeType::Sum && node.type != NodeType::Product)
+				return applyNode(node.type, lhs, rhs);
+
+			double first = std::round(loopBound(lhs));
+			double terms = loopTerms(first, loopBound(rhs));
+			bool sum = node.type == NodeType::Sum;
+			if (!(terms >= 1.0))
+				return terms == 0.0 ? T(sum ? 0 : 1) : static_cast<T>(terms);
+
+			T& index = indices[static_cast<int>(node.value)];
+			T total = T(sum ? 0 : 1);
+			T compensation = T(0);
+
+			for (double k = 0.0; k < terms; k++)
+			{
+				index = static_cast<T>(first + k);
+				T term = evaluateNode(ast, node.third, x, indices);
+				if (sum)
+					accumulate(total, compensation, term);
+				else
+					total *= term;
+			}
+
+			return sum ? compensated(total, compensation) : total;
+		}
+	}
+
+	template <typename T>
+	T evaluateTree(const Ast& ast, NodeId id, T x)
+	{
+		T indices[maxLoopLevels];
+		return evaluateNode(ast, id, x, indices);
+	}
+
+	template float applyNode(NodeType type, float lhs, float rhs);
+	template double applyNode(NodeType type, double lhs, double rhs);
+	template long double applyNode(NodeType type, long double lhs, long double rhs);
+	template DoubleDouble applyNode(NodeType type, DoubleDouble lhs, DoubleDouble rhs);
+	template Interval applyNode(NodeType type, Interval lhs, Interval rhs);
+
+	template float evaluateTree(const Ast& ast, NodeId id, float x);
+	template double evaluateTree(const Ast& ast, NodeId id, double x);
+	template long double evaluateTree(const Ast& ast, NodeId id, long double x);
+	template DoubleDouble evaluateTree(const Ast& ast, NodeId id, DoubleDouble x);
+	template Interval evaluateTree(const Ast& ast, NodeId id, Interval x);
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+#include "DoubleDouble.hpp"
+#include "Interval.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace parser
+{
+	enum class NodeType : std::uint8_t
+	{
+		Constant,
+		Variable,
+		Parameter, // named value read when the expression runs, see Parameters.hpp
+		Negate,
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Power,
+		Sin,
+		Cos,
+		Tan,
+		Log,
+		Exp,
+		Sqrt,
+		Abs,
+		Minimum,
+		Maximum,
+		Less, // 1 where lhs < rhs, else 0; a > b is parsed as b < a
+		LessEqual,
+		Select, // lhs ? rhs : third
+		Sum, // of third for the index running from lhs to rhs, see Summation.hpp
+		Product,
+		Index // value of the index of the enclosing sum or product of level value
+	};
+
+	using NodeId = std::uint32_t;
+
+	struct Node
+	{
+		NodeType type;
+		double value; // constants, rounded to the evaluation type when run, and the level of sums, products and indices
+		NodeId lhs; // also the operand of unary nodes and the slot of parameters
+		NodeId rhs;
+		NodeId third = 0; // else branch of selects, body of sums and products, 0 otherwise
+	};
+
+	struct NodeHash
+	{
+		std::size_t operator()(const Node& node) const
+		{
+			std::uint64_t bits;
+			std::memcpy(&bits, &node.value, sizeof(bits));
+
+			std::uint64_t hash = static_cast<std::uint64_t>(node.type) * 0x9e3779b97f4a7c15ull;
+			hash ^= (hash >> 29) + bits + (static_cast<std::uint64_t>(node.lhs) << 32) + node.rhs;
+			hash += static_cast<std::uint64_t>(node.third) * 0x94d049bb133111ebull;
+			hash *= 0xbf58476d1ce4e5b9ull;
+			return static_cast<std::size_t>(hash ^ (hash >> 31));
+		}
+	};
+
+	// structural equality, constants compare by bit pattern so 0 and -0 stay apart
+	struct NodeEqual
+	{
+		bool operator()(const Node& a, const Node& b) const
+		{
+			return a.type == b.type && a.lhs == b.lhs && a.rhs == b.rhs && a.third == b.third
+				&& std::memcmp(&a.value, &b.value, sizeof(a.value)) == 0;
+		}
+	};
+
+	// hash-consed expression dag: adding a node equal to an existing one returns the existing id.
+	// Operands are deduplicated before their parents, so structurally identical subtrees always
+	// end up as a single node. Nodes are stored in creation order, operands before their users.
+	// The index is an open addressing table, so after reserve adding nodes does not allocate
+	class Ast
+	{
+	public:
+		NodeId add(const Node& node);
+
+		// room for count nodes without growing
+		void reserve(std::size_t count);
+
+		const Node& operator[](NodeId id) const { return nodes[id]; }
+		std::size_t size() const { return nodes.size(); }
+
+		NodeId root = 0;
+	private:
+		std::vector<Node> nodes;
+		std::vector<NodeId> index; // id + 1 per slot, 0 for empty; at most half full
+
+		void rehash(std::size_t slots);
+	};
+
+	// number of operands: 0 for constants, x, parameters and indices, 2 for the binary operators and min
+	// and max, 3 for selects, sums and products, 1 otherwise
+	int arity(NodeType type);
+
+	// levels of the indices each node depends on that no sum or product inside it binds, bit d for level d.
+	// 0 for nodes that are the same for every term of the sums around them
+	std::vector<std::uint32_t> freeIndices(const Ast& ast);
+
+	// applies an operator or function to already evaluated operands, rhs is ignored by unary ones;
+	// selects go through choose in Piecewise.hpp, sums and products through evaluateTree. Instantiated
+	// for float, double, long double, DoubleDouble and Interval
+	template <typename T>
+	T applyNode(NodeType type, T lhs, T rhs);
+
+	// copies the nodes reachable from the root, keeping their relative order
+	Ast compact(const Ast& ast);
+
+	// number of nodes the expression would have as a plain tree, shared nodes counted once per use
+	std::size_t treeSize(const Ast& ast);
+
+	// serialized dag, equal for expressions that parse to the same tree however they are spelled
+	// (whitespace, parentheses, unary plus, 1.0 vs 1) and whichever way round the operands of + and * are
+	std::string canonicalForm(const Ast& ast);
+
+	// reference tree-walking interpreter, kept for benchmarking against the vm
+	template <typename T>
+	T evaluateTree(const Ast& ast, NodeId id, T x);
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace parser
+{
+	// postfix instruction set of the expression vm
+	enum class OpCode : std::uint8_t
+	{
+		Constant, // pushes the next entry of the constant pool
+		Variable,
+		Negate,
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Power,
+		Sin,
+		Cos,
+		Tan,
+		Log,
+		Exp,
+		Sqrt,
+		Abs,
+		Minimum,
+		Maximum,
+		Less, // 1 or 0
+		LessEqual,
+		Select, // pops else value, then value and condition, pushes one of the values per sample
+		Then, // after a select's condition; may skip the then branch, see Jump
+		Else, // after its then branch; may skip the else branch
+		Store, // copies the top of the stack into the next slot of the slot list, leaving it on the stack
+		Load, // pushes the value of the next slot of the slot list
+		Parameter, // pushes the current value of the parameter the next entry of the slot list names
+		Pop, // drops the top of the stack, after the Store of a value only a loop after it loads
+		SumBegin, // pops the last and the first index, starts a loop; see Loops
+		ProductBegin,
+		SumEnd, // pops the term, runs the body again for the next index or pushes the result
+		ProductEnd
+	};
+
+	// loops of sums and products. Begin and End both take the next entry of the slot list, the first of four
+	// slots holding the index, the number of terms left, the sum or product so far and the compensation of
+	// the sum; the body reads the index with a Load of the first. Each takes the next jump as well: Begin's
+	// leads past End and is taken if the range is empty, with 0 (1 for products) pushed as the result.
+	// End's leads back to the start of the body and is taken while terms are left. The bounds are the same
+	// for every sample, so all of them run the same number of terms
+
+	// where a Then or Else op continues when no sample takes its branch: the branch's code is skipped
+	// and a placeholder value pushed in its place, the select ignores it. The cursors of the constant,
+	// slot and jump lists are set to where the skipped code would have left them. Branches storing a
+	// slot that is loaded after them are never skipped, pc is 0 for those
+	struct Jump
+	{
+		std::uint32_t pc;
+		std::uint32_t constant;
+		std::uint32_t slot;
+		std::uint32_t jump;
+	};
+
+	struct Program
+	{
+		std::vector<OpCode> code;
+		std::vector<double> constants; // consumed in the order the Constant ops appear, rounded to the evaluation type
+		std::vector<std::uint32_t> slots; // consumed in the order the Store, Load, Parameter and loop ops appear
+		std::vector<Jump> jumps; // consumed in the order the Then, Else and loop ops appear
+		std::size_t maxStack = 0;
+		std::size_t slotCount = 0; // values of shared dag nodes, stored once and loaded by later users
+		std::size_t outputs = 1; // values left on the stack at the end, output k is stack entry k
+	};
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "ChebyshevProxy.hpp"
+#include "Domain.hpp"
+#include "Parameters.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace parser
+{
+	namespace
+	{
+		constexpr double pi = 3.14159265358979323846;
+
+		// the rounding noise of values this many ulp large is accepted even if it exceeds the tolerance,
+		// large values could never meet a tolerance meant for the ones on screen otherwise
+		constexpr double noiseUlps = 64.0;
+	}
+
+	ChebyshevProxy::ChebyshevProxy(std::shared_ptr<const CompiledExpression> expression, Interval range, double tolerance)
+		: source(std::move(expression)), bounds(range), error(tolerance)
+	{
+		const Ast& tree = source->tree();
+		for (NodeId id = 0; id < tree.size(); id++)
+		{
+			if (tree[id].type == NodeType::Parameter)
+				parameters.push_back({ tree[id].lhs, parameterValue(tree[id].lhs) });
+		}
+
+		// cos(pi k (j + 1/2) / n), row k is the k-th chebyshev polynomial at the nodes
+		constexpr std::size_t n = chebyshevNodes;
+		std::vector<double> cosines(n * n);
+		for (std::size_t k = 0; k < n; k++)
+			for (std::size_t j = 0; j < n; j++)
+				cosines[k * n + j] = std::cos(pi * static_cast<double>(k) * (static_cast<double>(j) + 0.5) / n);
+
+		double resolution = std::ldexp(range.hi - range.lo, -maxProxyDepth);
+		defined = definedRanges(tree, range, resolution);
+
+		double done = range.lo;
+		for (const Interval& part : defined)
+		{
+			if (part.lo > done)
+				addPiece(done, part.lo, PieceKind::Undefined);
+
+			approximate(part.lo, part.hi, 0, cosines);
+			done = part.hi;
+		}
+
+		if (done < range.hi || pieces.empty())
+			addPiece(done, range.hi, PieceKind::Undefined);
+	}
+
+	void ChebyshevProxy::approximate(double lo, double hi, int depth, const std::vector<double>& cosines)
+	{
+		constexpr std::size_t n = chebyshevNodes;
+		double middle = 0.5 * (lo + hi);
+		double radius = 0.5 * (hi - lo);
+
+		// the nodes, then the extrema of the last polynomial between them where the error is checked
+		std::vector<double> xs(2 * n - 1);
+		for (std::size_t j = 0; j < n; j++)
+			xs[j] = middle + radius * cosines[n + j];
+		for (std::size_t j = 0; j + 1 < n; j++)
+			xs[n + j] = middle + radius * std::cos(pi * static_cast<double>(j + 1) / n);
+
+		std::vector<double> ys(xs.size());
+		source->evaluate(xs.data(), ys.data(), xs.size());
+
+		bool finite = std::all_of(ys.begin(), ys.end(), [](double y) { return std::isfinite(y); });
+		bool splittable = depth < maxProxyDepth && pieces.size() + 2 <= maxProxyPieces;
+
+		if (finite)
+		{
+			Piece piece{ lo, hi, static_cast<std::uint32_t>(coefficients.size()), static_cast<std::uint32_t>(n), PieceKind::Polynomial };
+			for (std::size_t k = 0; k < n; k++)
+			{
+				double sum = 0.0;
+				for (std::size_t j = 0; j < n; j++)
+					sum += ys[j] * cosines[k * n + j];
+
+				coefficients.push_back(sum * (k == 0 ? 1.0 : 2.0) / n);
+			}
+
+			double worst = 0.0;
+			double magnitude = 0.0;
+			for (std::size_t j = n; j < xs.size(); j++)
+				worst = std::max(worst, std::fabs(interpolate(piece, xs[j]) - ys[j]));
+			for (double y : ys)
+				magnitude = std::max(magnitude, std::fabs(y));
+
+			// half the tolerance for the interpolant, the other half for the terms dropped from its end
+			double allowed = 0.5 * std::max(error, magnitude * noiseUlps * std::numeric_limits<double>::epsilon());
+			if (worst <= allowed)
+			{
+				double dropped = 0.0;
+				while (piece.terms > 1 && dropped + std::fabs(coefficients[piece.first + piece.terms - 1]) <= allowed)
+					dropped += std::fabs(coefficients[piece.first + --piece.terms]);
+
+				coefficients.resize(piece.first + piece.terms);
+				pieces.push_back(piece);
+				return;
+			}
+
+			coefficients.resize(piece.first);
+		}
+
+		if (!splittable)
+		{
+			addPiece(lo, hi, PieceKind::Exact);
+			return;
+		}
+
+		approximate(lo, middle, depth + 1, cosines);
+		approximate(middle, hi, depth + 1, cosines);
+	}
+
+	void ChebyshevProxy::addPiece(double lo, double hi, PieceKind kind)
+	{
+		pieces.push_back({ lo, hi, 0, 0, kind });
+		if (kind == PieceKind::Exact)
+			exactCount++;
+	}
+
+	// clenshaw recurrence on x mapped to [-1, 1]
+	double ChebyshevProxy::interpolate(const Piece& piece, double x) const
+	{
+		const double* c = coefficients.data() + piece.first;
+		double t = (2.0 * x - piece.lo - piece.hi) / (piece.hi - piece.lo);
+
+		double next = 0.0, after = 0.0;
+		for (std::uint32_t k = piece.terms; k-- > 1;)
+		{
+			double current = 2.0 * t * next - after + c[k];
+			after = next;
+			next = current;
+		}
+
+		return t * next - after + c[0];
+	}
+
+	std::size_t ChebyshevProxy::locate(double x) const
+	{
+		auto after = std::upper_bound(pieces.begin(), pieces.end(), x, [](double value, const Piece& piece) {
+			return value < piece.lo;
+		});
+
+		return after == pieces.begin() ? 0 : static_cast<std::size_t>(after - pieces.begin()) - 1;
+	}
+
+	// clenshaw on a run of samples in the same piece, one step of the recurrence for all of them at a
+	// time so the samples fill the vector lanes instead of waiting on each other
+	template <typename T>
+	void ChebyshevProxy::interpolateRun(const Piece& piece, const T* xs, T* ys, std::size_t count) const
+	{
+		double t[batchBlockSize];
+		double next[batchBlockSize] = {};
+		double after[batchBlockSize] = {};
+
+		const double* c = coefficients.data() + piece.first;
+		double center = piece.lo + piece.hi;
+		double inverse = 1.0 / (piece.hi - piece.lo);
+
+		for (std::size_t i = 0; i < count; i++)
+			t[i] = (2.0 * static_cast<double>(xs[i]) - center) * inverse;
+
+		for (std::uint32_t k = piece.terms; k-- > 1;)
+		{
+			for (std::size_t i = 0; i < count; i++)
+			{
+				double current = 2.0 * t[i] * next[i] - after[i] + c[k];
+				after[i] = next[i];
+				next[i] = current;
+			}
+		}
+
+		for (std::size_t i = 0; i < count; i++)
+			ys[i] = static_cast<T>(t[i] * next[i] - after[i] + c[0]);
+	}
+
+	// samples usually come in order, so runs of them share a piece
+	template <typename T>
+	void ChebyshevProxy::evaluateAs(const T* xs, T* ys, std::size_t count) const
+	{
+		std::vector<std::size_t> exactIndices;
+		std::vector<double> exactXs;
+
+		for (std::size_t i = 0; i < count;)
+		{
+			double x = static_cast<double>(xs[i]);
+			if (!(x >= bounds.lo && x <= bounds.hi))
+			{
+				exactIndices.push_back(i);
+				exactXs.push_back(x);
+				i++;
+				continue;
+			}
+
+			const Piece& piece = pieces[locate(x)];
+			if (piece.kind == PieceKind::Polynomial)
+			{
+				std::size_t end = i + 1;
+				while (end < count && end - i < batchBlockSize
+					&& static_cast<double>(xs[end]) >= piece.lo && static_cast<double>(xs[end]) <= piece.hi)
+					end++;
+
+				interpolateRun(piece, xs + i, ys + i, end - i);
+				i = end;
+				continue;
+			}
+
+			if (piece.kind == PieceKind::Exact)
+			{
+				exactIndices.push_back(i);
+				exactXs.push_back(x);
+			}
+			else
+				ys[i] = std::numeric_limits<T>::quiet_NaN();
+
+			i++;
+		}
+
+		if (exactXs.empty())
+			return;
+
+		source->evaluate(exactXs.data(), exactXs.data(), exactXs.size());
+		for (std::size_t k = 0; k < exactIndices.size(); k++)
+			ys[exactIndices[k]] = static_cast<T>(exactXs[k]);
+	}
+
+	void ChebyshevProxy::evaluate(const double* xs, double* ys, std::size_t count) const
+	{
+		evaluateAs(xs, ys, count);
+	}
+
+	void ChebyshevProxy::evaluate(const float* xs, float* ys, std::size_t count) const
+	{
+		evaluateAs(xs, ys, count);
+	}
+
+	bool ChebyshevProxy::covers(Interval range, double tolerance) const
+	{
+		if (range.lo < bounds.lo || range.hi > bounds.hi || tolerance < error)
+			return false;
+
+		return std::all_of(parameters.begin(), parameters.end(), [](const std::pair<std::uint32_t, double>& parameter) {
+			return parameterValue(parameter.first) == parameter.second;
+		});
+	}
+}
\ No newline at end of file
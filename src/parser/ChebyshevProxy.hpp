@@ -0,0 +1,83 @@
+#pragma once
+#include "CompiledExpression.hpp"
+#include "Interval.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace parser
+{
+	// interpolation nodes per piece, the polynomial has at most this many terms
+	constexpr std::size_t chebyshevNodes = 24;
+
+	// a piece is halved at most maxProxyDepth times, and a proxy stops splitting at maxProxyPieces
+	constexpr int maxProxyDepth = 20;
+	constexpr std::size_t maxProxyPieces = 4096;
+
+	// piecewise chebyshev interpolant of an expression over a fixed range of x. Built once, then evaluated
+	// with a few multiply-adds per sample however heavy the expression is. A piece is halved until its
+	// interpolant is within tolerance of the expression between the nodes; pieces that still miss it at
+	// maxProxyDepth, or where the expression is not finite at a node, run the expression itself, as does
+	// any x outside the range. Parts outside the domain, see definedRanges, are nan.
+	// Parameters are taken at their values when the proxy is built
+	class ChebyshevProxy
+	{
+	public:
+		ChebyshevProxy(std::shared_ptr<const CompiledExpression> expression, Interval range, double tolerance);
+
+		// in double whatever the type of x; xs and ys may alias
+		void evaluate(const double* xs, double* ys, std::size_t count) const;
+		void evaluate(const float* xs, float* ys, std::size_t count) const;
+
+		// false once range reaches outside the proxy's, tolerance is finer than the one it was built
+		// for or a parameter of the expression changed
+		bool covers(Interval range, double tolerance) const;
+
+		const CompiledExpression& expression() const { return *source; }
+		Interval range() const { return bounds; }
+
+		// parts of the range inside the domain of the expression
+		const std::vector<Interval>& domain() const { return defined; }
+
+		std::size_t pieceCount() const { return pieces.size(); }
+		std::size_t exactPieces() const { return exactCount; }
+	private:
+		enum class PieceKind : std::uint8_t
+		{
+			Polynomial,
+			Exact, // runs the expression
+			Undefined
+		};
+
+		struct Piece
+		{
+			double lo;
+			double hi;
+			std::uint32_t first; // of its coefficients
+			std::uint32_t terms;
+			PieceKind kind;
+		};
+
+		std::shared_ptr<const CompiledExpression> source;
+		Interval bounds;
+		double error;
+		std::vector<Interval> defined;
+		std::vector<Piece> pieces; // sorted, together they cover bounds
+		std::vector<double> coefficients;
+		std::vector<std::pair<std::uint32_t, double>> parameters; // slot and value at build time
+		std::size_t exactCount = 0;
+
+		void approximate(double lo, double hi, int depth, const std::vector<double>& cosines);
+		void addPiece(double lo, double hi, PieceKind kind);
+		double interpolate(const Piece& piece, double x) const;
+		std::size_t locate(double x) const;
+
+		template <typename T>
+		void interpolateRun(const Piece& piece, const T* xs, T* ys, std::size_t count) const;
+
+		template <typename T>
+		void evaluateAs(const T* xs, T* ys, std::size_t count) const;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "CompiledExpression.hpp"
+#include "Compiler.hpp"
+#include "Optimizer.hpp"
+#include "Piecewise.hpp"
+#include "VirtualMachine.hpp"
+#include <utility>
+
+namespace parser
+{
+	namespace
+	{
+		Program compilePieces(const Ast& ast)
+		{
+			Ast pieces = pieceTree(ast);
+			return pieces.size() == 0 ? Program() : compile(pieces);
+		}
+	}
+
+	CompiledExpression::CompiledExpression(Ast tree)
+		: ast(std::move(tree)), bytecode(compile(ast)), intervalBytecode(compile(intervalTree(ast))), pieceProgram(compilePieces(ast)),
+		native(jit::compileNative(bytecode)),
+		fastNative(usesFastMath(bytecode) ? jit::compileNative(bytecode, MathTier::Fast) : nullptr) {}
+
+	float CompiledExpression::evaluate(float x) const
+	{
+		return execute(bytecode, x);
+	}
+
+	double CompiledExpression::evaluate(double x) const
+	{
+		return execute(bytecode, x);
+	}
+
+	long double CompiledExpression::evaluate(long double x) const
+	{
+		return execute(bytecode, x);
+	}
+
+	DoubleDouble CompiledExpression::evaluate(DoubleDouble x) const
+	{
+		return execute(bytecode, x);
+	}
+
+	Interval CompiledExpression::evaluate(Interval x) const
+	{
+		return execute(intervalBytecode, x);
+	}
+
+	void CompiledExpression::evaluate(const float* xs, float* ys, std::size_t count, MathTier tier) const
+	{
+		evaluate(xs, ys, count, tier, threadScratch());
+	}
+
+	void CompiledExpression::evaluate(const double* xs, double* ys, std::size_t count) const
+	{
+		evaluate(xs, ys, count, threadScratch());
+	}
+
+	void CompiledExpression::evaluate(const long double* xs, long double* ys, std::size_t count) const
+	{
+		evaluate(xs, ys, count, threadScratch());
+	}
+
+	void CompiledExpression::evaluate(const DoubleDouble* xs, DoubleDouble* ys, std::size_t count) const
+	{
+		evaluate(xs, ys, count, threadScratch());
+	}
+
+	void CompiledExpression::differentiate(const float* xs, float* ys, float* dys, std::size_t count) const
+	{
+		differentiate(xs, ys, dys, count, threadScratch());
+	}
+
+	void CompiledExpression::differentiate(const double* xs, double* ys, double* dys, std::size_t count) const
+	{
+		differentiate(xs, ys, dys, count, threadScratch());
+	}
+
+	void CompiledExpression::evaluate(const float* xs, float* ys, std::size_t count, MathTier tier, EvaluationScratch& scratch) const
+	{
+		const jit::NativeFunction* code = tier == MathTier::Fast && fastNative ? fastNative.get() : native.get();
+		if (code)
+		{
+			code->evaluate(xs, ys, count, scratch);
+			return;
+		}
+
+		executeBatch(bytecode, xs, ys, count, tier, scratch);
+	}
+
+	void CompiledExpression::evaluate(const double* xs, double* ys, std::size_t count, EvaluationScratch& scratch) const
+	{
+		executeBatch(bytecode, xs, ys, count, scratch);
+	}
+
+	void CompiledExpression::evaluate(const long double* xs, long double* ys, std::size_t count, EvaluationScratch& scratch) const
+	{
+		executeBatch(bytecode, xs, ys, count, scratch);
+	}
+
+	void CompiledExpression::evaluate(const DoubleDouble* xs, DoubleDouble* ys, std::size_t count, EvaluationScratch& scratch) const
+	{
+		executeBatch(bytecode, xs, ys, count, scratch);
+	}
+
+	void CompiledExpression::differentiate(const float* xs, float* ys, float* dys, std::size_t count, EvaluationScratch& scratch) const
+	{
+		differentiateBatch(bytecode, xs, ys, dys, count, scratch);
+	}
+
+	void CompiledExpression::differentiate(const double* xs, double* ys, double* dys, std::size_t count, EvaluationScratch& scratch) const
+	{
+		differentiateBatch(bytecode, xs, ys, dys, count, scratch);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+#include "Ast.hpp"
+#include "Bytecode.hpp"
+#include "VirtualMachine.hpp"
+#include "jit/NativeCode.hpp"
+#include <cstddef>
+#include <memory>
+
+namespace parser
+{
+	// immutable result of parsing an expression once; evaluation runs the bytecode or its native code.
+	// Every method is const and keeps its working state in an EvaluationScratch, the calling thread's
+	// unless one is passed, so one object can be shared by any number of threads without copies
+	class CompiledExpression
+	{
+	public:
+		explicit CompiledExpression(Ast tree);
+
+		// every op runs in the type of x
+		float evaluate(float x) const;
+		double evaluate(double x) const;
+		long double evaluate(long double x) const;
+		DoubleDouble evaluate(DoubleDouble x) const;
+
+		// guaranteed bounds of the expression over a whole range of x, empty where it is undefined throughout
+		Interval evaluate(Interval x) const;
+
+		// evaluates count samples at once, in native code when the program could be jitted; xs and ys may alias
+		void evaluate(const float* xs, float* ys, std::size_t count, MathTier tier = MathTier::Full) const;
+
+		// double lanes on the simd kernels, long double and double-double one sample at a time
+		void evaluate(const double* xs, double* ys, std::size_t count) const;
+		void evaluate(const long double* xs, long double* ys, std::size_t count) const;
+		void evaluate(const DoubleDouble* xs, DoubleDouble* ys, std::size_t count) const;
+
+		// f(x) into ys and f'(x) into dys for count samples in one pass; xs may alias ys but not dys
+		void differentiate(const float* xs, float* ys, float* dys, std::size_t count) const;
+		void differentiate(const double* xs, double* ys, double* dys, std::size_t count) const;
+
+		// the same in caller provided scratch
+		void evaluate(const float* xs, float* ys, std::size_t count, MathTier tier, EvaluationScratch& scratch) const;
+		void evaluate(const double* xs, double* ys, std::size_t count, EvaluationScratch& scratch) const;
+		void evaluate(const long double* xs, long double* ys, std::size_t count, EvaluationScratch& scratch) const;
+		void evaluate(const DoubleDouble* xs, DoubleDouble* ys, std::size_t count, EvaluationScratch& scratch) const;
+		void differentiate(const float* xs, float* ys, float* dys, std::size_t count, EvaluationScratch& scratch) const;
+		void differentiate(const double* xs, double* ys, double* dys, std::size_t count, EvaluationScratch& scratch) const;
+
+		const Ast& tree() const { return ast; }
+		const Program& program() const { return bytecode; }
+
+		// numbers the pieces of a piecewise expression, see pieceTree; no code if it has no conditions
+		const Program& pieces() const { return pieceProgram; }
+		const jit::NativeFunction* nativeCode() const { return native.get(); } // nullptr when interpreted
+
+		// nodes saved by merging structurally identical subexpressions
+		std::size_t deduplicatedNodes() const { return treeSize(ast) - ast.size(); }
+	private:
+		Ast ast;
+		Program bytecode;
+		Program intervalBytecode; // squares kept as powers, see intervalTree
+		Program pieceProgram;
+		std::unique_ptr<const jit::NativeFunction> native;
+		std::unique_ptr<const jit::NativeFunction> fastNative; // only if the fast tier changes anything
+	};
+}
\ No newline at end of file
@@ -0,0 +1,679 @@
+#include "Compiler.hpp"
+#include "Parameters.hpp"
+#include "Summation.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace parser
+{
+	namespace
+	{
+		OpCode opCodeFor(NodeType type)
+		{
+			switch (type)
+			{
+			case NodeType::Constant: return OpCode::Constant;
+			case NodeType::Variable: return OpCode::Variable;
+			case NodeType::Parameter: return OpCode::Parameter;
+			case NodeType::Negate: return OpCode::Negate;
+			case NodeType::Add: return OpCode::Add;
+			case NodeType::Subtract: return OpCode::Subtract;
+			case NodeType::Multiply: return OpCode::Multiply;
+			case NodeType::Divide: return OpCode::Divide;
+			case NodeType::Power: return OpCode::Power;
+			case NodeType::Sin: return OpCode::Sin;
+			case NodeType::Cos: return OpCode::Cos;
+			case NodeType::Tan: return OpCode::Tan;
+			case NodeType::Log: return OpCode::Log;
+			case NodeType::Exp: return OpCode::Exp;
+			case NodeType::Sqrt: return OpCode::Sqrt;
+			case NodeType::Abs: return OpCode::Abs;
+			case NodeType::Minimum: return OpCode::Minimum;
+			case NodeType::Maximum: return OpCode::Maximum;
+			case NodeType::Less: return OpCode::Less;
+			case NodeType::LessEqual: return OpCode::LessEqual;
+			case NodeType::Select: return OpCode::Select;
+			case NodeType::Sum: return OpCode::SumEnd;
+			case NodeType::Product: return OpCode::ProductEnd;
+			case NodeType::Index: return OpCode::Load;
+			}
+
+			return OpCode::Constant;
+		}
+
+		const char* mnemonic(OpCode op)
+		{
+			switch (op)
+			{
+			case OpCode::Constant: return "const";
+			case OpCode::Variable: return "x";
+			case OpCode::Negate: return "neg";
+			case OpCode::Add: return "add";
+			case OpCode::Subtract: return "sub";
+			case OpCode::Multiply: return "mul";
+			case OpCode::Divide: return "div";
+			case OpCode::Power: return "pow";
+			case OpCode::Sin: return "sin";
+			case OpCode::Cos: return "cos";
+			case OpCode::Tan: return "tan";
+			case OpCode::Log: return "log";
+			case OpCode::Exp: return "exp";
+			case OpCode::Sqrt: return "sqrt";
+			case OpCode::Abs: return "abs";
+			case OpCode::Minimum: return "min";
+			case OpCode::Maximum: return "max";
+			case OpCode::Less: return "lt";
+			case OpCode::LessEqual: return "le";
+			case OpCode::Select: return "select";
+			case OpCode::Then: return "then";
+			case OpCode::Else: return "else";
+			case OpCode::Store: return "store";
+			case OpCode::Load: return "load";
+			case OpCode::Parameter: return "param";
+			case OpCode::Pop: return "pop";
+			case OpCode::SumBegin: return "sum";
+			case OpCode::ProductBegin: return "prod";
+			case OpCode::SumEnd: return "endsum";
+			case OpCode::ProductEnd: return "endprod";
+			}
+
+			return "?";
+		}
+
+		bool isLoopOp(OpCode op)
+		{
+			return op == OpCode::SumBegin || op == OpCode::ProductBegin || op == OpCode::SumEnd || op == OpCode::ProductEnd;
+		}
+
+		// walks the dag from each root in turn. Inner nodes with several users are computed once, kept in a
+		// slot by Store and pushed again by Load; a slot is reused once its last user has loaded it.
+		// The body of a sum or product is a scope of its own, run once per index: its nodes are counted and
+		// stored apart from the ones around it. Nodes in the body that do not depend on its index are
+		// hoisted, computed and stored before the loop starts and loaded in the body
+		class Emitter
+		{
+		public:
+			Emitter(const Ast& tree, const std::vector<NodeId>& outputs)
+				: ast(tree), roots(outputs), remainingUses(tree.size(), 0), slotOf(tree.size(), unassigned),
+				inherited(tree.size(), false), scopeOf(tree.size(), 0)
+			{
+				std::fill(std::begin(loopSlots), std::end(loopSlots), unassigned);
+			}
+
+			// continues start, which leaves its first outputs on the stack and the nodes of stored in their
+			// slots. Those nodes are loaded, the slots of start are never written again
+			Emitter(const Ast& tree, const std::vector<NodeId>& outputs, Program start, std::size_t first,
+				const std::vector<std::uint32_t>& stored)
+				: Emitter(tree, outputs)
+			{
+				program = std::move(start);
+				depth = first;
+
+				for (NodeId id = 0; id < stored.size(); id++)
+				{
+					if (stored[id] == unassigned)
+						continue;
+
+					slotOf[id] = stored[id];
+					remainingUses[id] = std::numeric_limits<std::size_t>::max() / 2;
+					inherited[id] = true;
+				}
+			}
+
+			Program run()
+			{
+				std::size_t first = depth;
+
+				findScopes();
+				countUses(roots);
+				for (NodeId root : roots)
+					emit(root);
+
+				keepEscapingBranches();
+				program.outputs = first + roots.size();
+				return std::move(program);
+			}
+
+			// the slot of every node outside loops that is in one when the program ends, for continuing it
+			void storedNodes(std::vector<std::uint32_t>& stored) const
+			{
+				stored.resize(ast.size(), unassigned);
+				for (std::uint32_t slot = 0; slot < contents.size(); slot++)
+				{
+					if (contents[slot] != unassigned && scopeOf[contents[slot]] == 0)
+						stored[contents[slot]] = slot;
+				}
+			}
+		private:
+			static constexpr std::uint32_t unassigned = ~0u;
+
+			const Ast& ast;
+			const std::vector<NodeId>& roots;
+			Program program;
+			std::size_t depth = 0;
+			std::vector<std::size_t> remainingUses;
+			std::vector<std::uint32_t> slotOf;
+			std::vector<std::uint32_t> freeSlots;
+			std::vector<bool> inherited; // stored by the program this one continues, see the constructor
+			std::vector<NodeId> contents; // node last stored in each slot
+
+			// the scope of a node is 0 outside every loop body, else one more than the level of the
+			// innermost index it depends on; nodes are emitted in their scope and loaded in deeper ones
+			std::vector<int> scopeOf;
+			std::vector<std::vector<NodeId>> hoisted; // of every sum and product, in its scope
+			std::uint32_t loopSlots[maxLoopLevels]; // first of the four slots of the loops of each level
+			int scope = 0;
+
+			enum class Step : std::uint8_t
+			{
+				Operands, // first visit, pushes the operands
+				Finish, // the operands are on the stack
+				Then, // the condition of a select is on the stack
+				Else, // the condition and the then branch are on the stack
+				Hoist, // before a loop, computes a node its body loads unless it is stored already
+				Hoisted, // the hoisted node is on the stack
+				Begin, // the bounds of a loop are on the stack
+				End // the term of a loop is on the stack
+			};
+
+			struct Loop
+			{
+				NodeId id;
+				int scope; // around the loop
+				Jump body; // where the body starts
+				std::uint32_t exit; // jump of the Begin op
+			};
+
+			struct Visit
+			{
+				NodeId id;
+				Step step;
+			};
+
+			std::vector<Visit> pending;
+			std::vector<std::uint32_t> openJumps; // Then and Else ops whose target is not known yet
+			std::vector<Loop> loops; // being emitted, innermost last
+
+			static bool isLoop(NodeType type)
+			{
+				return type == NodeType::Sum || type == NodeType::Product;
+			}
+
+			void findScopes()
+			{
+				std::vector<std::uint32_t> free = freeIndices(ast);
+				bool anyLoop = false;
+
+				for (NodeId id = 0; id < ast.size(); id++)
+				{
+					for (std::uint32_t levels = free[id]; levels != 0; levels >>= 1)
+						scopeOf[id]++;
+
+					anyLoop = anyLoop || isLoop(ast[id].type);
+				}
+
+				if (!anyLoop)
+					return;
+
+				hoisted.resize(ast.size());
+				for (NodeId id = 0; id < ast.size(); id++)
+				{
+					if (isLoop(ast[id].type))
+						hoisted[id] = hoist(id);
+				}
+			}
+
+			// inner nodes the body of a loop uses that are in the scope of the loop itself. Those of scopes
+			// further out are hoisted by the loops around it
+			std::vector<NodeId> hoist(NodeId loop)
+			{
+				const Node& node = ast[loop];
+				int inner = static_cast<int>(node.value) + 1;
+
+				std::vector<bool> reachable(static_cast<std::size_t>(node.third) + 1, false);
+				reachable[node.third] = true;
+				std::vector<NodeId> nodes;
+
+				for (NodeId id = node.third + 1; id-- > 0;)
+				{
+					if (!reachable[id])
+						continue;
+
+					int operands = arity(ast[id].type);
+					if (scopeOf[id] < inner)
+					{
+						if (operands > 0 && scopeOf[id] == scopeOf[loop])
+							nodes.push_back(id);
+						continue;
+					}
+
+					forEachOperand(id, false, [&](NodeId operand) { reachable[operand] = true; });
+				}
+
+				return nodes;
+			}
+
+			// a loop uses its bounds and its hoisted nodes, the body only once scoped is false
+			template <typename Visitor>
+			void forEachOperand(NodeId id, bool scoped, Visitor visit) const
+			{
+				const Node& node = ast[id];
+				int operands = arity(node.type);
+				if (operands >= 1) visit(node.lhs);
+				if (operands >= 2) visit(node.rhs);
+
+				if (!isLoop(node.type))
+				{
+					if (operands == 3) visit(node.third);
+					return;
+				}
+
+				if (!scoped)
+				{
+					visit(node.third);
+					return;
+				}
+
+				for (NodeId operand : hoisted[id])
+					visit(operand);
+			}
+
+			// users of the nodes of the current scope reachable from its roots; every root counts as one more
+			// user, the output or the loop it is the body of. Counts of an earlier loop with the same body are reset
+			void countUses(const std::vector<NodeId>& scopeRoots)
+			{
+				std::vector<bool> reachable(ast.size(), false);
+				for (NodeId root : scopeRoots)
+					reachable[root] = scopeOf[root] == scope;
+
+				for (NodeId id = static_cast<NodeId>(ast.size()); id-- > 0;)
+				{
+					if (!reachable[id] || inherited[id])
+						continue;
+
+					remainingUses[id] = 0;
+					slotOf[id] = unassigned;
+					forEachOperand(id, true, [&](NodeId operand) {
+						reachable[operand] = reachable[operand] || scopeOf[operand] == scope;
+					});
+				}
+
+				for (NodeId root : scopeRoots)
+				{
+					if (reachable[root])
+						remainingUses[root]++;
+				}
+
+				for (NodeId id = static_cast<NodeId>(ast.size()); id-- > 0;)
+				{
+					if (!reachable[id] || inherited[id])
+						continue;
+
+					forEachOperand(id, true, [&](NodeId operand) {
+						if (reachable[operand])
+							remainingUses[operand]++;
+					});
+				}
+			}
+
+			void push(OpCode op)
+			{
+				program.code.push_back(op);
+				depth++;
+				program.maxStack = std::max(program.maxStack, depth);
+			}
+
+			// iterative so deeply nested expressions cannot overflow the call stack; a node is
+			// visited once before its operands and finished once they are on the stack
+			void emit(NodeId root)
+			{
+				pending.push_back({ root, Step::Operands });
+
+				while (!pending.empty())
+				{
+					Visit visit = pending.back();
+					pending.pop_back();
+
+					const Node& node = ast[visit.id];
+					int operands = arity(node.type);
+
+					switch (visit.step)
+					{
+					case Step::Finish: finish(visit.id, node, operands); continue;
+					case Step::Then: branch(OpCode::Then); continue;
+					case Step::Else: branch(OpCode::Else); continue;
+					case Step::Hoist: hoistNode(visit.id); continue;
+					case Step::Hoisted: keepHoisted(visit.id); continue;
+					case Step::Begin: begin(visit.id, node); continue;
+					case Step::End: end(visit.id, node); continue;
+					default: break;
+					}
+
+					// nodes of scopes further out are stored before the loop and keep their slot through it
+					if (slotOf[visit.id] != unassigned)
+					{
+						if (scopeOf[visit.id] < scope)
+							reload(visit.id);
+						else
+							load(visit.id);
+						continue;
+					}
+
+					// the loop runs after its hoisted nodes and bounds
+					if (isLoop(node.type))
+					{
+						pending.push_back({ visit.id, Step::Begin });
+						pending.push_back({ node.rhs, Step::Operands });
+						pending.push_back({ node.lhs, Step::Operands });
+						for (NodeId id : hoisted[visit.id])
+							pending.push_back({ id, Step::Hoist });
+						continue;
+					}
+
+					// a select's branches follow its condition, each after the op that may skip it
+					pending.push_back({ visit.id, Step::Finish });
+					if (operands == 3)
+					{
+						pending.push_back({ node.third, Step::Operands });
+						pending.push_back({ visit.id, Step::Else });
+						pending.push_back({ node.rhs, Step::Operands });
+						pending.push_back({ visit.id, Step::Then });
+					}
+					else if (operands == 2)
+						pending.push_back({ node.rhs, Step::Operands });
+					if (operands >= 1) pending.push_back({ node.lhs, Step::Operands });
+				}
+			}
+
+			// the cursors of the program at its end, where a jump recorded now continues
+			Jump here() const
+			{
+				return {
+					static_cast<std::uint32_t>(program.code.size()),
+					static_cast<std::uint32_t>(program.constants.size()),
+					static_cast<std::uint32_t>(program.slots.size()),
+					static_cast<std::uint32_t>(program.jumps.size())
+				};
+			}
+
+			void hoistNode(NodeId id)
+			{
+				if (slotOf[id] != unassigned)
+					return;
+
+				pending.push_back({ id, Step::Hoisted });
+				pending.push_back({ id, Step::Operands });
+			}
+
+			// stored for the loop, which counts as one user until it ends
+			void keepHoisted(NodeId id)
+			{
+				if (slotOf[id] == unassigned)
+				{
+					slotOf[id] = allocateSlot();
+					store(id);
+				}
+				else
+					remainingUses[id]++;
+
+				program.code.push_back(OpCode::Pop);
+				depth--;
+			}
+
+			// loops of the same level never run at the same time, they share their four slots
+			void begin(NodeId id, const Node& node)
+			{
+				int level = static_cast<int>(node.value);
+				if (loopSlots[level] == unassigned)
+				{
+					loopSlots[level] = static_cast<std::uint32_t>(program.slotCount);
+					program.slotCount += 4;
+				}
+
+				program.code.push_back(node.type == NodeType::Sum ? OpCode::SumBegin : OpCode::ProductBegin);
+				program.slots.push_back(loopSlots[level]);
+				program.jumps.push_back({});
+				depth -= 2;
+
+				loops.push_back({ id, scope, here(), static_cast<std::uint32_t>(program.jumps.size() - 1) });
+				scope = level + 1;
+				countUses({ node.third });
+
+				pending.push_back({ id, Step::End });
+				pending.push_back({ node.third, Step::Operands });
+			}
+
+			void end(NodeId id, const Node& node)
+			{
+				Loop loop = loops.back();
+				loops.pop_back();
+
+				program.code.push_back(node.type == NodeType::Sum ? OpCode::SumEnd : OpCode::ProductEnd);
+				program.slots.push_back(loopSlots[static_cast<int>(node.value)]);
+				program.jumps.push_back(loop.body);
+				program.jumps[loop.exit] = here();
+
+				// the loop took the body's value, the hoisted nodes are free to go
+				if (scopeOf[node.third] == scope && slotOf[node.third] != unassigned && --remainingUses[node.third] == 0)
+					freeSlots.push_back(slotOf[node.third]);
+
+				scope = loop.scope;
+				for (NodeId hoistedId : hoisted[id])
+				{
+					if (--remainingUses[hoistedId] == 0)
+						freeSlots.push_back(slotOf[hoistedId]);
+				}
+
+				keep(id);
+			}
+
+			// Then opens a jump over the then branch, Else closes it and opens one over the else branch,
+			// which the select closes. Selects nest, so the open jumps form a stack
+			void branch(OpCode op)
+			{
+				program.code.push_back(op);
+				program.jumps.push_back({});
+				std::uint32_t jump = static_cast<std::uint32_t>(program.jumps.size() - 1);
+
+				if (op == OpCode::Else)
+					closeJump();
+
+				openJumps.push_back(jump);
+			}
+
+			void closeJump()
+			{
+				program.jumps[openJumps.back()] = here();
+				openJumps.pop_back();
+			}
+
+			// a skipped branch leaves its slots unwritten, so a branch that stores a value used after it
+			// always runs. The first Store or Load of the slot after the branch tells which it is
+			// and code appended to a program may load what the branches of the program stored
+			void keepEscapingBranches()
+			{
+				std::vector<std::uint32_t> slotAt(program.code.size(), unassigned);
+				std::vector<std::uint32_t> jumpOrigins; // pc of the op of each jump
+				std::size_t slot = 0;
+				for (std::size_t pc = 0; pc < program.code.size(); pc++)
+				{
+					OpCode op = program.code[pc];
+					if (op == OpCode::Store || op == OpCode::Load)
+						slotAt[pc] = program.slots[slot];
+					if (op == OpCode::Store || op == OpCode::Load || op == OpCode::Parameter || isLoopOp(op))
+						slot++;
+					if (op == OpCode::Then || op == OpCode::Else || isLoopOp(op))
+						jumpOrigins.push_back(static_cast<std::uint32_t>(pc));
+				}
+
+				// the jumps of loops are always taken as they are
+				for (std::size_t jump = 0; jump < program.jumps.size(); jump++)
+				{
+					if (isLoopOp(program.code[jumpOrigins[jump]]))
+						continue;
+
+					std::uint32_t target = program.jumps[jump].pc;
+					for (std::uint32_t pc = jumpOrigins[jump] + 1; pc < target; pc++)
+					{
+						if (program.code[pc] == OpCode::Store && loadedFrom(slotAt, slotAt[pc], target))
+						{
+							program.jumps[jump].pc = 0;
+							break;
+						}
+					}
+				}
+			}
+
+			bool loadedFrom(const std::vector<std::uint32_t>& slotAt, std::uint32_t slot, std::uint32_t start) const
+			{
+				for (std::size_t pc = start; pc < program.code.size(); pc++)
+				{
+					if (slotAt[pc] == slot)
+						return program.code[pc] == OpCode::Load;
+				}
+
+				return false;
+			}
+
+			void load(NodeId id)
+			{
+				push(OpCode::Load);
+				program.slots.push_back(slotOf[id]);
+
+				if (--remainingUses[id] == 0)
+					freeSlots.push_back(slotOf[id]);
+			}
+
+			// a node of a scope around the current one, its users there keep its slot
+			void reload(NodeId id)
+			{
+				push(OpCode::Load);
+				program.slots.push_back(slotOf[id]);
+			}
+
+			void finish(NodeId id, const Node& node, int operands)
+			{
+				if (node.type == NodeType::Constant)
+					program.constants.push_back(node.value);
+
+				if (node.type == NodeType::Parameter)
+					program.slots.push_back(node.lhs);
+
+				if (node.type == NodeType::Index)
+					program.slots.push_back(loopSlots[static_cast<int>(node.value)]);
+
+				if (node.type == NodeType::Select)
+					closeJump();
+
+				// every op leaves exactly one value on the stack
+				depth -= operands;
+				push(opCodeFor(node.type));
+
+				// reloading a leaf costs as much as recomputing it
+				if (operands > 0)
+					keep(id);
+			}
+
+			void keep(NodeId id)
+			{
+				if (remainingUses[id] <= 1)
+					return;
+
+				slotOf[id] = allocateSlot();
+				store(id);
+				remainingUses[id]--;
+			}
+
+			void store(NodeId id)
+			{
+				program.code.push_back(OpCode::Store);
+				program.slots.push_back(slotOf[id]);
+
+				if (contents.size() <= slotOf[id])
+					contents.resize(slotOf[id] + 1, unassigned);
+				contents[slotOf[id]] = id;
+			}
+
+			std::uint32_t allocateSlot()
+			{
+				if (!freeSlots.empty())
+				{
+					std::uint32_t slot = freeSlots.back();
+					freeSlots.pop_back();
+					return slot;
+				}
+
+				return static_cast<std::uint32_t>(program.slotCount++);
+			}
+		};
+	}
+
+	Program compile(const Ast& ast)
+	{
+		return compile(ast, { ast.root });
+	}
+
+	Program compile(const Ast& ast, const std::vector<NodeId>& roots)
+	{
+		return Emitter(ast, roots).run();
+	}
+
+	Program compile(const Ast& ast, const std::vector<NodeId>& roots, std::vector<std::uint32_t>& stored)
+	{
+		Emitter emitter(ast, roots);
+		Program program = emitter.run();
+
+		stored.assign(ast.size(), ~0u);
+		emitter.storedNodes(stored);
+		return program;
+	}
+
+	void appendRoot(Program& program, const Ast& ast, const std::vector<NodeId>& roots, std::vector<std::uint32_t>& stored)
+	{
+		stored.resize(ast.size(), ~0u);
+
+		std::vector<NodeId> root = { roots.back() };
+		Emitter emitter(ast, root, std::move(program), roots.size() - 1, stored);
+		program = emitter.run();
+		emitter.storedNodes(stored);
+	}
+
+	std::string disassemble(const Program& program)
+	{
+		std::ostringstream text;
+		text.precision(17);
+
+		std::size_t constant = 0;
+		std::size_t slot = 0;
+		std::size_t jump = 0;
+		for (std::size_t pc = 0; pc < program.code.size(); pc++)
+		{
+			OpCode op = program.code[pc];
+			text << pc << ": " << mnemonic(op);
+
+			if (op == OpCode::Constant)
+				text << ' ' << program.constants[constant++];
+			else if (op == OpCode::Store || op == OpCode::Load)
+				text << ' ' << program.slots[slot++];
+			else if (isLoopOp(op))
+				text << ' ' << program.slots[slot++] << " -> " << program.jumps[jump++].pc;
+			else if (op == OpCode::Parameter)
+				text << ' ' << parameterName(program.slots[slot++]);
+			else if (op == OpCode::Then || op == OpCode::Else)
+			{
+				std::uint32_t target = program.jumps[jump++].pc;
+				if (target != 0)
+					text << " -> " << target;
+			}
+
+			text << '\n';
+		}
+
+		return text.str();
+	}
+}
\ No newline at end of file
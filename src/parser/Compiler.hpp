@@ -0,0 +1,27 @@
+#pragma once
+#include "Ast.hpp"
+#include "Bytecode.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace parser
+{
+	Program compile(const Ast& ast);
+
+	// one program for several roots of the same dag, shared nodes are computed once for all of them.
+	// Root k's value is left in stack entry k
+	Program compile(const Ast& ast, const std::vector<NodeId>& roots);
+
+	// as above; stored receives the slot each node outside loops is left in when the program ends, ~0u
+	// for the others, to append to the program later
+	Program compile(const Ast& ast, const std::vector<NodeId>& roots, std::vector<std::uint32_t>& stored);
+
+	// appends the code for roots.back() to program, which computes the other roots of the same dag. Nodes
+	// stored by the program are loaded instead of computed again and its slots are never overwritten;
+	// stored is updated with what the new code leaves in its own slots
+	void appendRoot(Program& program, const Ast& ast, const std::vector<NodeId>& roots, std::vector<std::uint32_t>& stored);
+
+	// one op per line, constants inline, for inspecting what the optimizer produced
+	std::string disassemble(const Program& program);
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "Definitions.hpp"
+#include "ExpressionParser.hpp"
+#include "Lexer.hpp"
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace parser
+{
+	namespace
+	{
+		std::mutex definitionsMutex;
+		std::vector<FunctionDefinition> definitions;
+
+		Token expect(Lexer& lexer, TokenType type, const char* message)
+		{
+			Token token = lexer.next();
+			if (token.type != type)
+				throw std::runtime_error(message);
+
+			return token;
+		}
+
+		bool callsAny(std::string_view expression, std::string_view name, std::vector<std::string>& visited)
+		{
+			Lexer lexer(expression);
+
+			while (lexer.peek().type != TokenType::End)
+			{
+				Token token = lexer.next();
+				if (token.type != TokenType::Identifier || lexer.peek().type != TokenType::LeftParen)
+					continue;
+
+				if (token.text == name)
+					return true;
+
+				// every definition is searched once, however often it is called
+				if (std::find(visited.begin(), visited.end(), token.text) != visited.end())
+					continue;
+
+				visited.emplace_back(token.text);
+
+				FunctionDefinition callee;
+				if (lookupDefinition(token.text, callee) && callsAny(callee.body, name, visited))
+					return true;
+			}
+
+			return false;
+		}
+	}
+
+	std::string defineFunction(std::string_view definition)
+	{
+		Lexer lexer(definition);
+
+		Token name = lexer.next();
+		if (name.type == TokenType::Function || name.type == TokenType::Variable)
+			throw std::runtime_error("Cannot redefine " + std::string(name.text));
+
+		if (name.type != TokenType::Identifier)
+			throw std::runtime_error("Expected a function name");
+
+		expect(lexer, TokenType::LeftParen, "Expected '(' after the function name");
+
+		Token argument = lexer.next();
+		if (argument.type != TokenType::Identifier && argument.type != TokenType::Variable)
+			throw std::runtime_error("Expected the name of the argument");
+
+		expect(lexer, TokenType::RightParen, "Expected ')' after the argument");
+
+		Token equals = lexer.next();
+		if (equals.type != TokenType::Unknown || equals.text != "=")
+			throw std::runtime_error("Expected '=' after the argument list");
+
+		// checked before it replaces anything, a body that does not parse leaves the old one in place
+		std::string_view body = definition.substr(equals.text.data() + equals.text.size() - definition.data());
+		parseFunctionBody(name.text, argument.text, body);
+
+		FunctionDefinition parsed = { std::string(name.text), std::string(argument.text), std::string(body) };
+
+		std::lock_guard<std::mutex> lock(definitionsMutex);
+		auto existing = std::find_if(definitions.begin(), definitions.end(), [&](const FunctionDefinition& function) {
+			return function.name == parsed.name;
+		});
+
+		if (existing != definitions.end())
+			*existing = parsed;
+		else
+			definitions.push_back(parsed);
+
+		return parsed.name;
+	}
+
+	bool lookupDefinition(std::string_view name, FunctionDefinition& definition)
+	{
+		std::lock_guard<std::mutex> lock(definitionsMutex);
+
+		for (const FunctionDefinition& function : definitions)
+		{
+			if (function.name == name)
+			{
+				definition = function;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool callsFunction(std::string_view expression, std::string_view name)
+	{
+		std::vector<std::string> visited;
+		return callsAny(expression, name, visited);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace parser
+{
+	// a function of one argument defined at runtime, such as f(u) = u^2 + sin(u). Kept as text and
+	// inlined into every expression that calls it when that expression is parsed
+	struct FunctionDefinition
+	{
+		std::string name;
+		std::string argument;
+		std::string body;
+	};
+
+	// parses "f(u) = body" and defines f, replacing an earlier definition. The body may use its argument,
+	// parameters and functions already defined, but not x or f itself, also not through other functions.
+	// Throws std::runtime_error and keeps the old definition on errors; returns the name
+	std::string defineFunction(std::string_view definition);
+
+	bool lookupDefinition(std::string_view name, FunctionDefinition& definition);
+
+	// true if the expression calls the function, directly or through other definitions; those are the
+	// expressions to compile again after it is redefined
+	bool callsFunction(std::string_view expression, std::string_view name);
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "Derivative.hpp"
+#include <utility>
+#include <vector>
+
+namespace parser
+{
+	namespace
+	{
+		// adds d/dx of every node reachable from a root to the dag it works on
+		class Differentiator
+		{
+		public:
+			explicit Differentiator(Ast tree)
+				: ast(std::move(tree)) {}
+
+			// returns the id of the derivative of root, the nodes of earlier calls stay in the dag
+			NodeId derive(NodeId root)
+			{
+				std::size_t count = static_cast<std::size_t>(root) + 1;
+
+				std::vector<bool> reachable(count, false);
+				reachable[root] = true;
+
+				for (NodeId id = root + 1; id-- > 0;)
+				{
+					if (!reachable[id])
+						continue;
+
+					const Node& node = ast[id];
+					int operands = arity(node.type);
+					if (operands >= 1) reachable[node.lhs] = true;
+					if (operands >= 2) reachable[node.rhs] = true;
+					if (operands == 3) reachable[node.third] = true;
+				}
+
+				// operands come first, so their derivatives are always known
+				slopes.assign(count, 0);
+				for (NodeId id = 0; id < count; id++)
+				{
+					if (reachable[id])
+						slopes[id] = slope(id);
+				}
+
+				return slopes[root];
+			}
+
+			Ast take(NodeId root)
+			{
+				ast.root = root;
+				return compact(ast);
+			}
+		private:
+			Ast ast;
+			std::vector<NodeId> slopes;
+
+			// ast may grow and move while a rule adds nodes, so nodes are copied out
+			Node get(NodeId id) const { return ast[id]; }
+
+			bool isConstant(NodeId id, double value) const
+			{
+				return get(id).type == NodeType::Constant && get(id).value == value;
+			}
+
+			NodeId constant(double value)
+			{
+				return ast.add({ NodeType::Constant, value, 0, 0 });
+			}
+
+			NodeId unary(NodeType type, NodeId operand)
+			{
+				return ast.add({ type, 0.0, operand, 0 });
+			}
+
+			NodeId negate(NodeId operand)
+			{
+				Node node = get(operand);
+				if (node.type == NodeType::Constant)
+					return constant(-node.value);
+
+				if (node.type == NodeType::Negate)
+					return node.lhs;
+
+				return unary(NodeType::Negate, operand);
+			}
+
+			NodeId sum(NodeId lhs, NodeId rhs)
+			{
+				if (isConstant(rhs, 0.0)) return lhs;
+				if (isConstant(lhs, 0.0)) return rhs;
+				return ast.add({ NodeType::Add, 0.0, lhs, rhs });
+			}
+
+			NodeId difference(NodeId lhs, NodeId rhs)
+			{
+				if (isConstant(rhs, 0.0)) return lhs;
+				if (isConstant(lhs, 0.0)) return negate(rhs);
+				return ast.add({ NodeType::Subtract, 0.0, lhs, rhs });
+			}
+
+			// a factor that is 0 by construction zeroes the term, whatever the other one evaluates to
+			NodeId product(NodeId lhs, NodeId rhs)
+			{
+				if (isConstant(lhs, 0.0) || isConstant(rhs, 1.0)) return lhs;
+				if (isConstant(rhs, 0.0) || isConstant(lhs, 1.0)) return rhs;
+				return ast.add({ NodeType::Multiply, 0.0, lhs, rhs });
+			}
+
+			NodeId quotient(NodeId lhs, NodeId rhs)
+			{
+				if (isConstant(lhs, 0.0) || isConstant(rhs, 1.0)) return lhs;
+				return ast.add({ NodeType::Divide, 0.0, lhs, rhs });
+			}
+
+			NodeId power(NodeId base, NodeId exponent)
+			{
+				if (isConstant(exponent, 1.0)) return base;
+				if (isConstant(exponent, 0.0)) return constant(1.0);
+				return ast.add({ NodeType::Power, 0.0, base, exponent });
+			}
+
+			// sum of body over the index of level
+			NodeId series(double level, NodeId first, NodeId last, NodeId body)
+			{
+				if (isConstant(body, 0.0)) return body;
+				return ast.add({ NodeType::Sum, level, first, last, body });
+			}
+
+			NodeId comparison(NodeType type, NodeId lhs, NodeId rhs)
+			{
+				return ast.add({ type, 0.0, lhs, rhs });
+			}
+
+			NodeId select(NodeId condition, NodeId a, NodeId b)
+			{
+				if (a == b) return a;
+				return ast.add({ NodeType::Select, 0.0, condition, a, b });
+			}
+
+			NodeId slope(NodeId id)
+			{
+				Node node = get(id);
+				NodeId a = node.lhs;
+				NodeId b = node.rhs;
+
+				switch (node.type)
+				{
+				case NodeType::Constant: return constant(0.0);
+				case NodeType::Variable: return constant(1.0);
+				case NodeType::Parameter: return constant(0.0);
+				case NodeType::Index: return constant(0.0);
+				default: break;
+				}
+
+				NodeId da = slopes[a];
+				NodeId db = arity(node.type) >= 2 ? slopes[b] : constant(0.0);
+
+				switch (node.type)
+				{
+				case NodeType::Negate: return negate(da);
+				case NodeType::Add: return sum(da, db);
+				case NodeType::Subtract: return difference(da, db);
+				case NodeType::Multiply: return sum(product(da, b), product(a, db));
+
+				// (a' - f * b') / b, with f = a / b already in the dag
+				case NodeType::Divide: return quotient(difference(da, product(id, db)), b);
+				case NodeType::Power: return powerSlope(id, a, b, da, db);
+
+				case NodeType::Sin: return product(unary(NodeType::Cos, a), da);
+				case NodeType::Cos: return negate(product(unary(NodeType::Sin, a), da));
+				case NodeType::Tan: return product(sum(constant(1.0), product(id, id)), da);
+				case NodeType::Log: return quotient(da, a);
+				case NodeType::Exp: return product(id, da);
+				case NodeType::Sqrt: return quotient(da, product(constant(2.0), id));
+
+				// piecewise functions take the slope of the piece in use, the jumps of comparisons are ignored
+				case NodeType::Abs: return select(comparison(NodeType::Less, a, constant(0.0)), negate(da), da);
+				case NodeType::Minimum: return select(comparison(NodeType::Less, a, b), da, db);
+				case NodeType::Maximum: return select(comparison(NodeType::Less, b, a), da, db);
+				case NodeType::Less: return constant(0.0);
+				case NodeType::LessEqual: return constant(0.0);
+				case NodeType::Select: return select(a, db, slopes[node.third]);
+
+				// the bounds are the same for every x
+				case NodeType::Sum: return series(node.value, a, b, slopes[node.third]);
+				case NodeType::Product: return productSlope(node.value, a, b, node.third);
+				default: return constant(0.0);
+				}
+			}
+
+			// (f1 f2 ... fn)' is the sum of fk' times the other factors. Without zero factors that is
+			// f1 f2 ... fn (f1'/f1 + ... + fn'/fn); with one zero factor fk only the term of fk' is left,
+			// fk' times the product of the others, and with two or more every term has a zero factor
+			NodeId productSlope(double level, NodeId first, NodeId last, NodeId body)
+			{
+				NodeId slope = slopes[body];
+				if (isConstant(slope, 0.0))
+					return slope;
+
+				NodeId zero = comparison(NodeType::LessEqual, unary(NodeType::Abs, body), constant(0.0));
+				NodeId zeros = ast.add({ NodeType::Sum, level, first, last, zero });
+				NodeId others = ast.add({ NodeType::Product, level, first, last, select(zero, constant(1.0), body) });
+
+				NodeId ratios = series(level, first, last, select(zero, constant(0.0), quotient(slope, body)));
+				NodeId zeroSlopes = series(level, first, last, select(zero, slope, constant(0.0)));
+
+				NodeId single = select(comparison(NodeType::Less, zeros, constant(1.5)), product(others, zeroSlopes), constant(0.0));
+				return select(comparison(NodeType::Less, zeros, constant(0.5)), product(others, ratios), single);
+			}
+
+			// x^n, c^x and the general a^b = exp(b * log a), the cheaper forms also work for negative bases
+			NodeId powerSlope(NodeId id, NodeId a, NodeId b, NodeId da, NodeId db)
+			{
+				if (isConstant(db, 0.0))
+				{
+					Node exponent = get(b);
+					NodeId lowered = exponent.type == NodeType::Constant
+						? constant(exponent.value - 1.0)
+						: difference(b, constant(1.0));
+
+					return product(product(b, power(a, lowered)), da);
+				}
+
+				NodeId logarithm = unary(NodeType::Log, a);
+				if (isConstant(da, 0.0))
+					return product(product(id, logarithm), db);
+
+				return product(id, sum(product(db, logarithm), quotient(product(b, da), a)));
+			}
+		};
+	}
+
+	Ast differentiate(const Ast& ast, int order)
+	{
+		Differentiator differentiator(ast);
+
+		NodeId root = ast.root;
+		for (int i = 0; i < order; i++)
+			root = differentiator.derive(root);
+
+		return differentiator.take(root);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+#include "Ast.hpp"
+
+namespace parser
+{
+	// highest order accepted by d/dx prefixes, each order can roughly double the size of the tree
+	constexpr int maxDerivativeOrder = 8;
+
+	// symbolic derivative with respect to x, taken order times. The derivative nodes are added to
+	// the same dag as the function, so f, f' and f'' share every subexpression they have in common
+	// (cos(x) in d/dx sin(x) and d2/dx2 cos(x) is one node). Terms that are 0 or 1 by construction
+	// are dropped on the way, the optimizer folds the rest. Only nodes reachable from the result
+	// are kept
+	Ast differentiate(const Ast& ast, int order = 1);
+}
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "Domain.hpp"
+#include "Parameters.hpp"
+#include "Piecewise.hpp"
+#include "Summation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+namespace parser
+{
+	namespace
+	{
+		enum class Coverage
+		{
+			None, // every root is undefined throughout
+			Some,
+			All // some root is defined throughout
+		};
+
+		// bounds of every node over a range of x, partial where x may leave the domain of an op on the way.
+		// The interval ops follow the point evaluators, so an op that maps nan to a number (a comparison,
+		// min, max or a select) gives bounds again and its node counts as defined where the others are
+		class DomainAnalysis
+		{
+		public:
+			DomainAnalysis(const Ast& tree, const std::vector<NodeId>& outputs)
+				: ast(tree), roots(outputs), values(tree.size()), terms(tree.size(), 0.0)
+			{
+				// the bounds are the same for every x, an index spans the ranges of all sums of its level
+				std::fill(std::begin(indexRanges), std::end(indexRanges), Interval::empty());
+
+				for (NodeId id = 0; id < ast.size(); id++)
+				{
+					const Node& node = ast[id];
+					if (node.type != NodeType::Sum && node.type != NodeType::Product)
+						continue;
+
+					double first = std::round(evaluateTree(ast, node.lhs, 0.0));
+					terms[id] = loopTerms(first, evaluateTree(ast, node.rhs, 0.0));
+					if (!(terms[id] >= 1.0))
+						continue;
+
+					Interval& range = indexRanges[static_cast<int>(node.value)];
+					range = isEmpty(range) ? Interval(first, first + terms[id] - 1.0)
+						: Interval(std::min(range.lo, first), std::max(range.hi, first + terms[id] - 1.0));
+				}
+			}
+
+			Coverage cover(Interval x)
+			{
+				analyze(x);
+
+				Coverage coverage = Coverage::None;
+				for (NodeId root : roots)
+				{
+					if (isEmpty(values[root]))
+						continue;
+
+					if (!values[root].partial)
+						return Coverage::All;
+
+					coverage = Coverage::Some;
+				}
+
+				return coverage;
+			}
+		private:
+			const Ast& ast;
+			const std::vector<NodeId>& roots;
+			std::vector<Interval> values;
+			std::vector<double> terms; // of every sum and product
+			Interval indexRanges[maxLoopLevels];
+
+			// operands come first, so the dag is analyzed in one pass over the nodes
+			void analyze(Interval x)
+			{
+				for (NodeId id = 0; id < ast.size(); id++)
+				{
+					const Node& node = ast[id];
+					int operands = arity(node.type);
+
+					switch (node.type)
+					{
+					case NodeType::Constant: values[id] = node.value; continue;
+					case NodeType::Variable: values[id] = x; continue;
+					case NodeType::Parameter: values[id] = parameterValue(node.lhs); continue;
+					case NodeType::Index: values[id] = indexRanges[static_cast<int>(node.value)]; continue;
+					default: break;
+					}
+
+					Interval a = values[node.lhs];
+					Interval b = operands >= 2 ? values[node.rhs] : Interval(0.0);
+
+					if (node.type == NodeType::Select)
+					{
+						values[id] = choose(a, b, values[node.third]);
+						continue;
+					}
+
+					if (node.type == NodeType::Sum || node.type == NodeType::Product)
+					{
+						loop(id, node);
+						continue;
+					}
+
+					// a product of a node with itself is a square, see intervalTree
+					values[id] = node.type == NodeType::Multiply && node.lhs == node.rhs ? pow(a, Interval(2.0)) : applyNode(node.type, a, b);
+				}
+			}
+
+			// every term lies in the bounds of the body, the sum of n of them in n times those
+			void loop(NodeId id, const Node& node)
+			{
+				double count = terms[id];
+
+				if (!(count >= 1.0))
+				{
+					values[id] = count == 0.0 ? Interval(node.type == NodeType::Sum ? 0.0 : 1.0) : Interval::empty();
+					return;
+				}
+
+				Interval body = values[node.third];
+
+				if (node.type == NodeType::Sum)
+				{
+					values[id] = Interval(count) * body;
+					return;
+				}
+
+				// by squaring, each factor independent of the others
+				Interval product = 1.0;
+				for (auto remaining = static_cast<std::uint32_t>(count); remaining > 0; remaining >>= 1)
+				{
+					if (remaining & 1u)
+						product *= body;
+					if (remaining > 1)
+						body *= body;
+				}
+
+				values[id] = product;
+			}
+		};
+
+		class Bisection
+		{
+		public:
+			Bisection(DomainAnalysis& analysis, double resolution, std::size_t budget)
+				: analysis(analysis), resolution(resolution), budget(budget) {}
+
+			std::vector<Interval> run(Interval range)
+			{
+				split(range);
+				return std::move(ranges);
+			}
+		private:
+			DomainAnalysis& analysis;
+			double resolution;
+			std::size_t budget;
+			std::size_t analyses = 0;
+			std::vector<Interval> ranges;
+
+			// ranges come in from left to right, touching ones are merged
+			void keep(Interval range)
+			{
+				if (!ranges.empty() && ranges.back().hi >= range.lo)
+					ranges.back().hi = range.hi;
+				else
+					ranges.push_back(range);
+			}
+
+			void split(Interval range)
+			{
+				if (analyses++ >= budget)
+				{
+					keep(range);
+					return;
+				}
+
+				Coverage coverage = analysis.cover(range);
+				if (coverage == Coverage::None)
+					return;
+
+				double middle = range.lo + (range.hi - range.lo) / 2.0;
+				if (coverage == Coverage::All || range.hi - range.lo <= resolution || middle <= range.lo || middle >= range.hi)
+				{
+					keep(range);
+					return;
+				}
+
+				split({ range.lo, middle });
+				split({ middle, range.hi });
+			}
+		};
+	}
+
+	std::vector<Interval> definedRanges(const Ast& ast, Interval range, double resolution)
+	{
+		return definedRanges(ast, { ast.root }, range, resolution);
+	}
+
+	std::vector<Interval> definedRanges(const Ast& ast, const std::vector<NodeId>& roots, Interval range, double resolution)
+	{
+		if (ast.size() == 0 || roots.empty() || !std::isfinite(range.lo) || !std::isfinite(range.hi) || !(resolution > 0.0))
+			return { range };
+
+		double steps = (range.hi - range.lo) / resolution;
+		std::size_t budget = std::max(minDomainAnalyses, static_cast<std::size_t>(std::min(steps / samplesPerAnalysis, 1e9)));
+
+		DomainAnalysis analysis(ast, roots);
+		return Bisection(analysis, resolution, budget).run(range);
+	}
+}
\ No newline at end of file
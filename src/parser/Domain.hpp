@@ -0,0 +1,25 @@
+#pragma once
+#include "Ast.hpp"
+#include "Interval.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace parser
+{
+	// one interval analysis of the tree costs about as much as this many samples in a batch. A call of
+	// definedRanges spends at most one analysis per that many resolution steps of the range, at least
+	// minDomainAnalyses; past that the remaining parts are kept whole
+	constexpr double samplesPerAnalysis = 16.0;
+	constexpr std::size_t minDomainAnalyses = 64;
+
+	// the parts of range where x is inside the domain of the expression, sorted and disjoint. Found by
+	// bisection on interval bounds of the tree: a part where the expression is undefined for every x is
+	// dropped, one where no op on the way leaves its domain is kept whole, the rest is split down to
+	// resolution and kept. An undefined operand only drops a part if it reaches the root: comparisons,
+	// min, max and selects turn it into a number as the point evaluators do. Poles are single points
+	// and stay in, like the samples that hit them
+	std::vector<Interval> definedRanges(const Ast& ast, Interval range, double resolution);
+
+	// union of the domains of several roots of the same dag
+	std::vector<Interval> definedRanges(const Ast& ast, const std::vector<NodeId>& roots, Interval range, double resolution);
+}
\ No newline at end of file
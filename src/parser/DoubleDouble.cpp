@@ -0,0 +1,282 @@
+#include "DoubleDouble.hpp"
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace parser
+{
+	namespace
+	{
+		// pi / 2 and ln 2 rounded to double-double
+		constexpr DoubleDouble halfPi = { 1.5707963267948966, 6.123233995736766e-17 };
+		constexpr DoubleDouble ln2 = { 0.6931471805599453, 2.3190468138462996e-17 };
+
+		// beyond this the nearest multiple of pi / 2 is no longer an exact double
+		constexpr double maxReducedArgument = 0x1p52;
+
+		// exp overflows above and underflows to 0 below
+		constexpr double maxExpArgument = 709.79;
+		constexpr double minExpArgument = -745.2;
+
+		// exp halves its reduced argument this many times and squares the result back up
+		constexpr int expHalvings = 9;
+
+		// exact sum of two doubles, s + e == a + b
+		DoubleDouble twoSum(double a, double b)
+		{
+			double s = a + b;
+			double bb = s - a;
+			return { s, (a - (s - bb)) + (b - bb) };
+		}
+
+		// same as twoSum for |a| >= |b|
+		DoubleDouble quickTwoSum(double a, double b)
+		{
+			double s = a + b;
+			return { s, b - (s - a) };
+		}
+
+		// exact product of two doubles
+		DoubleDouble twoProduct(double a, double b)
+		{
+			double p = a * b;
+			return { p, std::fma(a, b, -p) };
+		}
+
+		// 1 / n! for the taylor series of exp, sin and cos
+		const std::array<DoubleDouble, 30>& inverseFactorials()
+		{
+			static const std::array<DoubleDouble, 30> table = [] {
+				std::array<DoubleDouble, 30> values;
+				values[0] = 1.0;
+				for (std::size_t n = 1; n < values.size(); n++)
+					values[n] = values[n - 1] / static_cast<double>(n);
+
+				return values;
+			}();
+
+			return table;
+		}
+
+		// sum of coefficient(j) * x^j for j < terms, by horner's rule
+		template <typename Coefficient>
+		DoubleDouble polynomial(const DoubleDouble& x, int terms, Coefficient&& coefficient)
+		{
+			DoubleDouble sum = coefficient(terms - 1);
+			for (int j = terms - 2; j >= 0; j--)
+				sum = sum * x + coefficient(j);
+
+			return sum;
+		}
+
+		// sin and cos of |r| <= pi / 4, the series terms left out are below 1e-33
+		constexpr int trigTerms = 15;
+
+		DoubleDouble sinSeries(const DoubleDouble& r)
+		{
+			const auto& inverse = inverseFactorials();
+			DoubleDouble square = r * r;
+			return r * polynomial(square, trigTerms, [&](int j) {
+				return j % 2 == 0 ? inverse[2 * j + 1] : -inverse[2 * j + 1];
+			});
+		}
+
+		DoubleDouble cosSeries(const DoubleDouble& r)
+		{
+			const auto& inverse = inverseFactorials();
+			DoubleDouble square = r * r;
+			return polynomial(square, trigTerms, [&](int j) {
+				return j % 2 == 0 ? inverse[2 * j] : -inverse[2 * j];
+			});
+		}
+
+		// value - k * pi / 2 with k the nearest integer, so the result lies within pi / 4 of 0
+		DoubleDouble reduceQuadrant(const DoubleDouble& value, int& quadrant)
+		{
+			double k = std::nearbyint(value.hi / halfPi.hi);
+			quadrant = static_cast<int>(std::fmod(k, 4.0));
+			if (quadrant < 0)
+				quadrant += 4;
+
+			return value - halfPi * k;
+		}
+
+		DoubleDouble integerPower(DoubleDouble base, long long exponent)
+		{
+			bool invert = exponent < 0;
+			unsigned long long remaining = invert ? 0ull - static_cast<unsigned long long>(exponent) : exponent;
+
+			DoubleDouble result = 1.0;
+			while (remaining > 0)
+			{
+				if (remaining & 1)
+					result *= base;
+
+				remaining >>= 1;
+				if (remaining > 0)
+					base *= base;
+			}
+
+			return invert ? DoubleDouble(1.0) / result : result;
+		}
+	}
+
+	DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		DoubleDouble high = twoSum(a.hi, b.hi);
+		if (!std::isfinite(high.hi))
+			return high.hi;
+
+		DoubleDouble low = twoSum(a.lo, b.lo);
+		high.lo += low.hi;
+		high = quickTwoSum(high.hi, high.lo);
+		high.lo += low.lo;
+		return quickTwoSum(high.hi, high.lo);
+	}
+
+	DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		return a + -b;
+	}
+
+	DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		DoubleDouble product = twoProduct(a.hi, b.hi);
+		if (!std::isfinite(product.hi))
+			return product.hi;
+
+		product.lo += a.hi * b.lo + a.lo * b.hi;
+		return quickTwoSum(product.hi, product.lo);
+	}
+
+	// long division, each step takes the next 53 bits of the quotient from what is left over
+	DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		double first = a.hi / b.hi;
+		if (!std::isfinite(first) || !std::isfinite(b.hi))
+			return first;
+
+		DoubleDouble remainder = a - b * first;
+		double second = remainder.hi / b.hi;
+		remainder -= b * second;
+		double third = remainder.hi / b.hi;
+
+		return quickTwoSum(first, second) + third;
+	}
+
+	bool isfinite(const DoubleDouble& value)
+	{
+		return std::isfinite(value.hi);
+	}
+
+	DoubleDouble fabs(const DoubleDouble& value)
+	{
+		return value.hi < 0.0 ? -value : DoubleDouble(std::fabs(value.hi), value.lo);
+	}
+
+	// one newton step from the double root doubles the number of correct bits
+	DoubleDouble sqrt(const DoubleDouble& value)
+	{
+		if (!(value.hi > 0.0) || !std::isfinite(value.hi))
+			return std::sqrt(value.hi);
+
+		double root = std::sqrt(value.hi);
+		DoubleDouble remainder = value - twoProduct(root, root);
+		return quickTwoSum(root, remainder.hi / (2.0 * root));
+	}
+
+	// exp(x) = 2^k * exp(r) with |r| <= ln 2 / 2; r is halved a few more times so the series is short,
+	// and the result squared back up as expm1, which keeps the small terms from being rounded away
+	DoubleDouble exp(const DoubleDouble& value)
+	{
+		if (!(value.hi <= maxExpArgument))
+			return value.hi > maxExpArgument ? std::numeric_limits<double>::infinity() : value.hi;
+
+		if (value.hi < minExpArgument)
+			return 0.0;
+
+		double k = std::nearbyint(value.hi / ln2.hi);
+		DoubleDouble r = value - ln2 * k;
+		r = { std::ldexp(r.hi, -expHalvings), std::ldexp(r.lo, -expHalvings) };
+
+		const auto& inverse = inverseFactorials();
+		DoubleDouble minusOne = r * polynomial(r, 9, [&](int j) { return inverse[j + 1]; });
+
+		for (int i = 0; i < expHalvings; i++)
+			minusOne = minusOne * (minusOne + 2.0);
+
+		DoubleDouble result = minusOne + 1.0;
+		int exponent = static_cast<int>(k);
+		return { std::ldexp(result.hi, exponent), std::ldexp(result.lo, exponent) };
+	}
+
+	// newton step on exp(y) = x from the double logarithm
+	DoubleDouble log(const DoubleDouble& value)
+	{
+		if (!(value.hi >= std::numeric_limits<double>::min()) || !std::isfinite(value.hi))
+			return std::log(value.hi);
+
+		double guess = std::log(value.hi);
+		return guess + value * exp(DoubleDouble(-guess)) - 1.0;
+	}
+
+	DoubleDouble sin(const DoubleDouble& value)
+	{
+		if (!(std::fabs(value.hi) <= maxReducedArgument))
+			return std::sin(value.hi);
+
+		int quadrant = 0;
+		DoubleDouble r = reduceQuadrant(value, quadrant);
+
+		switch (quadrant)
+		{
+		case 0: return sinSeries(r);
+		case 1: return cosSeries(r);
+		case 2: return -sinSeries(r);
+		default: return -cosSeries(r);
+		}
+	}
+
+	DoubleDouble cos(const DoubleDouble& value)
+	{
+		if (!(std::fabs(value.hi) <= maxReducedArgument))
+			return std::cos(value.hi);
+
+		int quadrant = 0;
+		DoubleDouble r = reduceQuadrant(value, quadrant);
+
+		switch (quadrant)
+		{
+		case 0: return cosSeries(r);
+		case 1: return -sinSeries(r);
+		case 2: return -cosSeries(r);
+		default: return sinSeries(r);
+		}
+	}
+
+	DoubleDouble tan(const DoubleDouble& value)
+	{
+		if (!(std::fabs(value.hi) <= maxReducedArgument))
+			return std::tan(value.hi);
+
+		int quadrant = 0;
+		DoubleDouble r = reduceQuadrant(value, quadrant);
+
+		// tan has period pi, odd quadrants are -cot(r)
+		return quadrant % 2 == 0 ? sinSeries(r) / cosSeries(r) : -cosSeries(r) / sinSeries(r);
+	}
+
+	// integral exponents multiply, so negative bases work; other exponents go through exp and log
+	DoubleDouble pow(const DoubleDouble& base, const DoubleDouble& exponent)
+	{
+		constexpr double maxIntegerExponent = 0x1p62;
+
+		if (exponent.lo == 0.0 && std::fabs(exponent.hi) <= maxIntegerExponent && std::floor(exponent.hi) == exponent.hi)
+			return integerPower(base, static_cast<long long>(exponent.hi));
+
+		if (!(base.hi > 0.0) || !std::isfinite(base.hi) || !std::isfinite(exponent.hi))
+			return std::pow(base.hi, exponent.hi);
+
+		return exp(exponent * log(base));
+	}
+}
\ No newline at end of file
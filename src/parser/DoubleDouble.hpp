@@ -0,0 +1,55 @@
+#pragma once
+
+namespace parser
+{
+	// unevaluated sum hi + lo of two doubles with |lo| <= ulp(hi) / 2, about 106 bits of mantissa.
+	// Every op rounds to roughly that precision; once hi is infinite or nan, lo is 0 and hi behaves
+	// like a plain double, so overflow and domain errors look the same as in the other types
+	struct DoubleDouble
+	{
+		double hi;
+		double lo;
+
+		static constexpr double epsilon = 0x1p-104; // relative rounding error of a single op
+
+		DoubleDouble() = default;
+		constexpr DoubleDouble(double value) : hi(value), lo(0.0) {}
+		constexpr DoubleDouble(double high, double low) : hi(high), lo(low) {}
+
+		// rounds to the nearest double
+		explicit operator double() const { return hi; }
+
+		DoubleDouble& operator+=(const DoubleDouble& other);
+		DoubleDouble& operator-=(const DoubleDouble& other);
+		DoubleDouble& operator*=(const DoubleDouble& other);
+		DoubleDouble& operator/=(const DoubleDouble& other);
+	};
+
+	inline DoubleDouble operator-(const DoubleDouble& value) { return { -value.hi, -value.lo }; }
+
+	DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b);
+	DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b);
+	DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b);
+	DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b);
+
+	inline DoubleDouble& DoubleDouble::operator+=(const DoubleDouble& other) { return *this = *this + other; }
+	inline DoubleDouble& DoubleDouble::operator-=(const DoubleDouble& other) { return *this = *this - other; }
+	inline DoubleDouble& DoubleDouble::operator*=(const DoubleDouble& other) { return *this = *this * other; }
+	inline DoubleDouble& DoubleDouble::operator/=(const DoubleDouble& other) { return *this = *this / other; }
+
+	// hi carries the sign and the magnitude, lo only matters between equal his
+	inline bool operator==(const DoubleDouble& a, const DoubleDouble& b) { return a.hi == b.hi && a.lo == b.lo; }
+	inline bool operator<(const DoubleDouble& a, const DoubleDouble& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+	inline bool operator<=(const DoubleDouble& a, const DoubleDouble& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo <= b.lo); }
+
+	// same names as <cmath> so templated evaluators find them by argument dependent lookup
+	bool isfinite(const DoubleDouble& value);
+	DoubleDouble fabs(const DoubleDouble& value);
+	DoubleDouble sqrt(const DoubleDouble& value);
+	DoubleDouble exp(const DoubleDouble& value);
+	DoubleDouble log(const DoubleDouble& value);
+	DoubleDouble sin(const DoubleDouble& value);
+	DoubleDouble cos(const DoubleDouble& value);
+	DoubleDouble tan(const DoubleDouble& value);
+	DoubleDouble pow(const DoubleDouble& base, const DoubleDouble& exponent);
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "ExpressionCache.hpp"
+#include "Optimizer.hpp"
+#include <utility>
+
+namespace parser
+{
+	ExpressionCache::ExpressionCache(std::size_t capacity)
+		: capacity(capacity) {}
+
+	std::shared_ptr<const CompiledExpression> ExpressionCache::get(Ast tree, bool optimized)
+	{
+		std::string key = canonicalForm(tree);
+		key.push_back(optimized ? 'o' : 'r');
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			auto found = entries.find(key);
+			if (found != entries.end())
+			{
+				hits++;
+				found->second.lastUse = ++clock;
+				return found->second.expression;
+			}
+		}
+
+		// compiling and jitting is the slow part, other lookups go on meanwhile
+		if (optimized)
+			tree = optimize(tree);
+
+		auto compiled = std::make_shared<const CompiledExpression>(std::move(tree));
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// another thread may have compiled the same expression in the meantime, keep the first one
+		auto [entry, inserted] = entries.try_emplace(key, Entry{ compiled, 0 });
+		entry->second.lastUse = ++clock;
+
+		if (inserted)
+		{
+			misses++;
+			evict(key);
+		}
+		else
+		{
+			hits++;
+		}
+
+		return entry->second.expression;
+	}
+
+	void ExpressionCache::evict(const std::string& keep)
+	{
+		while (entries.size() > capacity)
+		{
+			// only the cache holds an entry whose count is 1, and new references are only handed out under the lock
+			auto oldest = entries.end();
+			for (auto it = entries.begin(); it != entries.end(); ++it)
+			{
+				if (it->first == keep || it->second.expression.use_count() > 1)
+					continue;
+
+				if (oldest == entries.end() || it->second.lastUse < oldest->second.lastUse)
+					oldest = it;
+			}
+
+			// everything is in use, stay above capacity until some of it is released
+			if (oldest == entries.end())
+				return;
+
+			entries.erase(oldest);
+			evictions++;
+		}
+	}
+
+	void ExpressionCache::trim()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (auto it = entries.begin(); it != entries.end();)
+		{
+			if (it->second.expression.use_count() == 1)
+			{
+				it = entries.erase(it);
+				evictions++;
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	CacheStats ExpressionCache::stats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::size_t inUse = 0;
+		for (const auto& [key, entry] : entries)
+			if (entry.expression.use_count() > 1)
+				inUse++;
+
+		return { entries.size(), inUse, hits, misses, evictions };
+	}
+
+	ExpressionCache& expressionCache()
+	{
+		static ExpressionCache cache(expressionCacheCapacity);
+		return cache;
+	}
+}
\ No newline at end of file
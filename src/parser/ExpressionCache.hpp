@@ -0,0 +1,60 @@
+#pragma once
+#include "Ast.hpp"
+#include "CompiledExpression.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace parser
+{
+	constexpr std::size_t expressionCacheCapacity = 256;
+
+	struct CacheStats
+	{
+		std::size_t entries;
+		std::size_t inUse; // held outside the cache as well
+		std::size_t hits;
+		std::size_t misses;
+		std::size_t evictions;
+	};
+
+	// compiled expressions keyed by the canonical form of their parsed tree, so equivalent spellings
+	// share one compiled object. Entries are reference counted through their shared_ptr: once more
+	// than capacity are cached, the least recently used ones nobody else holds are evicted
+	class ExpressionCache
+	{
+	public:
+		explicit ExpressionCache(std::size_t capacity);
+
+		// the cached object for an equal tree compiled with the same optimizer setting,
+		// otherwise compiles the tree and caches the result
+		std::shared_ptr<const CompiledExpression> get(Ast tree, bool optimized);
+
+		// drops every entry nobody else holds
+		void trim();
+
+		CacheStats stats() const;
+	private:
+		struct Entry
+		{
+			std::shared_ptr<const CompiledExpression> expression;
+			std::uint64_t lastUse;
+		};
+
+		std::size_t capacity;
+		mutable std::mutex mutex;
+		std::unordered_map<std::string, Entry> entries;
+		std::uint64_t clock = 0;
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+		std::size_t evictions = 0;
+
+		void evict(const std::string& keep);
+	};
+
+	// shared by everything in the process that compiles expressions
+	ExpressionCache& expressionCache();
+}
\ No newline at end of file
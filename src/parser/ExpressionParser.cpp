@@ -1,182 +1,642 @@
 #include "ExpressionParser.hpp"
+#include "Derivative.hpp"
+#include "Definitions.hpp"
+#include "ExpressionCache.hpp"
+#include "Lexer.hpp"
+#include "Optimizer.hpp"
+#include "Parameters.hpp"
+#include "Summation.hpp"
+#include <algorithm>
 #include <cctype>
-#include <cmath>
+#include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace parser
 {
+	// operator precedence parsing with explicit stacks instead of recursion, so nesting depth is only
+	// limited by memory and every token is pushed and popped at most once. Loosest first: c ? a : b,
+	// comparisons, + -, * /, then ^; ?: and ^ are right associative. Signs bind to the operand right
+	// after them, -x^2 is (-x)^2
 	class ExpressionParser
 	{
 	public:
-		ExpressionParser(const std::string& str)
-			: input(str), pos(0), xValue(0.f) {}
+		// every token adds at most one node, so the dag only grows while parsing to inline functions.
+		// Parameter nodes hold the position of their name in parameters, see bindParameters
+		ExpressionParser(std::string_view str, std::vector<std::string>& parameters)
+			: lexer(str), parameters(parameters)
+		{
+			ast.reserve(str.size());
+		}
 
-		float evaluate(float x)
+		// body of a user-defined function: argument stands for x, which the body cannot use itself.
+		// callers are the functions being inlined around it, so one that reaches itself is an error
+		ExpressionParser(std::string_view str, std::string_view argument, std::vector<std::string> callers,
+			std::vector<std::string>& parameters)
+			: ExpressionParser(str, parameters)
 		{
-			xValue = x;
-			pos = 0;
-			return parseExpression();
+			this->argument = argument;
+			this->callers = std::move(callers);
+		}
+
+		Ast parse()
+		{
+			bool expectOperand = true;
+
+			while (true)
+			{
+				Token token = lexer.next();
+
+				if (expectOperand)
+				{
+					expectOperand = !parseOperand(token);
+					continue;
+				}
+
+				NodeType type;
+				int precedence;
+				if (binaryOperator(token.type, type, precedence))
+				{
+					// equal precedence reduces first for left associative operators only
+					while (!frames.empty() && frames.back().kind == FrameKind::Operator
+						&& (frames.back().precedence > precedence || (frames.back().precedence == precedence && type != NodeType::Power)))
+						reduce();
+
+					bool swapped = token.type == TokenType::Greater || token.type == TokenType::GreaterEqual;
+					frames.push_back({ FrameKind::Operator, type, precedence, swapped });
+					expectOperand = true;
+					continue;
+				}
+
+				// the condition is complete, everything but an enclosing ?: binds tighter
+				if (token.type == TokenType::Question)
+				{
+					while (!frames.empty() && frames.back().kind == FrameKind::Operator)
+						reduce();
+
+					frames.push_back({ FrameKind::Question, NodeType::Select, 0 });
+					expectOperand = true;
+					continue;
+				}
+
+				if (token.type == TokenType::Colon)
+				{
+					reduceOperators(false);
+					if (frames.empty() || frames.back().kind != FrameKind::Question)
+						throw std::runtime_error("Unexpected ':'");
+
+					frames.back().kind = FrameKind::Colon;
+					expectOperand = true;
+					continue;
+				}
+
+				if (token.type == TokenType::Comma)
+				{
+					reduceOperators();
+					if (frames.empty() || frames.back().kind != FrameKind::Call
+						|| frames.back().arguments + 1 >= argumentCount(frames.back().type))
+						throw std::runtime_error("Unexpected ','");
+
+					// the index is bound in the body, which follows the bounds
+					frames.back().arguments++;
+					if (isLoop(frames.back().type) && frames.back().arguments == 3)
+						indices.back().open = true;
+
+					expectOperand = true;
+					continue;
+				}
+
+				if (token.type == TokenType::RightParen && openGroups > 0)
+				{
+					reduceOperators();
+
+					Frame group = frames.back();
+					frames.pop_back();
+					openGroups--;
+
+					if (group.kind == FrameKind::Call)
+						finishCall(group);
+
+					if (group.kind == FrameKind::Inline)
+					{
+						values.back() = substitute(bodies.back(), values.back());
+						bodies.pop_back();
+					}
+
+					// the group is an operand itself
+					applySigns();
+					continue;
+				}
+
+				if (openGroups > 0)
+					throw std::runtime_error("Missing ')'");
+
+				if (token.type != TokenType::End)
+					throw std::runtime_error("Unexpected token");
+
+				reduceOperators();
+				ast.root = values.back();
+				return std::move(ast);
+			}
 		}
 	private:
-		std::string input;
-		size_t pos;
-		float xValue;
+		enum class FrameKind : std::uint8_t
+		{
+			Operator, // binary operator waiting for its right operand
+			Sign, // unary minus waiting for its operand
+			Group, // open parenthesis
+			Call, // open parenthesis of a function call
+			Inline, // open parenthesis of a call to a user-defined function, its body is on bodies
+			Question, // ? waiting for the value if true
+			Colon // : waiting for the value if false, the condition and the value if true are on values
+		};
 
-		// helpers
+		struct Frame
+		{
+			FrameKind kind;
+			NodeType type;
+			int precedence; // operators only
+			bool swapped = false; // operators only, a > b is built as b < a
+			int arguments = 0; // calls only, commas read so far
+		};
 
-		void skipWhitespace()
+		// index of a sum or product whose call is being read
+		struct Binding
 		{
-			while (pos < input.size() && std::isspace(input[pos]))
-				pos++;
-		}
+			std::string_view name;
+			int level;
+			bool open = false; // in its body, the bounds cannot use it
+		};
+
+		Lexer lexer;
+		std::vector<std::string>& parameters; // shared with the parsers of inlined functions
+		std::string_view argument;
+		std::vector<std::string> callers;
+		Ast ast;
+		std::vector<Ast> bodies;
+		std::vector<NodeId> values;
+		std::vector<Frame> frames;
+		std::vector<Binding> indices;
+		std::vector<std::uint32_t> dependencies; // of the nodes seen by varies so far, see there
+		std::size_t openGroups = 0;
+
+		// helpers
 
-		bool match(char c)
+		bool match(TokenType type)
 		{
-			skipWhitespace();
-			if (pos < input.size() && input[pos] == c)
+			if (lexer.peek().type == type)
 			{
-				pos++;
+				lexer.next();
 				return true;
 			}
 
 			return false;
 		}
 
-		float parseExpression()
+		NodeId makeNode(NodeType type, NodeId lhs = 0, NodeId rhs = 0, NodeId third = 0)
 		{
-			float value = parseTerm();
+			return ast.add({ type, 0.0, lhs, rhs, third });
+		}
 
-			while (true)
+		static bool isLoop(NodeType function)
+		{
+			return function == NodeType::Sum || function == NodeType::Product;
+		}
+
+		// step(a) is built as 0 <= a, so its type is LessEqual; the index of a sum is one more argument
+		static int argumentCount(NodeType function)
+		{
+			if (isLoop(function))
+				return 4;
+
+			return function == NodeType::LessEqual ? 1 : arity(function);
+		}
+
+		// number of bodies of sums and products around the token read last
+		int openLevels() const
+		{
+			return static_cast<int>(std::count_if(indices.begin(), indices.end(), [](const Binding& index) {
+				return index.open;
+			}));
+		}
+
+		static bool binaryOperator(TokenType token, NodeType& type, int& precedence)
+		{
+			switch (token)
+			{
+			case TokenType::Less: type = NodeType::Less; precedence = 1; return true;
+			case TokenType::LessEqual: type = NodeType::LessEqual; precedence = 1; return true;
+			case TokenType::Greater: type = NodeType::Less; precedence = 1; return true;
+			case TokenType::GreaterEqual: type = NodeType::LessEqual; precedence = 1; return true;
+			case TokenType::Plus: type = NodeType::Add; precedence = 2; return true;
+			case TokenType::Minus: type = NodeType::Subtract; precedence = 2; return true;
+			case TokenType::Star: type = NodeType::Multiply; precedence = 3; return true;
+			case TokenType::Slash: type = NodeType::Divide; precedence = 3; return true;
+			case TokenType::Caret: type = NodeType::Power; precedence = 4; return true;
+			default: return false;
+			}
+		}
+
+		// returns true once a complete operand has been read, signs and open parentheses need more
+		bool parseOperand(const Token& token)
+		{
+			switch (token.type)
 			{
-				skipWhitespace();
-				if (match('+')) value += parseTerm();
-				else if (match('-')) value -= parseTerm();
-				else break;
+			case TokenType::Minus:
+				frames.push_back({ FrameKind::Sign, NodeType::Negate, 0 });
+				return false;
+
+			case TokenType::Plus:
+				return false;
+
+			case TokenType::LeftParen:
+				frames.push_back({ FrameKind::Group, NodeType::Constant, 0 });
+				openGroups++;
+				return false;
+
+			case TokenType::Function:
+				if (!match(TokenType::LeftParen))
+					throw std::runtime_error("Expected '(' after function");
+
+				frames.push_back({ FrameKind::Call, token.function, 0 });
+				openGroups++;
+
+				if (isLoop(token.function))
+					bindIndex();
+				return false;
+
+			case TokenType::Number:
+				values.push_back(ast.add({ NodeType::Constant, token.value, 0, 0 }));
+				break;
+
+			case TokenType::Variable:
+				if (!argument.empty() && argument != token.text)
+					throw std::runtime_error("x is not the argument of the function, it cannot be used in its body");
+
+				values.push_back(makeNode(NodeType::Variable));
+				break;
+
+			// user-defined functions are called, other names are parameters
+			case TokenType::Identifier:
+				if (match(TokenType::LeftParen))
+				{
+					bodies.push_back(parseCallee(token.text));
+					frames.push_back({ FrameKind::Inline, NodeType::Constant, 0 });
+					openGroups++;
+					return false;
+				}
+
+				if (const Binding* index = findIndex(token.text))
+				{
+					if (!index->open)
+						throw std::runtime_error("The bounds of a sum or product cannot use its index");
+
+					values.push_back(ast.add({ NodeType::Index, static_cast<double>(index->level), 0, 0 }));
+				}
+				else if (token.text == argument)
+					values.push_back(makeNode(NodeType::Variable));
+				else
+					values.push_back(makeNode(NodeType::Parameter, parameterIndex(token.text)));
+				break;
+
+			default:
+				throw std::runtime_error("Unexpected token");
 			}
 
-			return value;
+			applySigns();
+			return true;
 		}
 
-		float parseTerm()
+		// the name after sum( and prod( and its comma count as the first argument
+		void bindIndex()
 		{
-			float value = parseFactor();
+			Token name = lexer.next();
+			if (name.type != TokenType::Identifier || name.text == argument)
+				throw std::runtime_error("Expected the name of the index");
 
-			while (true)
+			if (lexer.next().type != TokenType::Comma)
+				throw std::runtime_error("Expected ',' after the index");
+
+			int level = openLevels();
+			if (level >= maxLoopLevels)
+				throw std::runtime_error("Sums and products nest too deep");
+
+			indices.push_back({ name.text, level });
+			frames.back().arguments = 1;
+		}
+
+		// innermost first, an index shadows the ones around it and parameters of the same name
+		const Binding* findIndex(std::string_view name) const
+		{
+			for (auto index = indices.rbegin(); index != indices.rend(); ++index)
 			{
-				skipWhitespace();
-				if (match('*')) value *= parseFactor();
-				else if (match('/')) value /= parseFactor();
-				else break;
+				if (index->name == name)
+					return &*index;
 			}
 
-			return value;
+			return nullptr;
 		}
 
-		float parseFactor()
+		// whether a bound depends on x or on the index of a sum around it, it has to be the same for all samples.
+		// Bit d is the index of level d as in freeIndices, the bit above the levels is x; nodes only ever
+		// come after their operands, so each call extends the bits over the nodes added since the last one
+		bool varies(NodeId bound)
 		{
-			float value = parseUnary();
+			constexpr std::uint32_t variable = 1u << maxLoopLevels;
 
-			skipWhitespace();
-			if (match('^'))
+			for (NodeId id = static_cast<NodeId>(dependencies.size()); id < ast.size(); id++)
 			{
-				value = std::pow(value, parseFactor());
+				const Node& node = ast[id];
+				int operands = arity(node.type);
+
+				std::uint32_t bits = 0;
+				if (node.type == NodeType::Variable)
+					bits = variable;
+				if (node.type == NodeType::Index)
+					bits = 1u << static_cast<int>(node.value);
+				if (operands >= 1) bits |= dependencies[node.lhs];
+				if (operands >= 2) bits |= dependencies[node.rhs];
+
+				// the body's own index is bound, the bounds see the indices around the sum
+				if (node.type == NodeType::Sum || node.type == NodeType::Product)
+					bits |= dependencies[node.third] & ~(1u << static_cast<int>(node.value));
+				else if (operands == 3)
+					bits |= dependencies[node.third];
+
+				dependencies.push_back(bits);
 			}
 
-			return value;
+			return dependencies[bound] != 0;
 		}
 
-		float parseUnary()
+		Ast parseCallee(std::string_view name)
 		{
-			skipWhitespace();
-			if (match('-')) return -parseUnary();
-			if (match('+')) return parseUnary();
-			return parsePrimary();
+			if (std::find(callers.begin(), callers.end(), name) != callers.end())
+				throw std::runtime_error("Function " + std::string(name) + " calls itself");
+
+			FunctionDefinition definition;
+			if (!lookupDefinition(name, definition))
+				throw std::runtime_error("Unknown function: " + std::string(name));
+
+			std::vector<std::string> chain = callers;
+			chain.emplace_back(name);
+			return ExpressionParser(definition.body, definition.argument, std::move(chain), parameters).parse();
 		}
 
-		float parsePrimary()
+		// slots are only taken once the whole parse succeeds, so failed input does not use them up
+		NodeId parameterIndex(std::string_view name)
 		{
-			skipWhitespace();
+			auto found = std::find(parameters.begin(), parameters.end(), name);
+			if (found != parameters.end())
+				return static_cast<NodeId>(found - parameters.begin());
+
+			if (parameters.size() == maxParameters)
+				throw std::runtime_error("Too many parameters");
 
-			// number
-			if (std::isdigit(input[pos]) || input[pos] == '.')
+			parameters.emplace_back(name);
+			return static_cast<NodeId>(parameters.size() - 1);
+		}
+
+		// copies an inlined body into this dag with the argument in place of x, so constant folding and
+		// merging of shared subexpressions work across the call like anywhere else. The sums of the body
+		// move in by the levels around the call, the argument may use their indices
+		NodeId substitute(const Ast& body, NodeId value)
+		{
+			int levels = openLevels();
+			std::vector<NodeId> mapped(body.size());
+			for (NodeId id = 0; id < body.size(); id++)
 			{
-				return parseNumber();
+				Node node = body[id];
+				if (node.type == NodeType::Variable)
+				{
+					mapped[id] = value;
+					continue;
+				}
+
+				if (isLoop(node.type) || node.type == NodeType::Index)
+				{
+					node.value += levels;
+					if (node.value >= maxLoopLevels)
+						throw std::runtime_error("Sums and products nest too deep");
+				}
+
+				int operands = arity(node.type);
+				if (operands >= 1) node.lhs = mapped[node.lhs];
+				if (operands >= 2) node.rhs = mapped[node.rhs];
+				if (operands == 3) node.third = mapped[node.third];
+				mapped[id] = ast.add(node);
 			}
 
-			// variable x
-			if (match('x'))
+			return mapped[body.root];
+		}
+
+		void applySigns()
+		{
+			while (!frames.empty() && frames.back().kind == FrameKind::Sign)
 			{
-				return xValue;
+				values.back() = makeNode(NodeType::Negate, values.back());
+				frames.pop_back();
 			}
+		}
 
-			// function
-			if (std::isalpha(input[pos]))
-			{
-				std::string name = parseIdentifier();
-				if (!match('('))
-					throw std::runtime_error("Expected '(' after function");
+		void finishCall(const Frame& call)
+		{
+			if (call.arguments + 1 != argumentCount(call.type))
+				throw std::runtime_error("Wrong number of arguments");
 
-				float arg = parseExpression();
+			if (isLoop(call.type))
+			{
+				NodeId body = values.back();
+				values.pop_back();
+				NodeId last = values.back();
+				values.pop_back();
+
+				if (varies(values.back()) || varies(last))
+					throw std::runtime_error("The bounds of a sum or product cannot depend on x or an index");
+
+				double level = indices.back().level;
+				indices.pop_back();
+				values.back() = ast.add({ call.type, level, values.back(), last, body });
+				return;
+			}
 
-				if (!match(')'))
-					throw std::runtime_error("Missing ')'");
+			if (call.type == NodeType::LessEqual)
+			{
+				values.back() = makeNode(NodeType::LessEqual, ast.add({ NodeType::Constant, 0.0, 0, 0 }), values.back());
+				return;
+			}
 
-				return applyFunction(name, arg);
+			if (call.arguments == 0)
+			{
+				values.back() = makeNode(call.type, values.back());
+				return;
 			}
 
-			if (match('('))
+			NodeId rhs = values.back();
+			values.pop_back();
+			values.back() = makeNode(call.type, values.back(), rhs);
+		}
+
+		void reduce()
+		{
+			Frame frame = frames.back();
+			frames.pop_back();
+
+			NodeId rhs = values.back();
+			values.pop_back();
+
+			if (frame.kind == FrameKind::Colon)
 			{
-				float value = parseExpression();
-				if (!match(')'))
-					throw std::runtime_error("Missing ')");
-				return value;
+				NodeId then = values.back();
+				values.pop_back();
+				values.back() = makeNode(NodeType::Select, values.back(), then, rhs);
+				return;
 			}
 
-			throw std::runtime_error("Unexpected token");
+			if (frame.swapped)
+				values.back() = makeNode(frame.type, rhs, values.back());
+			else
+				values.back() = makeNode(frame.type, values.back(), rhs);
+		}
+
+		// up to the innermost open parenthesis. A ? without its : is an error unless the : is next
+		void reduceOperators(bool complete = true)
+		{
+			while (!frames.empty() && (frames.back().kind == FrameKind::Operator || frames.back().kind == FrameKind::Colon))
+				reduce();
+
+			if (complete && !frames.empty() && frames.back().kind == FrameKind::Question)
+				throw std::runtime_error("Missing ':'");
 		}
+	};
 
-		float parseNumber()
+	namespace
+	{
+		// the tree with the slots of the parameters in place of the positions of their names
+		Ast bindParameters(const Ast& ast, const std::vector<std::string>& parameters)
 		{
-			skipWhitespace();
-			size_t start = pos;
+			if (parameters.empty())
+				return ast;
+
+			std::vector<std::uint32_t> slots;
+			slots.reserve(parameters.size());
+			for (const std::string& name : parameters)
+				slots.push_back(parameterSlot(name));
 
-			while (pos < input.size() && (std::isdigit(input[pos]) || input[pos] == '.'))
+			Ast tree;
+			tree.reserve(ast.size());
+
+			std::vector<NodeId> mapped(ast.size());
+			for (NodeId id = 0; id < ast.size(); id++)
 			{
-				pos++;
+				Node node = ast[id];
+
+				int operands = arity(node.type);
+				if (node.type == NodeType::Parameter) node.lhs = slots[node.lhs];
+				if (operands >= 1) node.lhs = mapped[node.lhs];
+				if (operands >= 2) node.rhs = mapped[node.rhs];
+				if (operands == 3) node.third = mapped[node.third];
+
+				mapped[id] = tree.add(node);
 			}
 
-			return std::stof(input.substr(start, pos - start));
+			tree.root = mapped[ast.root];
+			return tree;
 		}
+	}
+
+	Ast parseTree(std::string_view expression)
+	{
+		std::vector<std::string> parameters;
+		ExpressionParser parser(expression, parameters);
+		return bindParameters(parser.parse(), parameters);
+	}
+
+	Ast parseFunctionBody(std::string_view name, std::string_view argument, std::string_view body)
+	{
+		std::vector<std::string> parameters;
+		ExpressionParser parser(body, argument, { std::string(name) }, parameters);
+		return bindParameters(parser.parse(), parameters);
+	}
 
-		std::string parseIdentifier()
+	namespace
+	{
+		void skipSpaces(std::string_view& text)
+		{
+			while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+				text.remove_prefix(1);
+		}
+
+		// digits at the front of text, 1 if there are none
+		int takeOrder(std::string_view& text)
 		{
-			size_t start = pos;
-			while (pos < input.size() && std::isalpha(input[pos]))
+			if (text.empty() || !std::isdigit(static_cast<unsigned char>(text.front())))
+				return 1;
+
+			int order = 0;
+			while (!text.empty() && std::isdigit(static_cast<unsigned char>(text.front())))
 			{
-				pos++;
+				order = std::min(order * 10 + (text.front() - '0'), maxDerivativeOrder + 1);
+				text.remove_prefix(1);
 			}
 
-			return input.substr(start, pos - start);
+			return order;
 		}
 
-		float applyFunction(const std::string& name, float value)
+		bool takePrefix(std::string_view& text, std::string_view prefix)
 		{
-			if (name == "sin") return std::sin(value);
-			if (name == "cos") return std::cos(value);
-			if (name == "tan") return std::tan(value);
-			if (name == "log") return std::log(value);
-			if (name == "exp") return std::exp(value);
-			if (name == "sqrt") return std::sqrt(value);
+			if (text.substr(0, prefix.size()) != prefix)
+				return false;
 
-			throw std::runtime_error("Unknown function: " + name);
+			text.remove_prefix(prefix.size());
+			return true;
 		}
-	};
+	}
 
-	std::function<float(float)> parseExpression(const std::string& expression)
+	int derivativeOrder(std::string_view& expression)
 	{
-		return [expression](float x) {
-			ExpressionParser parser(expression);
-			return parser.evaluate(x);
+		std::string_view text = expression;
+		skipSpaces(text);
+
+		// taken as the prefix even if d and dx are also used as parameters
+		if (!takePrefix(text, "d"))
+			return 0;
+
+		int order = takeOrder(text);
+		if (!takePrefix(text, "/dx"))
+			return 0;
+
+		int denominator = takeOrder(text);
+		if (order != denominator)
+			throw std::runtime_error("Derivative orders do not match: use d" + std::to_string(order)
+				+ "/dx" + std::to_string(order));
+
+		if (order < 1 || order > maxDerivativeOrder)
+			throw std::runtime_error("Derivative order must be between 1 and " + std::to_string(maxDerivativeOrder));
+
+		expression = text;
+		return order;
+	}
+
+	std::shared_ptr<const CompiledExpression> compileExpression(std::string_view expression)
+	{
+		int order = derivativeOrder(expression);
+
+		Ast tree = parseTree(expression);
+		if (order > 0)
+			tree = differentiate(tree, order);
+
+		return expressionCache().get(std::move(tree), optimizeEnabled());
+	}
+
+	std::function<float(float)> parseExpression(std::string_view expression)
+	{
+		auto compiled = compileExpression(expression);
+
+		return [compiled](float x) {
+			return compiled->evaluate(x);
 		};
 	}
 }
\ No newline at end of file
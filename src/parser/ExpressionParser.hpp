@@ -1,8 +1,30 @@
 #pragma once
-#include <string>
+#include "Ast.hpp"
+#include "CompiledExpression.hpp"
+#include <string_view>
 #include <functional>
+#include <memory>
 
 namespace parser
 {
-	std::function<float(float)> parseExpression(const std::string& expression);
+	// parses the expression once; throws std::runtime_error on syntax errors. A leading d/dx or
+	// dn/dxn compiles the n-th derivative instead (d2/dx2 sin(x)*x^2). Names other than x and the
+	// built-in and user-defined functions are parameters, read each time the expression runs (see
+	// Parameters.hpp). Calls to user-defined functions are inlined (see Definitions.hpp).
+	// sum(k, a, b, f) and prod(k, a, b, f) compile to loops over k (see Summation.hpp).
+	// Equivalent expressions return the same object from the process-wide cache. Safe to call from any
+	// thread, and the object returned can be evaluated from any number of them at once
+	std::shared_ptr<const CompiledExpression> compileExpression(std::string_view expression);
+
+	// removes a leading d/dx or dn/dxn from the expression and returns n, 0 if there is none
+	int derivativeOrder(std::string_view& expression);
+
+	// the tree as parsed, before any optimization
+	Ast parseTree(std::string_view expression);
+
+	// body of the user-defined function name with argument in place of x. Throws if it uses x or calls
+	// name itself, also through other functions
+	Ast parseFunctionBody(std::string_view name, std::string_view argument, std::string_view body);
+
+	std::function<float(float)> parseExpression(std::string_view expression);
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "FusedPlan.hpp"
+#include "Compiler.hpp"
+#include "VirtualMachine.hpp"
+
+namespace parser
+{
+	// only the code of the new function is compiled and appended, it loads what the others left in slots.
+	// The native code keeps every output in a register up to the end, so it is generated again
+	std::size_t FusedPlan::add(const CompiledExpression& expression)
+	{
+		import(expression);
+		appendRoot(bytecode, ast, roots, stored);
+		translate();
+		return roots.size() - 1;
+	}
+
+	void FusedPlan::assign(const std::vector<const CompiledExpression*>& expressions)
+	{
+		clear();
+		for (const CompiledExpression* expression : expressions)
+			import(*expression);
+
+		if (!roots.empty())
+			build();
+	}
+
+	void FusedPlan::import(const CompiledExpression& expression)
+	{
+		const Ast& tree = expression.tree();
+
+		// operands come first, so their ids in the plan are always known
+		std::vector<NodeId> mapped(tree.size());
+		for (NodeId id = 0; id < tree.size(); id++)
+		{
+			Node node = tree[id];
+			int operands = arity(node.type);
+			if (operands >= 1) node.lhs = mapped[node.lhs];
+			if (operands >= 2) node.rhs = mapped[node.rhs];
+			if (operands == 3) node.third = mapped[node.third];
+
+			mapped[id] = ast.add(node);
+		}
+
+		roots.push_back(mapped[tree.root]);
+		piecePrograms.push_back(expression.pieces());
+		separateNodes += tree.size();
+	}
+
+	void FusedPlan::build()
+	{
+		bytecode = compile(ast, roots, stored);
+		translate();
+	}
+
+	void FusedPlan::translate()
+	{
+		native = jit::compileNative(bytecode);
+		fastNative = usesFastMath(bytecode) ? jit::compileNative(bytecode, MathTier::Fast) : nullptr;
+	}
+
+	void FusedPlan::clear()
+	{
+		ast = Ast();
+		roots.clear();
+		piecePrograms.clear();
+		bytecode = Program();
+		stored.clear();
+		native.reset();
+		fastNative.reset();
+		separateNodes = 0;
+	}
+
+	void FusedPlan::evaluate(const float* xs, float* const* ys, std::size_t count, MathTier tier) const
+	{
+		if (roots.empty())
+			return;
+
+		const jit::NativeFunction* code = tier == MathTier::Fast && fastNative ? fastNative.get() : native.get();
+		if (code)
+		{
+			code->evaluate(xs, ys, count);
+			return;
+		}
+
+		executeBatch(bytecode, xs, ys, count, tier);
+	}
+
+	void FusedPlan::evaluate(const double* xs, double* const* ys, std::size_t count) const
+	{
+		if (!roots.empty())
+			executeBatch(bytecode, xs, ys, count);
+	}
+
+	void FusedPlan::evaluate(const long double* xs, long double* const* ys, std::size_t count) const
+	{
+		if (!roots.empty())
+			executeBatch(bytecode, xs, ys, count);
+	}
+
+	void FusedPlan::evaluate(const DoubleDouble* xs, DoubleDouble* const* ys, std::size_t count) const
+	{
+		if (!roots.empty())
+			executeBatch(bytecode, xs, ys, count);
+	}
+}
\ No newline at end of file
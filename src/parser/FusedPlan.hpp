@@ -0,0 +1,64 @@
+#pragma once
+#include "Ast.hpp"
+#include "Bytecode.hpp"
+#include "CompiledExpression.hpp"
+#include "VirtualMachine.hpp"
+#include "jit/NativeCode.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace parser
+{
+	// all plotted functions merged into one dag and compiled to a single program with one output
+	// per function, so subexpressions shared between functions are computed once per batch of x
+	class FusedPlan
+	{
+	public:
+		// imports the nodes of the expression the plan does not know yet and appends its code to the
+		// program; returns the function's output index
+		std::size_t add(const CompiledExpression& expression);
+
+		// replaces the functions of the plan, compiled once for all of them
+		void assign(const std::vector<const CompiledExpression*>& expressions);
+
+		void clear();
+
+		std::size_t size() const { return roots.size(); }
+
+		// ys[k] receives function k; xs may alias any of them. Only float runs in native code
+		// and has the fast math tier. Runs in the calling thread's scratch, threads may share a plan
+		// as long as none of them adds to it or clears it meanwhile
+		void evaluate(const float* xs, float* const* ys, std::size_t count, MathTier tier = MathTier::Full) const;
+		void evaluate(const double* xs, double* const* ys, std::size_t count) const;
+		void evaluate(const long double* xs, long double* const* ys, std::size_t count) const;
+		void evaluate(const DoubleDouble* xs, DoubleDouble* const* ys, std::size_t count) const;
+
+		const Program& program() const { return bytecode; }
+
+		// the merged dag and the root of every function in it
+		const Ast& tree() const { return ast; }
+		const std::vector<NodeId>& outputs() const { return roots; }
+
+		// pieces of function k, as CompiledExpression::pieces
+		const Program& pieces(std::size_t k) const { return piecePrograms[k]; }
+		const jit::NativeFunction* nativeCode() const { return native.get(); } // nullptr when interpreted
+
+		// nodes saved compared to evaluating every function on its own
+		std::size_t sharedNodes() const { return separateNodes - ast.size(); }
+	private:
+		Ast ast;
+		std::vector<NodeId> roots;
+		Program bytecode;
+		std::vector<std::uint32_t> stored; // slot of each node when the program ends, see appendRoot
+		std::vector<Program> piecePrograms;
+		std::unique_ptr<const jit::NativeFunction> native;
+		std::unique_ptr<const jit::NativeFunction> fastNative; // only if the fast tier changes anything
+		std::size_t separateNodes = 0;
+
+		void import(const CompiledExpression& expression);
+		void build();
+		void translate();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,412 @@
+#include "Interval.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace parser
+{
+	namespace
+	{
+		constexpr double infinity = std::numeric_limits<double>::infinity();
+		constexpr double pi = 3.14159265358979323846;
+
+		// + - * / and sqrt are correctly rounded, one ulp outward is enough for them. libm's
+		// transcendental functions are not, their bounds are widened a little further
+		constexpr int libmUlps = 2;
+
+		// relative error allowed for when locating extrema and poles of the trig functions
+		constexpr double periodSlack = 1e-13;
+
+		// largest exponent still told apart as integral, odd or even
+		constexpr double maxIntegerExponent = 0x1p53;
+
+		double down(double value, int ulps = 1)
+		{
+			for (int i = 0; i < ulps; i++)
+				value = std::nextafter(value, -infinity);
+
+			return value;
+		}
+
+		double up(double value, int ulps = 1)
+		{
+			for (int i = 0; i < ulps; i++)
+				value = std::nextafter(value, infinity);
+
+			return value;
+		}
+
+		// a bound that came out nan, like inf - inf, could have been anything
+		Interval outward(double lo, double hi, int ulps = 1)
+		{
+			return { std::isnan(lo) ? -infinity : down(lo, ulps), std::isnan(hi) ? infinity : up(hi, ulps) };
+		}
+
+		// the bounds of a sum, widened by an ulp unless the sum is exact, like one with a zero term.
+		// The rounding error comes from Knuth's two-sum; a nan bound, like inf - inf, could have been anything
+		double sumDown(double a, double b)
+		{
+			double sum = a + b;
+			double bVirtual = sum - a;
+			bool exact = std::isfinite(sum) && (a - (sum - bVirtual)) + (b - bVirtual) == 0.0;
+			return std::isnan(sum) ? -infinity : exact ? sum : down(sum);
+		}
+
+		double sumUp(double a, double b)
+		{
+			return -sumDown(-a, -b);
+		}
+
+		// result of an op on operands of which one is partial, or that leaves its domain for part of them
+		Interval carry(Interval result, bool partial)
+		{
+			result.partial = result.partial || partial;
+			return result;
+		}
+
+		bool isFinite(const Interval& value)
+		{
+			return std::isfinite(value.lo) && std::isfinite(value.hi);
+		}
+
+		// smallest range holding both, partial if either is
+		Interval hull(const Interval& a, const Interval& b)
+		{
+			if (std::isnan(a.lo)) return b;
+			if (std::isnan(b.lo)) return a;
+			return carry({ std::min(a.lo, b.lo), std::max(a.hi, b.hi) }, a.partial || b.partial);
+		}
+
+		// a zero factor makes a bound exactly 0, also times inf since the infinite bound is never reached.
+		// Other products are rounded and widened by an ulp
+		double productDown(double a, double b)
+		{
+			return a == 0.0 || b == 0.0 ? 0.0 : down(a * b);
+		}
+
+		double productUp(double a, double b)
+		{
+			return a == 0.0 || b == 0.0 ? 0.0 : up(a * b);
+		}
+
+		Interval reciprocal(const Interval& value)
+		{
+			if (value.lo > 0.0 || value.hi < 0.0)
+				return outward(1.0 / value.hi, 1.0 / value.lo);
+
+			// the pole is an edge or lies inside. Zeros carry no sign here and 1 / 0 may be infinite of either sign
+			return Interval::entire();
+		}
+
+		// conservatively true if the interval may contain offset + k * period for an integer k
+		bool containsPeriodic(const Interval& value, double offset, double period)
+		{
+			double low = (value.lo - offset) / period;
+			double high = (value.hi - offset) / period;
+			double slack = (std::max(std::fabs(low), std::fabs(high)) + 1.0) * periodSlack;
+
+			return std::floor(high + slack) >= std::ceil(low - slack);
+		}
+
+		// sin and cos: libm at the edges, widened to 1 and -1 where a maximum or minimum may lie between
+		template <typename Function>
+		Interval wave(const Interval& value, double maximumAt, double minimumAt, Function&& function)
+		{
+			if (!std::isfinite(value.lo) || !std::isfinite(value.hi) || value.hi - value.lo >= 2.0 * pi)
+				return { -1.0, 1.0 };
+
+			double a = function(value.lo);
+			double b = function(value.hi);
+			Interval result = outward(std::min(a, b), std::max(a, b), libmUlps);
+
+			if (containsPeriodic(value, maximumAt, 2.0 * pi))
+				result.hi = 1.0;
+
+			if (containsPeriodic(value, minimumAt, 2.0 * pi))
+				result.lo = -1.0;
+
+			return { std::max(result.lo, -1.0), std::min(result.hi, 1.0) };
+		}
+
+		// x^n for integral n, defined for negative bases too
+		Interval integerPower(const Interval& base, double n)
+		{
+			// pow(x, 0) is 1 even for nan and infinity
+			if (n == 0.0)
+				return 1.0;
+
+			double m = std::fabs(n);
+			double a = std::pow(base.lo, m);
+			double b = std::pow(base.hi, m);
+
+			Interval result;
+			if (std::fmod(m, 2.0) == 1.0)
+				result = outward(a, b, libmUlps);
+			else if (base.lo >= 0.0)
+				result = outward(a, b, libmUlps);
+			else if (base.hi <= 0.0)
+				result = outward(b, a, libmUlps);
+			else
+				result = { 0.0, up(std::max(a, b), libmUlps) };
+
+			// even powers never go below 0
+			if (std::fmod(m, 2.0) == 0.0)
+				result.lo = std::max(result.lo, 0.0);
+
+			return n > 0.0 ? result : reciprocal(result);
+		}
+
+		// x^y for exponents that are not a single integer
+		Interval realPower(const Interval& base, const Interval& exponent)
+		{
+			// a range of exponents holding an integer reaches negative bases in between
+			if (base.lo < 0.0 && std::floor(exponent.hi) >= std::ceil(exponent.lo))
+				return Interval::entire();
+
+			// pow(-inf, y) is 0 or infinity whatever y is
+			Interval atInfinity = base.lo == -infinity ? Interval(0.0, infinity) : Interval::empty();
+			if (base.hi < 0.0)
+				return atInfinity;
+
+			// x^y = exp(y * log(x)), log(0) taken as -infinity so 0^y comes out as 0 or infinity
+			double low = std::max(base.lo, 0.0);
+			Interval logarithm = {
+				low > 0.0 ? down(std::log(low), libmUlps) : -infinity,
+				base.hi > 0.0 ? up(std::log(base.hi), libmUlps) : -infinity
+			};
+
+			return hull(exp(exponent * logarithm), atInfinity);
+		}
+	}
+
+	Interval Interval::empty()
+	{
+		constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+		return { nan, nan };
+	}
+
+	Interval Interval::entire()
+	{
+		return { -infinity, infinity };
+	}
+
+	bool isEmpty(const Interval& value)
+	{
+		return std::isnan(value.lo);
+	}
+
+	bool contains(const Interval& value, double x)
+	{
+		return value.lo <= x && x <= value.hi;
+	}
+
+	bool overlaps(const Interval& a, const Interval& b)
+	{
+		return !isEmpty(a) && !isEmpty(b) && a.lo <= b.hi && b.lo <= a.hi;
+	}
+
+	Interval operator-(const Interval& value)
+	{
+		return carry({ -value.hi, -value.lo }, value.partial);
+	}
+
+	Interval operator+(const Interval& a, const Interval& b)
+	{
+		if (isEmpty(a) || isEmpty(b))
+			return Interval::empty();
+
+		// inf - inf is nan
+		bool opposite = (a.hi == infinity && b.lo == -infinity) || (a.lo == -infinity && b.hi == infinity);
+		return carry({ sumDown(a.lo, b.lo), sumUp(a.hi, b.hi) }, a.partial || b.partial || opposite);
+	}
+
+	Interval operator-(const Interval& a, const Interval& b)
+	{
+		return a + -b;
+	}
+
+	Interval operator*(const Interval& a, const Interval& b)
+	{
+		if (isEmpty(a) || isEmpty(b))
+			return Interval::empty();
+
+		double lo = std::min({ productDown(a.lo, b.lo), productDown(a.lo, b.hi), productDown(a.hi, b.lo), productDown(a.hi, b.hi) });
+		double hi = std::max({ productUp(a.lo, b.lo), productUp(a.lo, b.hi), productUp(a.hi, b.lo), productUp(a.hi, b.hi) });
+
+		// the points are nan at 0 * inf though
+		bool undefined = (contains(a, 0.0) && !isFinite(b)) || (contains(b, 0.0) && !isFinite(a));
+		return carry({ lo, hi }, a.partial || b.partial || undefined);
+	}
+
+	Interval operator/(const Interval& a, const Interval& b)
+	{
+		if (isEmpty(a) || isEmpty(b))
+			return Interval::empty();
+
+		return a * carry(reciprocal(b), b.partial);
+	}
+
+	// negative arguments are outside the domain and dropped
+	Interval sqrt(const Interval& value)
+	{
+		if (isEmpty(value) || value.hi < 0.0)
+			return Interval::empty();
+
+		return carry({ std::max(down(std::sqrt(std::max(value.lo, 0.0))), 0.0), up(std::sqrt(value.hi)) },
+			value.partial || value.lo < 0.0);
+	}
+
+	Interval exp(const Interval& value)
+	{
+		if (isEmpty(value))
+			return Interval::empty();
+
+		return carry({ std::max(down(std::exp(value.lo), libmUlps), 0.0), up(std::exp(value.hi), libmUlps) }, value.partial);
+	}
+
+	// the pole at 0 stretches the range to -infinity, arguments below 0 are dropped
+	Interval log(const Interval& value)
+	{
+		if (isEmpty(value) || value.hi < 0.0)
+			return Interval::empty();
+
+		return carry({ value.lo > 0.0 ? down(std::log(value.lo), libmUlps) : -infinity, value.hi > 0.0 ? up(std::log(value.hi), libmUlps) : -infinity },
+			value.partial || value.lo < 0.0);
+	}
+
+	// the trig functions are nan at infinity
+	Interval sin(const Interval& value)
+	{
+		if (isEmpty(value))
+			return Interval::empty();
+
+		return carry(wave(value, pi / 2.0, -pi / 2.0, [](double x) { return std::sin(x); }), value.partial || !isFinite(value));
+	}
+
+	Interval cos(const Interval& value)
+	{
+		if (isEmpty(value))
+			return Interval::empty();
+
+		return carry(wave(value, 0.0, pi, [](double x) { return std::cos(x); }), value.partial || !isFinite(value));
+	}
+
+	// increasing between its poles, anything across one of them is unbounded
+	Interval tan(const Interval& value)
+	{
+		if (isEmpty(value))
+			return Interval::empty();
+
+		if (!std::isfinite(value.lo) || !std::isfinite(value.hi) || value.hi - value.lo >= pi
+			|| containsPeriodic(value, pi / 2.0, pi))
+			return carry(Interval::entire(), value.partial || !isFinite(value));
+
+		return carry(outward(std::tan(value.lo), std::tan(value.hi), libmUlps), value.partial);
+	}
+
+	// integral exponents are defined for negative bases, everything else only for bases >= 0
+	Interval pow(const Interval& base, const Interval& exponent)
+	{
+		// pow(nan, 0) and pow(1, nan) are 1, and drawn as such by the point evaluators
+		if (isEmpty(base) || isEmpty(exponent))
+		{
+			bool one = isEmpty(base) ? contains(exponent, 0.0) : contains(base, 1.0);
+			bool always = isEmpty(base) ? exponent.lo == 0.0 && exponent.hi == 0.0 : base.lo == 1.0 && base.hi == 1.0;
+			return one ? carry(1.0, !always || base.partial || exponent.partial) : Interval::empty();
+		}
+
+		bool integral = exponent.lo == exponent.hi && std::fabs(exponent.lo) <= maxIntegerExponent
+			&& std::floor(exponent.lo) == exponent.lo;
+
+		Interval result = carry(integral ? integerPower(base, exponent.lo) : realPower(base, exponent),
+			base.partial || exponent.partial || (!integral && base.lo < 0.0));
+
+		if ((base.partial && contains(exponent, 0.0)) || (exponent.partial && contains(base, 1.0)))
+			result = hull(result, carry(1.0, true));
+
+		return result;
+	}
+
+	Interval fabs(const Interval& value)
+	{
+		if (isEmpty(value) || value.lo >= 0.0)
+			return value;
+
+		if (value.hi <= 0.0)
+			return -value;
+
+		return carry({ 0.0, std::max(-value.lo, value.hi) }, value.partial);
+	}
+
+	Interval less(const Interval& a, const Interval& b)
+	{
+		if (isEmpty(a) || isEmpty(b))
+			return 0.0;
+
+		Interval result = a.hi < b.lo ? Interval(1.0) : a.lo >= b.hi ? Interval(0.0) : Interval(0.0, 1.0);
+		return a.partial || b.partial ? hull(result, 0.0) : result;
+	}
+
+	Interval lessEqual(const Interval& a, const Interval& b)
+	{
+		if (isEmpty(a) || isEmpty(b))
+			return 0.0;
+
+		Interval result = a.hi <= b.lo ? Interval(1.0) : a.lo > b.hi ? Interval(0.0) : Interval(0.0, 1.0);
+		return a.partial || b.partial ? hull(result, 0.0) : result;
+	}
+
+	// b where a is nan, nan where b is, as the point evaluators
+	Interval minimum(const Interval& a, const Interval& b)
+	{
+		if (isEmpty(a) || isEmpty(b))
+			return b;
+
+		Interval result = { std::min(a.lo, b.lo), std::min(a.hi, b.hi) };
+		if (a.partial)
+			result = hull(result, b);
+
+		result.partial = b.partial;
+		return result;
+	}
+
+	Interval maximum(const Interval& a, const Interval& b)
+	{
+		if (isEmpty(a) || isEmpty(b))
+			return b;
+
+		Interval result = { std::max(a.lo, b.lo), std::max(a.hi, b.hi) };
+		if (a.partial)
+			result = hull(result, b);
+
+		result.partial = b.partial;
+		return result;
+	}
+
+	// a nan condition holds, so an empty or partial one takes the then branch
+	bool canBeTrue(const Interval& condition)
+	{
+		return isEmpty(condition) || condition.partial || !(condition.lo == 0.0 && condition.hi == 0.0);
+	}
+
+	bool canBeFalse(const Interval& condition)
+	{
+		return contains(condition, 0.0);
+	}
+
+	Interval choose(const Interval& condition, const Interval& a, const Interval& b)
+	{
+		bool then = canBeTrue(condition);
+		bool otherwise = canBeFalse(condition);
+
+		// an empty branch is nan for the x that take it
+		if (then && otherwise)
+		{
+			if (isEmpty(a)) return carry(b, true);
+			if (isEmpty(b)) return carry(a, true);
+			return hull(a, b);
+		}
+
+		return then ? a : b;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+namespace parser
+{
+	// closed range of doubles that is guaranteed to contain the exact result. Every op rounds its
+	// bounds outward, poles widen the range to infinity and arguments outside a function's domain
+	// are dropped, so an empty interval means the expression is undefined everywhere on the input.
+	// partial marks ranges where that happened to part of the input: the bounds only hold where the
+	// value is defined, and ops that turn nan into a number (comparisons, min, max, selects) widen
+	// their result by what they give for nan
+	struct Interval
+	{
+		double lo;
+		double hi;
+		bool partial = false; // may be nan for some of the input, see above
+
+		Interval() = default;
+		constexpr Interval(double value) : lo(value), hi(value) {}
+		constexpr Interval(double low, double high) : lo(low), hi(high) {}
+
+		static Interval empty();
+		static Interval entire();
+
+		Interval& operator+=(const Interval& other);
+		Interval& operator-=(const Interval& other);
+		Interval& operator*=(const Interval& other);
+		Interval& operator/=(const Interval& other);
+	};
+
+	bool isEmpty(const Interval& value);
+
+	bool contains(const Interval& value, double x);
+
+	// true if the two intervals share at least one value
+	bool overlaps(const Interval& a, const Interval& b);
+
+	Interval operator-(const Interval& value);
+	Interval operator+(const Interval& a, const Interval& b);
+	Interval operator-(const Interval& a, const Interval& b);
+	Interval operator*(const Interval& a, const Interval& b);
+	Interval operator/(const Interval& a, const Interval& b);
+
+	inline Interval& Interval::operator+=(const Interval& other) { return *this = *this + other; }
+	inline Interval& Interval::operator-=(const Interval& other) { return *this = *this - other; }
+	inline Interval& Interval::operator*=(const Interval& other) { return *this = *this * other; }
+	inline Interval& Interval::operator/=(const Interval& other) { return *this = *this / other; }
+
+	// same names as <cmath> so templated evaluators find them by argument dependent lookup
+	Interval sqrt(const Interval& value);
+	Interval exp(const Interval& value);
+	Interval log(const Interval& value);
+	Interval sin(const Interval& value);
+	Interval cos(const Interval& value);
+	Interval tan(const Interval& value);
+	Interval pow(const Interval& base, const Interval& exponent);
+	Interval fabs(const Interval& value);
+
+	// overloads of Piecewise.hpp: [1, 1] or [0, 0] where every pair of values agrees, [0, 1] otherwise,
+	// and a select over a condition that can go both ways spans both branches. An empty operand is nan
+	// throughout: comparisons on it are 0, min and max pass b on and a select takes its then branch.
+	// A partial operand widens the result by the same
+	Interval less(const Interval& a, const Interval& b);
+	Interval lessEqual(const Interval& a, const Interval& b);
+	Interval minimum(const Interval& a, const Interval& b);
+	Interval maximum(const Interval& a, const Interval& b);
+	bool canBeTrue(const Interval& condition);
+	bool canBeFalse(const Interval& condition);
+	Interval choose(const Interval& condition, const Interval& a, const Interval& b);
+}
\ No newline at end of file
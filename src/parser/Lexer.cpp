@@ -0,0 +1,196 @@
+#include "Lexer.hpp"
+#include <array>
+#include <charconv>
+#include <stdexcept>
+#include <system_error>
+
+namespace parser
+{
+	namespace
+	{
+		struct FunctionName
+		{
+			std::string_view name;
+			NodeType type;
+		};
+
+		constexpr FunctionName functionNames[] = {
+			{ "sin", NodeType::Sin },
+			{ "cos", NodeType::Cos },
+			{ "tan", NodeType::Tan },
+			{ "log", NodeType::Log },
+			{ "exp", NodeType::Exp },
+			{ "sqrt", NodeType::Sqrt },
+			{ "abs", NodeType::Abs },
+			{ "min", NodeType::Minimum },
+			{ "max", NodeType::Maximum },
+			{ "step", NodeType::LessEqual }, // 0 <= a, expanded by the parser
+			{ "sum", NodeType::Sum }, // the first argument names the index, see Summation.hpp
+			{ "prod", NodeType::Product }
+		};
+
+		constexpr std::size_t functionCount = sizeof(functionNames) / sizeof(functionNames[0]);
+
+		// power of two with room to spare, so a collision free seed is found quickly
+		constexpr std::size_t functionTableSize = 16;
+
+		// fnv-1a with a variable seed, folded to the table size
+		constexpr std::size_t functionSlot(std::string_view name, std::uint32_t seed)
+		{
+			std::uint32_t hash = seed;
+			for (char c : name)
+				hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+
+			return (hash ^ (hash >> 16)) & (functionTableSize - 1);
+		}
+
+		constexpr bool perfect(std::uint32_t seed)
+		{
+			bool used[functionTableSize] = {};
+			for (const FunctionName& function : functionNames)
+			{
+				std::size_t slot = functionSlot(function.name, seed);
+				if (used[slot])
+					return false;
+
+				used[slot] = true;
+			}
+
+			return true;
+		}
+
+		constexpr std::uint32_t findSeed()
+		{
+			for (std::uint32_t seed = 2166136261u; seed < 2166136261u + 1024; seed++)
+				if (perfect(seed))
+					return seed;
+
+			return 0;
+		}
+
+		constexpr std::uint32_t functionSeed = findSeed();
+		static_assert(perfect(functionSeed), "no collision free seed for the function table, grow functionTableSize");
+
+		// index + 1 into functionNames, 0 for empty slots
+		constexpr std::array<std::uint8_t, functionTableSize> functionTable = [] {
+			std::array<std::uint8_t, functionTableSize> table = {};
+			for (std::size_t i = 0; i < functionCount; i++)
+				table[functionSlot(functionNames[i].name, functionSeed)] = static_cast<std::uint8_t>(i + 1);
+
+			return table;
+		}();
+
+		bool isDigit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		bool isLetter(char c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		}
+
+		bool isSpace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+		}
+	}
+
+	bool lookupFunction(std::string_view name, NodeType& type)
+	{
+		std::uint8_t entry = functionTable[functionSlot(name, functionSeed)];
+		if (entry == 0 || functionNames[entry - 1].name != name)
+			return false;
+
+		type = functionNames[entry - 1].type;
+		return true;
+	}
+
+	Lexer::Lexer(std::string_view input)
+		: input(input)
+	{
+		current = scan();
+	}
+
+	Token Lexer::next()
+	{
+		Token token = current;
+		current = scan();
+		return token;
+	}
+
+	Token Lexer::scan()
+	{
+		while (pos < input.size() && isSpace(input[pos]))
+			pos++;
+
+		if (pos == input.size())
+			return { TokenType::End, input.substr(pos), 0.0, NodeType::Constant };
+
+		std::size_t start = pos;
+		char c = input[pos];
+
+		if (isDigit(c) || c == '.')
+		{
+			while (pos < input.size() && (isDigit(input[pos]) || input[pos] == '.'))
+				pos++;
+
+			const char* first = input.data() + start;
+			const char* last = input.data() + pos;
+
+			double value = 0.0;
+			auto [end, error] = std::from_chars(first, last, value, std::chars_format::fixed);
+			if (error == std::errc::result_out_of_range)
+				throw std::runtime_error("Number out of range");
+			if (error != std::errc() || end != last)
+				throw std::runtime_error("Invalid number");
+
+			return { TokenType::Number, input.substr(start, pos - start), value, NodeType::Constant };
+		}
+
+		if (isLetter(c))
+		{
+			while (pos < input.size() && isLetter(input[pos]))
+				pos++;
+
+			std::string_view name = input.substr(start, pos - start);
+			if (name == "x")
+				return { TokenType::Variable, name, 0.0, NodeType::Variable };
+
+			NodeType function;
+			if (lookupFunction(name, function))
+				return { TokenType::Function, name, 0.0, function };
+
+			return { TokenType::Identifier, name, 0.0, NodeType::Constant };
+		}
+
+		// two character comparisons
+		if ((c == '<' || c == '>') && pos + 1 < input.size() && input[pos + 1] == '=')
+		{
+			pos += 2;
+			std::string_view text = input.substr(start, 2);
+			TokenType type = c == '<' ? TokenType::LessEqual : TokenType::GreaterEqual;
+			return { type, text, 0.0, NodeType::Constant };
+		}
+
+		pos++;
+		std::string_view text = input.substr(start, 1);
+
+		switch (c)
+		{
+		case '+': return { TokenType::Plus, text, 0.0, NodeType::Constant };
+		case '-': return { TokenType::Minus, text, 0.0, NodeType::Constant };
+		case '*': return { TokenType::Star, text, 0.0, NodeType::Constant };
+		case '/': return { TokenType::Slash, text, 0.0, NodeType::Constant };
+		case '^': return { TokenType::Caret, text, 0.0, NodeType::Constant };
+		case '<': return { TokenType::Less, text, 0.0, NodeType::Constant };
+		case '>': return { TokenType::Greater, text, 0.0, NodeType::Constant };
+		case '?': return { TokenType::Question, text, 0.0, NodeType::Constant };
+		case ':': return { TokenType::Colon, text, 0.0, NodeType::Constant };
+		case ',': return { TokenType::Comma, text, 0.0, NodeType::Constant };
+		case '(': return { TokenType::LeftParen, text, 0.0, NodeType::Constant };
+		case ')': return { TokenType::RightParen, text, 0.0, NodeType::Constant };
+		default: return { TokenType::Unknown, text, 0.0, NodeType::Constant };
+		}
+	}
+}
\ No newline at end of file
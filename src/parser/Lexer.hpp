@@ -0,0 +1,62 @@
+#pragma once
+#include "Ast.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace parser
+{
+	enum class TokenType : std::uint8_t
+	{
+		Number,
+		Variable,
+		Function, // one of the built-in functions, see Token::function
+		Identifier, // any other name
+		Plus,
+		Minus,
+		Star,
+		Slash,
+		Caret,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		Question,
+		Colon,
+		Comma,
+		LeftParen,
+		RightParen,
+		Unknown,
+		End
+	};
+
+	// text points into the lexed input, which has to outlive the token
+	struct Token
+	{
+		TokenType type;
+		std::string_view text;
+		double value; // numbers only
+		NodeType function; // functions only
+	};
+
+	// built-in function of that name, looked up in a perfect hash table built at compile time
+	bool lookupFunction(std::string_view name, NodeType& type);
+
+	// splits an expression into tokens without copying or allocating; one token of lookahead
+	class Lexer
+	{
+	public:
+		explicit Lexer(std::string_view input);
+
+		const Token& peek() const { return current; }
+
+		// returns the current token and moves on to the next one
+		Token next();
+	private:
+		std::string_view input;
+		std::size_t pos = 0;
+		Token current;
+
+		Token scan();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "Optimizer.hpp"
+#include "Piecewise.hpp"
+#include "Summation.hpp"
+#include <atomic>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace parser
+{
+	namespace
+	{
+		std::atomic<bool> optimizeOn = true;
+
+		// builds the optimized tree; every constructor simplifies before it adds a node,
+		// so rewrites that create new nodes (power expansion) are simplified as well
+		class Rewriter
+		{
+		public:
+			explicit Rewriter(const Ast& tree)
+				: ast(tree), mapped(tree.size()) {}
+
+			Ast run()
+			{
+				// operands come first, so their rewritten ids are always known
+				for (NodeId id = 0; id < ast.size(); id++)
+				{
+					const Node& node = ast[id];
+					switch (arity(node.type))
+					{
+					case 0: mapped[id] = leaf(node); break;
+					case 1: mapped[id] = unary(node.type, mapped[node.lhs]); break;
+					case 2: mapped[id] = binary(node.type, mapped[node.lhs], mapped[node.rhs]); break;
+					default:
+						mapped[id] = node.type == NodeType::Select
+							? select(mapped[node.lhs], mapped[node.rhs], mapped[node.third])
+							: loop(node, mapped[node.lhs], mapped[node.rhs], mapped[node.third]);
+						break;
+					}
+				}
+
+				out.root = mapped[ast.root];
+				return std::move(out);
+			}
+		private:
+			const Ast& ast;
+			std::vector<NodeId> mapped;
+			Ast out;
+
+			const Node& get(NodeId id) const { return out[id]; }
+
+			bool isConstant(NodeId id) const { return get(id).type == NodeType::Constant; }
+
+			bool isConstant(NodeId id, double value) const
+			{
+				return isConstant(id) && get(id).value == value;
+			}
+
+			NodeId constant(double value)
+			{
+				return out.add({ NodeType::Constant, value, 0, 0 });
+			}
+
+			NodeId leaf(const Node& node)
+			{
+				return out.add({ node.type, node.value, node.lhs, 0 });
+			}
+
+			NodeId unary(NodeType type, NodeId operand)
+			{
+				if (isConstant(operand))
+					return constant(applyNode(type, get(operand).value, 0.0));
+
+				// --a
+				if (type == NodeType::Negate && get(operand).type == NodeType::Negate)
+					return get(operand).lhs;
+
+				return out.add({ type, 0.0, operand, 0 });
+			}
+
+			NodeId binary(NodeType type, NodeId lhs, NodeId rhs)
+			{
+				if (isConstant(lhs) && isConstant(rhs))
+					return constant(applyNode(type, get(lhs).value, get(rhs).value));
+
+				switch (type)
+				{
+				case NodeType::Add:
+					if (isConstant(rhs, 0.0)) return lhs;
+					if (isConstant(lhs, 0.0)) return rhs;
+					if (get(rhs).type == NodeType::Negate) return binary(NodeType::Subtract, lhs, get(rhs).lhs);
+					break;
+				case NodeType::Subtract:
+					if (isConstant(rhs, 0.0)) return lhs;
+					if (isConstant(lhs, 0.0)) return unary(NodeType::Negate, rhs);
+					if (get(rhs).type == NodeType::Negate) return binary(NodeType::Add, lhs, get(rhs).lhs);
+					break;
+				case NodeType::Multiply:
+					if (isConstant(rhs, 1.0)) return lhs;
+					if (isConstant(lhs, 1.0)) return rhs;
+					if (isConstant(rhs, -1.0)) return unary(NodeType::Negate, lhs);
+					if (isConstant(lhs, -1.0)) return unary(NodeType::Negate, rhs);
+
+					// 0 * e is only 0 if e cannot be inf or nan, which x never is while sampling
+					if (isConstant(lhs, 0.0) && get(rhs).type == NodeType::Variable) return lhs;
+					if (isConstant(rhs, 0.0) && get(lhs).type == NodeType::Variable) return rhs;
+					break;
+				case NodeType::Divide:
+					if (isConstant(rhs))
+						return divideByConstant(lhs, get(rhs).value);
+					break;
+				case NodeType::Power:
+					if (isConstant(rhs))
+						return powerOfConstant(lhs, get(rhs).value);
+					break;
+				default:
+					break;
+				}
+
+				return out.add({ type, 0.0, lhs, rhs });
+			}
+
+			// a constant condition picks its branch, the other one is dropped with it
+			NodeId select(NodeId condition, NodeId a, NodeId b)
+			{
+				if (isConstant(condition))
+					return canBeTrue(get(condition).value) ? a : b;
+
+				if (a == b)
+					return a;
+
+				return out.add({ NodeType::Select, 0.0, condition, a, b });
+			}
+
+			// a range that is empty whatever the parameters leaves the identity, the body is dropped
+			NodeId loop(const Node& node, NodeId first, NodeId last, NodeId body)
+			{
+				if (isConstant(first) && isConstant(last) && loopTerms(get(first).value, get(last).value) == 0.0)
+					return constant(node.type == NodeType::Sum ? 0.0 : 1.0);
+
+				return out.add({ node.type, node.value, first, last, body });
+			}
+
+			NodeId divideByConstant(NodeId lhs, double divisor)
+			{
+				double reciprocal = 1.0 / divisor;
+
+				// only powers of two have an exact reciprocal, any other one is rounded to double and
+				// the product loses against the quotient in the wider evaluation types.
+				// 1/0 and 1/tiny would turn finite quotients into inf * 0, also once rounded to float
+				int exponent = 0;
+				float rounded = static_cast<float>(reciprocal);
+				if (divisor == 0.0 || std::fabs(std::frexp(divisor, &exponent)) != 0.5 || !std::isfinite(rounded) || rounded == 0.f)
+					return out.add({ NodeType::Divide, 0.0, lhs, constant(divisor) });
+
+				return binary(NodeType::Multiply, lhs, constant(reciprocal));
+			}
+
+			NodeId powerOfConstant(NodeId base, double exponent)
+			{
+				if (exponent == 1.0)
+					return base;
+
+				if (exponent == 0.0)
+					return constant(1.0);
+
+				if (exponent != std::floor(exponent) || std::fabs(exponent) > maxExpandedPower)
+					return out.add({ NodeType::Power, 0.0, base, constant(exponent) });
+
+				// exponentiation by squaring, the squares are shared subtrees
+				unsigned int remaining = static_cast<unsigned int>(std::fabs(exponent));
+				NodeId square = base;
+				NodeId result = 0;
+				bool started = false;
+
+				while (remaining > 0)
+				{
+					if (remaining & 1u)
+					{
+						result = started ? binary(NodeType::Multiply, result, square) : square;
+						started = true;
+					}
+
+					remaining >>= 1;
+					if (remaining > 0)
+						square = binary(NodeType::Multiply, square, square);
+				}
+
+				if (exponent < 0.0)
+					return out.add({ NodeType::Divide, 0.0, constant(1.0), result });
+
+				return result;
+			}
+		};
+	}
+
+	void setOptimize(bool enabled)
+	{
+		optimizeOn = enabled;
+	}
+
+	bool optimizeEnabled()
+	{
+		return optimizeOn;
+	}
+
+	Ast optimize(const Ast& ast)
+	{
+		if (ast.size() == 0)
+			return ast;
+
+		return compact(Rewriter(ast).run());
+	}
+
+	Ast intervalTree(const Ast& ast)
+	{
+		if (ast.size() == 0)
+			return ast;
+
+		Ast tree;
+		tree.reserve(ast.size());
+
+		// operands come first, so their ids in the new tree are always known
+		std::vector<NodeId> mapped(ast.size());
+		for (NodeId id = 0; id < ast.size(); id++)
+		{
+			Node node = ast[id];
+			bool square = node.type == NodeType::Multiply && node.lhs == node.rhs;
+
+			int operands = arity(node.type);
+			if (operands >= 1) node.lhs = mapped[node.lhs];
+			if (operands >= 2) node.rhs = mapped[node.rhs];
+			if (operands == 3) node.third = mapped[node.third];
+
+			if (square)
+				node = { NodeType::Power, 0.0, node.lhs, tree.add({ NodeType::Constant, 2.0, 0, 0 }) };
+
+			mapped[id] = tree.add(node);
+		}
+
+		tree.root = mapped[ast.root];
+		return tree;
+	}
+}
\ No newline at end of file
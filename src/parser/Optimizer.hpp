@@ -0,0 +1,23 @@
+#pragma once
+#include "Ast.hpp"
+
+namespace parser
+{
+	// compileExpression runs the optimizer unless it is switched off, e.g. to compare programs
+	void setOptimize(bool enabled);
+	bool optimizeEnabled();
+
+	// rewrites the tree bottom-up: folds constant subtrees, drops identities (x+0, x*1, x^1, --x),
+	// expands integer powers up to maxExpandedPower into multiplications by squaring and turns
+	// division by a constant into multiplication by its reciprocal. A select on a constant condition
+	// becomes the branch it takes, a sum or product over a range that is always empty its identity.
+	// Only nodes still reachable from the root are kept
+	constexpr double maxExpandedPower = 64.0;
+
+	Ast optimize(const Ast& ast);
+
+	// the tree with every product of a node with itself written as a square again, for interval
+	// evaluation: it takes the factors of a product as independent, so x * x over [-1, 1] would be
+	// [-1, 1] where x^2 is [0, 1]. Undoes the power expansion of optimize, the dag shares x * x
+	Ast intervalTree(const Ast& ast);
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "Parallel.hpp"
+#include "Summation.hpp"
+#include "VirtualMachine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parser
+{
+	namespace
+	{
+		// workers sleep until a loop starts, take chunks off a shared counter together with the thread that
+		// started it and report back once none are left. Each keeps its thread_local scratch between loops
+		class WorkerPool
+		{
+		public:
+			explicit WorkerPool(std::size_t workers)
+			{
+				for (std::size_t i = 0; i < workers; i++)
+					threads.emplace_back([this] { work(); });
+			}
+
+			std::size_t size() const { return threads.size() + 1; }
+
+			// false without running anything while another loop is running
+			bool run(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body)
+			{
+				if (busy.exchange(true))
+					return false;
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					job = &body;
+					total = count;
+					chunkSize = grain;
+					chunks = (count + grain - 1) / grain;
+					next = 0;
+					running = threads.size();
+					generation++;
+				}
+
+				wake.notify_all();
+				runChunks();
+
+				std::unique_lock<std::mutex> lock(mutex);
+				done.wait(lock, [this] { return running == 0; });
+				job = nullptr;
+				busy = false;
+				return true;
+			}
+		private:
+			std::vector<std::thread> threads;
+			std::atomic<bool> busy = false;
+
+			std::mutex mutex;
+			std::condition_variable wake;
+			std::condition_variable done;
+			std::uint64_t generation = 0;
+			std::size_t running = 0; // workers that have not finished the current loop
+
+			// set under the mutex before generation moves on, read only until running drops to 0
+			const std::function<void(std::size_t, std::size_t)>* job = nullptr;
+			std::size_t total = 0;
+			std::size_t chunkSize = 0;
+			std::size_t chunks = 0;
+			std::atomic<std::size_t> next = 0;
+
+			void runChunks()
+			{
+				for (std::size_t chunk = next++; chunk < chunks; chunk = next++)
+				{
+					std::size_t first = chunk * chunkSize;
+					(*job)(first, std::min(total, first + chunkSize));
+				}
+			}
+
+			void work()
+			{
+				std::uint64_t seen = 0;
+				while (true)
+				{
+					{
+						std::unique_lock<std::mutex> lock(mutex);
+						wake.wait(lock, [&] { return generation != seen; });
+						seen = generation;
+					}
+
+					runChunks();
+
+					std::lock_guard<std::mutex> lock(mutex);
+					if (--running == 0)
+						done.notify_one();
+				}
+			}
+		};
+
+		// never destroyed, the workers wait for the next loop until the process ends
+		WorkerPool& pool()
+		{
+			static WorkerPool* workers = new WorkerPool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+			return *workers;
+		}
+	}
+
+	std::size_t workerCount()
+	{
+		return pool().size();
+	}
+
+	void parallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body)
+	{
+		grain = std::max<std::size_t>(grain, 1);
+		if (count <= grain || workerCount() == 1 || !pool().run(count, grain, body))
+			body(0, count);
+	}
+
+	double sampleCost(const Ast& ast, const std::vector<NodeId>& roots)
+	{
+		// operands come before the nodes using them, so walking down the ids reaches every user of a node
+		// before the node itself. A shared node counts with the largest weight it is used at
+		std::vector<double> weights(ast.size(), 0.0);
+		for (NodeId root : roots)
+			weights[root] = 1.0;
+
+		double cost = 0.0;
+		for (NodeId id = static_cast<NodeId>(ast.size()); id-- > 0;)
+		{
+			double weight = weights[id];
+			if (weight == 0.0)
+				continue;
+
+			cost += weight;
+			const Node& node = ast[id];
+			int operands = arity(node.type);
+
+			double body = weight;
+			if (node.type == NodeType::Sum || node.type == NodeType::Product)
+			{
+				double first = std::round(evaluateTree(ast, node.lhs, 0.0));
+				double terms = loopTerms(first, evaluateTree(ast, node.rhs, 0.0));
+				body = weight * (terms >= 1.0 ? terms : 0.0);
+			}
+
+			if (operands > 0)
+				weights[node.lhs] = std::max(weights[node.lhs], weight);
+			if (operands > 1)
+				weights[node.rhs] = std::max(weights[node.rhs], weight);
+			if (operands > 2)
+				weights[node.third] = std::max(weights[node.third], body);
+		}
+
+		return cost;
+	}
+
+	std::size_t parallelGrain(double cost)
+	{
+		double samples = static_cast<double>(parallelChunkOps) / std::max(cost, 1.0);
+		double blocks = std::ceil(samples / static_cast<double>(batchBlockSize));
+		return static_cast<std::size_t>(std::max(blocks, 1.0)) * batchBlockSize;
+	}
+}
\ No newline at end of file
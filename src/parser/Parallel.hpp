@@ -0,0 +1,25 @@
+#pragma once
+#include "Ast.hpp"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace parser
+{
+	// a chunk of samples is worth handing to another thread once it runs about this many ops
+	constexpr std::size_t parallelChunkOps = 1 << 17;
+
+	// threads parallelFor spreads over, the calling one included
+	std::size_t workerCount();
+
+	// runs body(first, last) over chunks of [0, count) of at least grain items, on the calling thread and a
+	// pool of workers started on first use, one per further hardware thread; returns once every chunk is
+	// done. Loops started while another one is running, also from inside body, run on the calling thread
+	void parallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body);
+
+	// nodes one sample of the roots runs through, those in the body of a sum or product once per term
+	double sampleCost(const Ast& ast, const std::vector<NodeId>& roots);
+
+	// samples per chunk at the given cost: whole blocks of batchBlockSize running at least parallelChunkOps ops
+	std::size_t parallelGrain(double cost);
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "Parameters.hpp"
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace parser
+{
+	namespace
+	{
+		// zero initialized before anything runs, evaluators read them without taking the lock
+		std::atomic<double> values[maxParameters];
+
+		std::mutex namesMutex;
+		std::vector<std::string> names;
+	}
+
+	std::uint32_t parameterSlot(std::string_view name)
+	{
+		std::lock_guard<std::mutex> lock(namesMutex);
+
+		for (std::size_t slot = 0; slot < names.size(); slot++)
+		{
+			if (names[slot] == name)
+				return static_cast<std::uint32_t>(slot);
+		}
+
+		if (names.size() == maxParameters)
+			throw std::runtime_error("Too many parameters");
+
+		values[names.size()].store(1.0, std::memory_order_relaxed);
+		names.emplace_back(name);
+		return static_cast<std::uint32_t>(names.size() - 1);
+	}
+
+	std::string parameterName(std::uint32_t slot)
+	{
+		std::lock_guard<std::mutex> lock(namesMutex);
+		return slot < names.size() ? names[slot] : std::string();
+	}
+
+	void setParameter(std::uint32_t slot, double value)
+	{
+		values[slot].store(value, std::memory_order_relaxed);
+	}
+
+	double parameterValue(std::uint32_t slot)
+	{
+		return values[slot].load(std::memory_order_relaxed);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace parser
+{
+	// named values such as a or k. Expressions compile a parameter to its slot and read the value each
+	// time they run, so setting one changes every plot using it on the next frame without recompiling.
+	// A name keeps its slot for the lifetime of the process
+	constexpr std::size_t maxParameters = 256;
+
+	// slot of the name, new names get the next free one with the value 1.
+	// Throws std::runtime_error once every slot is taken
+	std::uint32_t parameterSlot(std::string_view name);
+
+	std::string parameterName(std::uint32_t slot);
+
+	// atomic, safe to call while other threads evaluate
+	void setParameter(std::uint32_t slot, double value);
+	double parameterValue(std::uint32_t slot);
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "Piecewise.hpp"
+#include <vector>
+
+namespace parser
+{
+	Ast pieceTree(const Ast& ast)
+	{
+		std::vector<bool> condition(ast.size(), false);
+		for (NodeId id = 0; id < ast.size(); id++)
+		{
+			const Node& node = ast[id];
+			if (node.type == NodeType::Less || node.type == NodeType::LessEqual)
+				condition[id] = true;
+			if (node.type == NodeType::Select)
+				condition[node.lhs] = true;
+		}
+
+		// the conditions live in the same dag, so the pieces share their subexpressions with the function
+		Ast tree = ast;
+		NodeId sum = 0;
+		int count = 0;
+		double bit = 1.0;
+
+		// a condition on the index of a sum only exists inside it, its jumps are not told apart
+		std::vector<std::uint32_t> free = freeIndices(ast);
+
+		for (NodeId id = 0; id < ast.size() && count < maxPieceConditions; id++)
+		{
+			if (!condition[id] || free[id] != 0)
+				continue;
+
+			NodeId set = tree.add({ NodeType::Constant, bit, 0, 0 });
+			NodeId clear = tree.add({ NodeType::Constant, 0.0, 0, 0 });
+			NodeId term = tree.add({ NodeType::Select, 0.0, id, set, clear });
+			sum = count == 0 ? term : tree.add({ NodeType::Add, 0.0, sum, term });
+
+			bit *= 2.0;
+			count++;
+		}
+
+		if (count == 0)
+			return Ast();
+
+		tree.root = sum;
+		return compact(tree);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+#include "Ast.hpp"
+#include "DoubleDouble.hpp"
+#include "Interval.hpp"
+
+namespace parser
+{
+	// comparisons, min, max and selects for one value of an evaluation type, lane for lane the same as
+	// the simd kernels. Comparisons give 1 or 0 and are false for nan; a condition holds wherever it is
+	// not 0, nan included as in c. Intervals have their own overloads that cover every possible result
+
+	template <typename T>
+	T less(const T& a, const T& b)
+	{
+		return a < b ? T(1) : T(0);
+	}
+
+	template <typename T>
+	T lessEqual(const T& a, const T& b)
+	{
+		return a <= b ? T(1) : T(0);
+	}
+
+	// operand order as in minps and maxps: b unless a compares smaller (larger), also if either is nan
+	template <typename T>
+	T minimum(const T& a, const T& b)
+	{
+		return a < b ? a : b;
+	}
+
+	template <typename T>
+	T maximum(const T& a, const T& b)
+	{
+		return b < a ? a : b;
+	}
+
+	// whether some x may take the then (else) branch of a select on this condition
+	template <typename T>
+	bool canBeTrue(const T& condition)
+	{
+		return !(condition == T(0));
+	}
+
+	template <typename T>
+	bool canBeFalse(const T& condition)
+	{
+		return condition == T(0);
+	}
+
+	template <typename T>
+	T choose(const T& condition, const T& a, const T& b)
+	{
+		return canBeTrue(condition) ? a : b;
+	}
+
+	// conditions past this many are not told apart, float holds every sum of 24 bits exactly
+	constexpr int maxPieceConditions = 24;
+
+	// number of the piece of a piecewise expression x falls in: bit i is set where its i-th comparison or
+	// select condition holds. Samples on different pieces are not joined when drawing, a jump between
+	// them is no part of the graph. Conditions on the index of a sum or product are left out. Returns an
+	// empty tree if the expression has no conditions
+	Ast pieceTree(const Ast& ast);
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+namespace parser
+{
+	// scalar type a plot is evaluated in
+	enum class Precision
+	{
+		Auto, // float until the viewport needs more, see math::requiredPrecision
+		Float, // simd and native code, 24 bit mantissa
+		Double, // simd, 53 bit mantissa
+		LongDouble, // one sample at a time, 64 bit mantissa on x87, the same as double on msvc
+		DoubleDouble, // one sample at a time, 106 bit mantissa, many times slower than double
+		Fast, // FastFloat while its error stays below math::fastMathBound pixels, Auto otherwise
+		FastFloat // float with the fast tier of exp, log and pow
+	};
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#include "Summation.hpp"
+#include <algorithm>
+
+namespace parser
+{
+	double loopTerms(double first, double last)
+	{
+		double terms = std::round(last) - std::round(first) + 1.0;
+		if (std::isnan(terms))
+			return terms;
+
+		return std::clamp(terms, 0.0, maxLoopTerms);
+	}
+}
\ No newline at end of file
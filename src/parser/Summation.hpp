@@ -0,0 +1,74 @@
+#pragma once
+#include "DoubleDouble.hpp"
+#include "Interval.hpp"
+#include <cmath>
+
+namespace parser
+{
+	// sum(k, a, b, f) and prod(k, a, b, f) run the index k over the integers from a to b, both rounded to
+	// the nearest integer. A range with b < a is empty, its sum is 0 and its product 1, a nan bound makes
+	// the result nan. The bounds cannot depend on x or on an index, so every sample runs the same terms.
+	// The level of a sum or product is the number of bodies of others around it, at most maxLoopLevels - 1
+	constexpr int maxLoopLevels = 16;
+
+	// terms past this many are dropped; float holds every index of a range this long exactly
+	constexpr double maxLoopTerms = 1 << 20;
+
+	// number of terms between bounds as evaluated, nan if either is nan. Out of line, the simd kernels
+	// call it from translation units built for other instruction sets
+	double loopTerms(double first, double last);
+
+	// a bound as a double, the middle of an interval; bounds of intervals are points but for rounding
+	template <typename T>
+	double loopBound(const T& value)
+	{
+		return static_cast<double>(value);
+	}
+
+	inline double loopBound(const Interval& value)
+	{
+		return value.lo + (value.hi - value.lo) / 2.0;
+	}
+
+	// kahan summation: compensation holds what the last addition rounded off and goes into the next term.
+	// The error is taken with the larger addend first as in neumaier's variant, so it stays exact also
+	// where a term is larger than the sum so far. It is 0 once the sum overflows or turns nan
+	template <typename T>
+	void accumulate(T& sum, T& compensation, const T& term)
+	{
+		using std::fabs;
+
+		T addend = term + compensation;
+		T total = sum + addend;
+		T lost = fabs(sum) >= fabs(addend) ? (sum - total) + addend : (addend - total) + sum;
+		compensation = lost - lost == T(0) ? lost : T(0);
+		sum = total;
+	}
+
+	template <typename T>
+	T compensated(const T& sum, const T& compensation)
+	{
+		return sum + compensation;
+	}
+
+	// intervals round outward and double-doubles keep what a double addition rounds off, both add plainly
+	inline void accumulate(Interval& sum, Interval&, const Interval& term)
+	{
+		sum += term;
+	}
+
+	inline Interval compensated(const Interval& sum, const Interval&)
+	{
+		return sum;
+	}
+
+	inline void accumulate(DoubleDouble& sum, DoubleDouble&, const DoubleDouble& term)
+	{
+		sum += term;
+	}
+
+	inline DoubleDouble compensated(const DoubleDouble& sum, const DoubleDouble&)
+	{
+		return sum;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,385 @@
+#include "VirtualMachine.hpp"
+#include "Parameters.hpp"
+#include "Piecewise.hpp"
+#include "Summation.hpp"
+#include "simd/Kernels.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace parser
+{
+	namespace
+	{
+		constexpr std::size_t smallStackSize = 64;
+
+		std::atomic<bool> exactMathEnabled = false;
+
+		// slots live right after the stack in the same buffer; outputs are left at the bottom of the stack.
+		// The branch of a select that the condition rules out is skipped, an interval condition that goes
+		// either way runs both. The index of a loop is a point even for intervals
+		template <typename T>
+		void run(const Program& program, T x, T* stack)
+		{
+			const double* constant = program.constants.data();
+			const std::uint32_t* slot = program.slots.data();
+			const Jump* jump = program.jumps.data();
+			T* slots = stack + program.maxStack;
+			T* top = stack - 1; // points at the topmost value
+
+			// unqualified so double-double and intervals find their own overloads
+			using std::pow, std::sin, std::cos, std::tan, std::log, std::exp, std::sqrt, std::fabs;
+
+			std::size_t pc = 0;
+			auto resume = [&](const Jump& target) {
+				pc = target.pc;
+				constant = program.constants.data() + target.constant;
+				slot = program.slots.data() + target.slot;
+				jump = program.jumps.data() + target.jump;
+			};
+
+			auto skip = [&](const Jump& target) {
+				*++top = T(0);
+				resume(target);
+			};
+
+			while (pc < program.code.size())
+			{
+				OpCode op = program.code[pc++];
+				switch (op)
+				{
+				case OpCode::Constant: *++top = static_cast<T>(*constant++); break;
+				case OpCode::Variable: *++top = x; break;
+				case OpCode::Negate: *top = -*top; break;
+				case OpCode::Add: top[-1] += *top; --top; break;
+				case OpCode::Subtract: top[-1] -= *top; --top; break;
+				case OpCode::Multiply: top[-1] *= *top; --top; break;
+				case OpCode::Divide: top[-1] /= *top; --top; break;
+				case OpCode::Power: top[-1] = pow(top[-1], *top); --top; break;
+				case OpCode::Sin: *top = sin(*top); break;
+				case OpCode::Cos: *top = cos(*top); break;
+				case OpCode::Tan: *top = tan(*top); break;
+				case OpCode::Log: *top = log(*top); break;
+				case OpCode::Exp: *top = exp(*top); break;
+				case OpCode::Sqrt: *top = sqrt(*top); break;
+				case OpCode::Abs: *top = fabs(*top); break;
+				case OpCode::Minimum: top[-1] = minimum(top[-1], *top); --top; break;
+				case OpCode::Maximum: top[-1] = maximum(top[-1], *top); --top; break;
+				case OpCode::Less: top[-1] = less(top[-1], *top); --top; break;
+				case OpCode::LessEqual: top[-1] = lessEqual(top[-1], *top); --top; break;
+				case OpCode::Select: top[-2] = choose(top[-2], top[-1], *top); top -= 2; break;
+				case OpCode::Then:
+					if (!canBeTrue(*top) && jump->pc != 0) skip(*jump); else jump++;
+					break;
+				case OpCode::Else:
+					if (!canBeFalse(top[-1]) && jump->pc != 0) skip(*jump); else jump++;
+					break;
+				case OpCode::Store: slots[*slot++] = *top; break;
+				case OpCode::Load: *++top = slots[*slot++]; break;
+				case OpCode::Parameter: *++top = static_cast<T>(parameterValue(*slot++)); break;
+				case OpCode::Pop: --top; break;
+				case OpCode::SumBegin:
+				case OpCode::ProductBegin:
+				{
+					// index, terms left, sum or product so far, compensation
+					T* state = slots + *slot++;
+					const Jump& exit = *jump++;
+					T identity = T(op == OpCode::SumBegin ? 0 : 1);
+
+					double first = std::round(loopBound(top[-1]));
+					double terms = loopTerms(first, loopBound(*top));
+					top -= 2;
+
+					if (!(terms >= 1.0))
+					{
+						*++top = terms == 0.0 ? identity : static_cast<T>(terms);
+						resume(exit);
+						break;
+					}
+
+					state[0] = static_cast<T>(first);
+					state[1] = static_cast<T>(terms - 1.0);
+					state[2] = identity;
+					state[3] = T(0);
+					break;
+				}
+				case OpCode::SumEnd:
+				case OpCode::ProductEnd:
+				{
+					T* state = slots + *slot++;
+					const Jump& again = *jump++;
+
+					if (op == OpCode::SumEnd)
+						accumulate(state[2], state[3], *top);
+					else
+						state[2] *= *top;
+
+					// terms left is a count, the half only matters to intervals rounded outward
+					if (loopBound(state[1]) >= 0.5)
+					{
+						state[0] += T(1);
+						state[1] -= T(1);
+						--top;
+						resume(again);
+					}
+					else
+						*top = op == OpCode::SumEnd ? compensated(state[2], state[3]) : state[2];
+					break;
+				}
+				}
+			}
+		}
+
+		template <typename T>
+		T executeScalar(const Program& program, T x)
+		{
+			if (program.maxStack + program.slotCount <= smallStackSize)
+			{
+				T stack[smallStackSize];
+				run(program, x, stack);
+				return stack[program.outputs - 1];
+			}
+
+			std::vector<T> stack(program.maxStack + program.slotCount);
+			run(program, x, stack.data());
+			return stack[program.outputs - 1];
+		}
+
+		simd::KernelProgram kernelView(const Program& program, MathTier tier = MathTier::Full)
+		{
+			return {
+				program.code.data(), program.code.size(), program.constants.data(), program.slots.data(),
+				program.jumps.data(), program.maxStack, exactMath(), tier == MathTier::Fast
+			};
+		}
+
+		// stack blocks followed by slot blocks. Dual kernels keep a derivative block next to every value block
+		template <typename T>
+		T* blockStack(const Program& program, EvaluationScratch& scratch, std::size_t blocksPerEntry = 1)
+		{
+			return scratch.blocks<T>((program.maxStack + program.slotCount) * blocksPerEntry * batchBlockSize);
+		}
+
+		template <typename T>
+		void runBatch(const Program& program, const T* xs, T* ys, std::size_t count, simd::SimdLevel level,
+			MathTier tier = MathTier::Full, EvaluationScratch& scratch = threadScratch())
+		{
+			simd::BlockKernel<T> kernel = simd::blockKernel<T>(level);
+			simd::KernelProgram view = kernelView(program, tier);
+			T* stack = blockStack<T>(program, scratch);
+
+			for (std::size_t done = 0; done < count; done += batchBlockSize)
+			{
+				std::size_t block = std::min(batchBlockSize, count - done);
+				kernel(view, xs + done, ys + done, block, stack);
+			}
+		}
+
+		template <typename T>
+		void runBatch(const Program& program, const T* xs, T* const* ys, std::size_t count, MathTier tier = MathTier::Full)
+		{
+			simd::BlockKernel<T> kernel = simd::blockKernel<T>(simd::detectedLevel());
+			simd::KernelProgram view = kernelView(program, tier);
+			T* stack = blockStack<T>(program, threadScratch());
+
+			for (std::size_t done = 0; done < count; done += batchBlockSize)
+			{
+				std::size_t block = std::min(batchBlockSize, count - done);
+				kernel(view, xs + done, nullptr, block, stack);
+
+				for (std::size_t output = 0; output < program.outputs; output++)
+					std::copy(stack + output * batchBlockSize, stack + output * batchBlockSize + block, ys[output] + done);
+			}
+		}
+
+		template <typename T>
+		void runDualBatch(const Program& program, const T* xs, T* ys, T* dys, std::size_t count, simd::SimdLevel level,
+			EvaluationScratch& scratch = threadScratch())
+		{
+			simd::DualBlockKernel<T> kernel = simd::dualBlockKernel<T>(level);
+			simd::KernelProgram view = kernelView(program);
+			T* stack = blockStack<T>(program, scratch, 2);
+
+			for (std::size_t done = 0; done < count; done += batchBlockSize)
+			{
+				std::size_t block = std::min(batchBlockSize, count - done);
+				kernel(view, xs + done, ys + done, dys + done, block, stack);
+			}
+		}
+
+		// long double and double-double have no vector registers, every sample runs the program on its own
+		template <typename T>
+		void runEach(const Program& program, const T* xs, T* const* ys, std::size_t count,
+			EvaluationScratch& scratch = threadScratch())
+		{
+			T* stack = scratch.blocks<T>(program.maxStack + program.slotCount);
+
+			for (std::size_t i = 0; i < count; i++)
+			{
+				run(program, xs[i], stack);
+				for (std::size_t output = 0; output < program.outputs; output++)
+					ys[output][i] = stack[output];
+			}
+		}
+	}
+
+	EvaluationScratch& threadScratch()
+	{
+		thread_local EvaluationScratch scratch;
+		return scratch;
+	}
+
+	void setExactMath(bool enabled)
+	{
+		exactMathEnabled = enabled;
+	}
+
+	bool exactMath()
+	{
+		return exactMathEnabled;
+	}
+
+	bool usesFastMath(const Program& program)
+	{
+		return std::any_of(program.code.begin(), program.code.end(), [](OpCode op) {
+			return op == OpCode::Exp || op == OpCode::Log || op == OpCode::Power;
+		});
+	}
+
+	float execute(const Program& program, float x)
+	{
+		return executeScalar(program, x);
+	}
+
+	double execute(const Program& program, double x)
+	{
+		return executeScalar(program, x);
+	}
+
+	long double execute(const Program& program, long double x)
+	{
+		return executeScalar(program, x);
+	}
+
+	void executeBatch(const Program& program, const float* xs, float* ys, std::size_t count)
+	{
+		runBatch(program, xs, ys, count, simd::detectedLevel());
+	}
+
+	void executeBatch(const Program& program, const float* xs, float* ys, std::size_t count, simd::SimdLevel level)
+	{
+		runBatch(program, xs, ys, count, level);
+	}
+
+	void executeBatch(const Program& program, const double* xs, double* ys, std::size_t count)
+	{
+		runBatch(program, xs, ys, count, simd::detectedLevel());
+	}
+
+	void executeBatch(const Program& program, const double* xs, double* ys, std::size_t count, simd::SimdLevel level)
+	{
+		runBatch(program, xs, ys, count, level);
+	}
+
+	void executeBatch(const Program& program, const float* xs, float* ys, std::size_t count, MathTier tier)
+	{
+		runBatch(program, xs, ys, count, simd::detectedLevel(), tier);
+	}
+
+	void executeBatch(const Program& program, const float* xs, float* const* ys, std::size_t count, MathTier tier)
+	{
+		runBatch(program, xs, ys, count, tier);
+	}
+
+	void executeBatch(const Program& program, const float* xs, float* ys, std::size_t count, MathTier tier, EvaluationScratch& scratch)
+	{
+		runBatch(program, xs, ys, count, simd::detectedLevel(), tier, scratch);
+	}
+
+	void executeBatch(const Program& program, const double* xs, double* ys, std::size_t count, EvaluationScratch& scratch)
+	{
+		runBatch(program, xs, ys, count, simd::detectedLevel(), MathTier::Full, scratch);
+	}
+
+	void executeBatch(const Program& program, const long double* xs, long double* ys, std::size_t count, EvaluationScratch& scratch)
+	{
+		runEach(program, xs, &ys, count, scratch);
+	}
+
+	void executeBatch(const Program& program, const DoubleDouble* xs, DoubleDouble* ys, std::size_t count, EvaluationScratch& scratch)
+	{
+		runEach(program, xs, &ys, count, scratch);
+	}
+
+	DoubleDouble execute(const Program& program, DoubleDouble x)
+	{
+		return executeScalar(program, x);
+	}
+
+	Interval execute(const Program& program, Interval x)
+	{
+		return executeScalar(program, x);
+	}
+
+	void executeBatch(const Program& program, const long double* xs, long double* ys, std::size_t count)
+	{
+		runEach(program, xs, &ys, count);
+	}
+
+	void executeBatch(const Program& program, const DoubleDouble* xs, DoubleDouble* ys, std::size_t count)
+	{
+		runEach(program, xs, &ys, count);
+	}
+
+	void executeBatch(const Program& program, const float* xs, float* const* ys, std::size_t count)
+	{
+		runBatch(program, xs, ys, count);
+	}
+
+	void executeBatch(const Program& program, const double* xs, double* const* ys, std::size_t count)
+	{
+		runBatch(program, xs, ys, count);
+	}
+
+	void executeBatch(const Program& program, const long double* xs, long double* const* ys, std::size_t count)
+	{
+		runEach(program, xs, ys, count);
+	}
+
+	void executeBatch(const Program& program, const DoubleDouble* xs, DoubleDouble* const* ys, std::size_t count)
+	{
+		runEach(program, xs, ys, count);
+	}
+
+	void differentiateBatch(const Program& program, const float* xs, float* ys, float* dys, std::size_t count)
+	{
+		runDualBatch(program, xs, ys, dys, count, simd::detectedLevel());
+	}
+
+	void differentiateBatch(const Program& program, const double* xs, double* ys, double* dys, std::size_t count)
+	{
+		runDualBatch(program, xs, ys, dys, count, simd::detectedLevel());
+	}
+
+	void differentiateBatch(const Program& program, const float* xs, float* ys, float* dys, std::size_t count, simd::SimdLevel level)
+	{
+		runDualBatch(program, xs, ys, dys, count, level);
+	}
+
+	void differentiateBatch(const Program& program, const double* xs, double* ys, double* dys, std::size_t count, simd::SimdLevel level)
+	{
+		runDualBatch(program, xs, ys, dys, count, level);
+	}
+
+	void differentiateBatch(const Program& program, const float* xs, float* ys, float* dys, std::size_t count, EvaluationScratch& scratch)
+	{
+		runDualBatch(program, xs, ys, dys, count, simd::detectedLevel(), scratch);
+	}
+
+	void differentiateBatch(const Program& program, const double* xs, double* ys, double* dys, std::size_t count, EvaluationScratch& scratch)
+	{
+		runDualBatch(program, xs, ys, dys, count, simd::detectedLevel(), scratch);
+	}
+}
\ No newline at end of file
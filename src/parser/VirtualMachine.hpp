@@ -0,0 +1,109 @@
+#pragma once
+#include "Bytecode.hpp"
+#include "DoubleDouble.hpp"
+#include "Interval.hpp"
+#include "simd/SimdLevel.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace parser
+{
+	// number of samples every op is applied to before moving to the next op
+	constexpr std::size_t batchBlockSize = 256;
+
+	// buffers the batch paths run in: the stack and slot blocks of the kernels and the constants of native
+	// code with parameters. Programs and compiled expressions hold no state of their own while they run, so
+	// one of them can be evaluated by any number of threads at once as long as each brings its own scratch.
+	// The buffers only grow, later calls with programs no larger than the ones before allocate nothing
+	class EvaluationScratch
+	{
+	public:
+		// count entries aligned to the widest vector register, valid until the next call for the same type
+		template <typename T>
+		T* blocks(std::size_t count)
+		{
+			constexpr std::size_t alignment = 64 / sizeof(T);
+			std::vector<T>& storage = std::get<std::vector<T>>(buffers);
+			if (storage.size() < count + alignment)
+				storage.resize(count + alignment);
+
+			T* data = storage.data();
+			return data + (alignment - reinterpret_cast<std::uintptr_t>(data) / sizeof(T) % alignment) % alignment;
+		}
+
+		std::vector<float>& constants() { return pool; }
+	private:
+		std::tuple<std::vector<float>, std::vector<double>, std::vector<long double>, std::vector<DoubleDouble>> buffers;
+		std::vector<float> pool;
+	};
+
+	// scratch of the calling thread, used by every overload that takes none
+	EvaluationScratch& threadScratch();
+
+	// batch evaluation uses the in-tree vector math library unless exact math is enabled,
+	// which calls libm for every lane and matches the per-sample path bit for bit
+	void setExactMath(bool enabled);
+	bool exactMath();
+
+	// float batches can trade accuracy in exp, log and pow for speed, see VectorMath.inl
+	enum class MathTier : std::uint8_t
+	{
+		Full, // the vector math library, a few ulp
+		Fast // shorter polynomials, relative error below fastMathError
+	};
+
+	// worst case relative error of the fast tier for results in the normal range, about 2^-11
+	constexpr double fastMathError = 4.9e-4;
+
+	// false if the program has no op the fast tier evaluates differently
+	bool usesFastMath(const Program& program);
+
+	// the program's constants are rounded to the type of x, every op runs in that type
+	float execute(const Program& program, float x);
+	double execute(const Program& program, double x);
+	long double execute(const Program& program, long double x);
+	DoubleDouble execute(const Program& program, DoubleDouble x);
+
+	// encloses every value the program takes for x in the interval, constants are taken as exact
+	Interval execute(const Program& program, Interval x);
+
+	// runs on the widest simd level the cpu supports
+	void executeBatch(const Program& program, const float* xs, float* ys, std::size_t count);
+	void executeBatch(const Program& program, const double* xs, double* ys, std::size_t count);
+
+	void executeBatch(const Program& program, const float* xs, float* ys, std::size_t count, simd::SimdLevel level);
+	void executeBatch(const Program& program, const double* xs, double* ys, std::size_t count, simd::SimdLevel level);
+
+	// on the widest simd level with the given tier of the math functions, ignored while exact math is on
+	void executeBatch(const Program& program, const float* xs, float* ys, std::size_t count, MathTier tier);
+	void executeBatch(const Program& program, const float* xs, float* const* ys, std::size_t count, MathTier tier);
+
+	// in caller provided scratch instead of the thread's
+	void executeBatch(const Program& program, const float* xs, float* ys, std::size_t count, MathTier tier, EvaluationScratch& scratch);
+	void executeBatch(const Program& program, const double* xs, double* ys, std::size_t count, EvaluationScratch& scratch);
+	void executeBatch(const Program& program, const long double* xs, long double* ys, std::size_t count, EvaluationScratch& scratch);
+	void executeBatch(const Program& program, const DoubleDouble* xs, DoubleDouble* ys, std::size_t count, EvaluationScratch& scratch);
+
+	// no simd path, runs the program once per sample
+	void executeBatch(const Program& program, const long double* xs, long double* ys, std::size_t count);
+	void executeBatch(const Program& program, const DoubleDouble* xs, DoubleDouble* ys, std::size_t count);
+
+	// programs with several outputs, ys[k] receives output k
+	void executeBatch(const Program& program, const float* xs, float* const* ys, std::size_t count);
+	void executeBatch(const Program& program, const double* xs, double* const* ys, std::size_t count);
+	void executeBatch(const Program& program, const long double* xs, long double* const* ys, std::size_t count);
+	void executeBatch(const Program& program, const DoubleDouble* xs, DoubleDouble* const* ys, std::size_t count);
+
+	// f and its derivative f' with respect to x in one sweep, by forward mode differentiation on the
+	// simd kernels; ys matches executeBatch on the same level bit for bit. Only single output programs
+	void differentiateBatch(const Program& program, const float* xs, float* ys, float* dys, std::size_t count);
+	void differentiateBatch(const Program& program, const double* xs, double* ys, double* dys, std::size_t count);
+
+	void differentiateBatch(const Program& program, const float* xs, float* ys, float* dys, std::size_t count, simd::SimdLevel level);
+	void differentiateBatch(const Program& program, const double* xs, double* ys, double* dys, std::size_t count, simd::SimdLevel level);
+
+	void differentiateBatch(const Program& program, const float* xs, float* ys, float* dys, std::size_t count, EvaluationScratch& scratch);
+	void differentiateBatch(const Program& program, const double* xs, double* ys, double* dys, std::size_t count, EvaluationScratch& scratch);
+}
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "Assembler.hpp"
+
+namespace parser::jit
+{
+	namespace
+	{
+		std::uint8_t low3(std::uint8_t reg)
+		{
+			return reg & 7u;
+		}
+
+		std::uint8_t high1(std::uint8_t reg)
+		{
+			return (reg >> 3) & 1u;
+		}
+
+		std::uint8_t id(Gpr reg)
+		{
+			return static_cast<std::uint8_t>(reg);
+		}
+	}
+
+	void Assembler::emit32(std::uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+			emit(static_cast<std::uint8_t>(value >> (8 * i)));
+	}
+
+	void Assembler::patch32(std::size_t at, std::uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+			bytes[at + i] = static_cast<std::uint8_t>(value >> (8 * i));
+	}
+
+	void Assembler::rex(bool wide, std::uint8_t reg, std::uint8_t base)
+	{
+		std::uint8_t prefix = 0x40 | (wide ? 0x08 : 0) | (high1(reg) << 2) | high1(base);
+		if (prefix != 0x40)
+			emit(prefix);
+	}
+
+	void Assembler::modRegister(std::uint8_t reg, std::uint8_t rm)
+	{
+		emit(0xc0 | (low3(reg) << 3) | low3(rm));
+	}
+
+	void Assembler::modMemory(std::uint8_t reg, Gpr base, std::int32_t displacement)
+	{
+		emit(0x80 | (low3(reg) << 3) | low3(id(base)));
+
+		// rsp and r12 as base need a sib byte
+		if (low3(id(base)) == 4)
+			emit(0x24);
+
+		emit32(static_cast<std::uint32_t>(displacement));
+	}
+
+	void Assembler::push(Gpr reg)
+	{
+		rex(false, 0, id(reg));
+		emit(0x50 + low3(id(reg)));
+	}
+
+	void Assembler::pop(Gpr reg)
+	{
+		rex(false, 0, id(reg));
+		emit(0x58 + low3(id(reg)));
+	}
+
+	void Assembler::ret()
+	{
+		emit(0xc3);
+	}
+
+	void Assembler::mov(Gpr dst, Gpr src)
+	{
+		rex(true, id(src), id(dst));
+		emit(0x89);
+		modRegister(id(src), id(dst));
+	}
+
+	void Assembler::movImmediate(Gpr dst, std::uint64_t value)
+	{
+		rex(true, 0, id(dst));
+		emit(0xb8 + low3(id(dst)));
+		emit32(static_cast<std::uint32_t>(value));
+		emit32(static_cast<std::uint32_t>(value >> 32));
+	}
+
+	void Assembler::lea(Gpr dst, Gpr base, std::int32_t displacement)
+	{
+		rex(true, id(dst), id(base));
+		emit(0x8d);
+		modMemory(id(dst), base, displacement);
+	}
+
+	void Assembler::addImmediate(Gpr dst, std::int32_t value)
+	{
+		rex(true, 0, id(dst));
+		emit(0x81);
+		modRegister(0, id(dst));
+		emit32(static_cast<std::uint32_t>(value));
+	}
+
+	void Assembler::subImmediate(Gpr dst, std::int32_t value)
+	{
+		rex(true, 0, id(dst));
+		emit(0x81);
+		modRegister(5, id(dst));
+		emit32(static_cast<std::uint32_t>(value));
+	}
+
+	void Assembler::decrement(Gpr reg)
+	{
+		rex(true, 0, id(reg));
+		emit(0xff);
+		modRegister(1, id(reg));
+	}
+
+	void Assembler::test(Gpr a, Gpr b)
+	{
+		rex(true, id(b), id(a));
+		emit(0x85);
+		modRegister(id(b), id(a));
+	}
+
+	void Assembler::call(Gpr target)
+	{
+		rex(false, 0, id(target));
+		emit(0xff);
+		modRegister(2, id(target));
+	}
+
+	std::size_t Assembler::jumpIfZero()
+	{
+		emit(0x0f);
+		emit(0x84);
+		std::size_t at = position();
+		emit32(0);
+		return at;
+	}
+
+	void Assembler::bind(std::size_t jump)
+	{
+		patch32(jump, static_cast<std::uint32_t>(position() - (jump + 4)));
+	}
+
+	void Assembler::jumpIfNotZero(std::size_t target)
+	{
+		emit(0x0f);
+		emit(0x85);
+		std::int64_t offset = static_cast<std::int64_t>(target) - static_cast<std::int64_t>(position() + 4);
+		emit32(static_cast<std::uint32_t>(offset));
+	}
+
+	void Assembler::vex(std::uint8_t reg, std::uint8_t vvvv, std::uint8_t rm, std::uint8_t map, std::uint8_t prefix, bool wide256)
+	{
+		// r, x, b and vvvv are stored inverted
+		emit(0xc4);
+		emit(((~high1(reg) & 1u) << 7) | (1u << 6) | ((~high1(rm) & 1u) << 5) | map);
+		emit(((~vvvv & 0xfu) << 3) | (wide256 ? 0x04 : 0) | prefix);
+	}
+
+	void Assembler::vectorRegister(std::uint8_t opcode, Ymm dst, Ymm a, Ymm b)
+	{
+		vex(dst, a, b, 1, 0, true);
+		emit(opcode);
+		modRegister(dst, b);
+	}
+
+	void Assembler::vectorMemory(std::uint8_t opcode, std::uint8_t map, std::uint8_t prefix, bool wide256, Ymm reg, Gpr base, std::int32_t displacement)
+	{
+		vex(reg, 0, id(base), map, prefix, wide256);
+		emit(opcode);
+		modMemory(reg, base, displacement);
+	}
+
+	void Assembler::vmovupsLoad(Ymm dst, Gpr base, std::int32_t displacement)
+	{
+		vectorMemory(0x10, 1, 0, true, dst, base, displacement);
+	}
+
+	void Assembler::vmovupsStore(Gpr base, std::int32_t displacement, Ymm src)
+	{
+		vectorMemory(0x11, 1, 0, true, src, base, displacement);
+	}
+
+	void Assembler::vmovupsLoad128(Ymm dst, Gpr base, std::int32_t displacement)
+	{
+		vectorMemory(0x10, 1, 0, false, dst, base, displacement);
+	}
+
+	void Assembler::vmovupsStore128(Gpr base, std::int32_t displacement, Ymm src)
+	{
+		vectorMemory(0x11, 1, 0, false, src, base, displacement);
+	}
+
+	void Assembler::vbroadcastss(Ymm dst, Gpr base, std::int32_t displacement)
+	{
+		vectorMemory(0x18, 2, 1, true, dst, base, displacement);
+	}
+
+	void Assembler::vaddps(Ymm dst, Ymm a, Ymm b) { vectorRegister(0x58, dst, a, b); }
+	void Assembler::vsubps(Ymm dst, Ymm a, Ymm b) { vectorRegister(0x5c, dst, a, b); }
+	void Assembler::vmulps(Ymm dst, Ymm a, Ymm b) { vectorRegister(0x59, dst, a, b); }
+	void Assembler::vdivps(Ymm dst, Ymm a, Ymm b) { vectorRegister(0x5e, dst, a, b); }
+	void Assembler::vxorps(Ymm dst, Ymm a, Ymm b) { vectorRegister(0x57, dst, a, b); }
+	void Assembler::vandps(Ymm dst, Ymm a, Ymm b) { vectorRegister(0x54, dst, a, b); }
+	void Assembler::vandnps(Ymm dst, Ymm a, Ymm b) { vectorRegister(0x55, dst, a, b); }
+	void Assembler::vminps(Ymm dst, Ymm a, Ymm b) { vectorRegister(0x5d, dst, a, b); }
+	void Assembler::vmaxps(Ymm dst, Ymm a, Ymm b) { vectorRegister(0x5f, dst, a, b); }
+
+	void Assembler::vcmpps(Ymm dst, Ymm a, Ymm b, std::uint8_t predicate)
+	{
+		vectorRegister(0xc2, dst, a, b);
+		emit(predicate);
+	}
+
+	// the mask register goes in the top four bits of the immediate
+	void Assembler::vblendvps(Ymm dst, Ymm a, Ymm b, Ymm mask)
+	{
+		vex(dst, a, b, 3, 1, true);
+		emit(0x4a);
+		modRegister(dst, b);
+		emit(static_cast<std::uint8_t>(mask << 4));
+	}
+
+	void Assembler::vsqrtps(Ymm dst, Ymm src)
+	{
+		vectorRegister(0x51, dst, 0, src);
+	}
+
+	void Assembler::vzeroupper()
+	{
+		emit(0xc5);
+		emit(0xf8);
+		emit(0x77);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace parser::jit
+{
+	enum class Gpr : std::uint8_t
+	{
+		Rax, Rcx, Rdx, Rbx, Rsp, Rbp, Rsi, Rdi,
+		R8, R9, R10, R11, R12, R13, R14, R15
+	};
+
+	// ymm0 - ymm15
+	using Ymm = std::uint8_t;
+
+	// encoder for the handful of x86-64 and avx instructions the native code generator needs.
+	// memory operands are always [base + disp32]
+	class Assembler
+	{
+	public:
+		const std::vector<std::uint8_t>& code() const { return bytes; }
+		std::size_t position() const { return bytes.size(); }
+
+		void push(Gpr reg);
+		void pop(Gpr reg);
+		void ret();
+
+		void mov(Gpr dst, Gpr src);
+		void movImmediate(Gpr dst, std::uint64_t value);
+		void lea(Gpr dst, Gpr base, std::int32_t displacement);
+		void addImmediate(Gpr dst, std::int32_t value);
+		void subImmediate(Gpr dst, std::int32_t value);
+		void decrement(Gpr reg);
+		void test(Gpr a, Gpr b);
+		void call(Gpr target);
+
+		// forward jump, returns the location to hand to bind once the target is known
+		std::size_t jumpIfZero();
+		void bind(std::size_t jump);
+		void jumpIfNotZero(std::size_t target);
+
+		void vmovupsLoad(Ymm dst, Gpr base, std::int32_t displacement);
+		void vmovupsStore(Gpr base, std::int32_t displacement, Ymm src);
+		void vmovupsLoad128(Ymm dst, Gpr base, std::int32_t displacement);
+		void vmovupsStore128(Gpr base, std::int32_t displacement, Ymm src);
+		void vbroadcastss(Ymm dst, Gpr base, std::int32_t displacement);
+
+		void vaddps(Ymm dst, Ymm a, Ymm b);
+		void vsubps(Ymm dst, Ymm a, Ymm b);
+		void vmulps(Ymm dst, Ymm a, Ymm b);
+		void vdivps(Ymm dst, Ymm a, Ymm b);
+		void vxorps(Ymm dst, Ymm a, Ymm b);
+		void vandps(Ymm dst, Ymm a, Ymm b);
+		void vandnps(Ymm dst, Ymm a, Ymm b); // ~a & b
+		void vminps(Ymm dst, Ymm a, Ymm b);
+		void vmaxps(Ymm dst, Ymm a, Ymm b);
+		void vsqrtps(Ymm dst, Ymm src);
+
+		// all ones in the lanes where the predicate holds for a and b, predicates as in _mm256_cmp_ps
+		void vcmpps(Ymm dst, Ymm a, Ymm b, std::uint8_t predicate);
+
+		// b in the lanes whose mask sign bit is set, a elsewhere
+		void vblendvps(Ymm dst, Ymm a, Ymm b, Ymm mask);
+		void vzeroupper();
+	private:
+		std::vector<std::uint8_t> bytes;
+
+		void emit(std::uint8_t byte) { bytes.push_back(byte); }
+		void emit32(std::uint32_t value);
+		void patch32(std::size_t at, std::uint32_t value);
+
+		void rex(bool wide, std::uint8_t reg, std::uint8_t base);
+		void modRegister(std::uint8_t reg, std::uint8_t rm);
+		void modMemory(std::uint8_t reg, Gpr base, std::int32_t displacement);
+
+		// three byte vex prefix; map 1 is 0f, 2 is 0f38, 3 is 0f3a; prefix 0 is none, 1 is 66
+		void vex(std::uint8_t reg, std::uint8_t vvvv, std::uint8_t rm, std::uint8_t map, std::uint8_t prefix, bool wide256);
+		void vectorRegister(std::uint8_t opcode, Ymm dst, Ymm a, Ymm b);
+		void vectorMemory(std::uint8_t opcode, std::uint8_t map, std::uint8_t prefix, bool wide256, Ymm reg, Gpr base, std::int32_t displacement);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "ExecutableMemory.hpp"
+#include <cstring>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace parser::jit
+{
+	namespace
+	{
+		std::size_t pageSize()
+		{
+#if defined(_WIN32)
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwPageSize;
+#else
+			return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+		}
+	}
+
+	ExecutableMemory::ExecutableMemory(const std::vector<std::uint8_t>& code)
+	{
+		if (code.empty())
+			return;
+
+		std::size_t page = pageSize();
+		std::size_t size = (code.size() + page - 1) / page * page;
+
+		// never writable and executable at the same time
+#if defined(_WIN32)
+		void* memory = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (!memory)
+			return;
+
+		std::memcpy(memory, code.data(), code.size());
+
+		DWORD previous;
+		if (!VirtualProtect(memory, size, PAGE_EXECUTE_READ, &previous))
+		{
+			VirtualFree(memory, 0, MEM_RELEASE);
+			return;
+		}
+
+		FlushInstructionCache(GetCurrentProcess(), memory, size);
+#else
+		void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED)
+			return;
+
+		std::memcpy(memory, code.data(), code.size());
+
+		if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+		{
+			munmap(memory, size);
+			return;
+		}
+#endif
+
+		pages = memory;
+		mappedSize = size;
+		codeSize = code.size();
+	}
+
+	ExecutableMemory::~ExecutableMemory()
+	{
+		release();
+	}
+
+	ExecutableMemory::ExecutableMemory(ExecutableMemory&& other) noexcept
+		: pages(std::exchange(other.pages, nullptr)),
+		mappedSize(std::exchange(other.mappedSize, 0)),
+		codeSize(std::exchange(other.codeSize, 0)) {}
+
+	ExecutableMemory& ExecutableMemory::operator=(ExecutableMemory&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			pages = std::exchange(other.pages, nullptr);
+			mappedSize = std::exchange(other.mappedSize, 0);
+			codeSize = std::exchange(other.codeSize, 0);
+		}
+
+		return *this;
+	}
+
+	void ExecutableMemory::release()
+	{
+		if (!pages)
+			return;
+
+#if defined(_WIN32)
+		VirtualFree(pages, 0, MEM_RELEASE);
+#else
+		munmap(pages, mappedSize);
+#endif
+		pages = nullptr;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace parser::jit
+{
+	// pages holding generated machine code, writable while copying and executable afterwards
+	class ExecutableMemory
+	{
+	public:
+		ExecutableMemory() = default;
+
+		// empty if the os refuses to hand out executable pages
+		explicit ExecutableMemory(const std::vector<std::uint8_t>& code);
+		~ExecutableMemory();
+
+		ExecutableMemory(ExecutableMemory&& other) noexcept;
+		ExecutableMemory& operator=(ExecutableMemory&& other) noexcept;
+		ExecutableMemory(const ExecutableMemory&) = delete;
+		ExecutableMemory& operator=(const ExecutableMemory&) = delete;
+
+		const void* data() const { return pages; }
+		std::size_t size() const { return codeSize; }
+		explicit operator bool() const { return pages != nullptr; }
+	private:
+		void* pages = nullptr;
+		std::size_t mappedSize = 0;
+		std::size_t codeSize = 0;
+
+		void release();
+	};
+}
\ No newline at end of file
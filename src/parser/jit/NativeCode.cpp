@@ -0,0 +1,441 @@
+#include "NativeCode.hpp"
+#include "Assembler.hpp"
+#include "../Parameters.hpp"
+#include "../VirtualMachine.hpp"
+#include "../simd/Kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+namespace parser::jit
+{
+#if PARSER_JIT_X64
+	namespace
+	{
+		using simd::MathFunction;
+
+		// ymm15 is scratch, the rest hold the stack
+		constexpr std::size_t maxRegisters = 15;
+
+		// frame below the saved registers: win64 shadow space, register spills around
+		// calls into the math library, the callee saved xmm6 - xmm15 on win64, then the
+		// program's slots. Kept below one page so windows needs no stack probes
+		constexpr std::int32_t shadowSpace = 32;
+		constexpr std::int32_t spillOffset = shadowSpace;
+		constexpr std::int32_t spillSlot = 32;
+		constexpr std::int32_t xmmSaveOffset = spillOffset + 16 * spillSlot;
+		constexpr std::int32_t slotOffset = xmmSaveOffset + 10 * 16;
+		constexpr std::size_t maxSlots = 64;
+
+		// rsp is 8 off 16 byte alignment after the four pushes, the frame restores it for calls
+		std::int32_t frameSize(std::size_t slotCount)
+		{
+			std::int32_t size = slotOffset + static_cast<std::int32_t>(slotCount) * spillSlot;
+			return size + (24 - size % 16) % 16;
+		}
+
+		constexpr Ymm scratch = 15;
+
+		// vcmpps predicates, the same the avx2 kernel compares with
+		constexpr std::uint8_t notEqualUnordered = 0x04;
+		constexpr std::uint8_t lessOrdered = 0x11;
+		constexpr std::uint8_t lessEqualOrdered = 0x12;
+
+		// loop state lives in callee saved registers so it survives the math calls
+		constexpr Gpr xsRegister = Gpr::R12;
+		constexpr Gpr ysRegister = Gpr::R13;
+		constexpr Gpr blocksRegister = Gpr::R14;
+		constexpr Gpr constantsRegister = Gpr::R15;
+
+#if defined(_WIN32)
+		constexpr Gpr argumentRegisters[] = { Gpr::Rcx, Gpr::Rdx, Gpr::R8, Gpr::R9 };
+		constexpr bool savesXmm = true;
+#else
+		constexpr Gpr argumentRegisters[] = { Gpr::Rdi, Gpr::Rsi, Gpr::Rdx, Gpr::Rcx };
+		constexpr bool savesXmm = false;
+#endif
+
+		// called from generated code with the spilled operand lanes, pow reads its exponents
+		// from the next spill slot. Uses the avx2 library so results match the avx2 batch kernel
+		void applyMath(float* lanes, std::uint32_t function)
+		{
+			MathFunction math = static_cast<MathFunction>(function);
+
+			if (!exactMath())
+			{
+				simd::vectorMathLanesAvx2(math, lanes);
+				return;
+			}
+
+			for (std::size_t i = 0; i < nativeLanes; i++)
+			{
+				float a = lanes[i];
+				switch (math)
+				{
+				case MathFunction::Sin: lanes[i] = std::sin(a); break;
+				case MathFunction::Cos: lanes[i] = std::cos(a); break;
+				case MathFunction::Tan: lanes[i] = std::tan(a); break;
+				case MathFunction::Log:
+				case MathFunction::FastLog: lanes[i] = std::log(a); break;
+				case MathFunction::Exp:
+				case MathFunction::FastExp: lanes[i] = std::exp(a); break;
+				case MathFunction::Sqrt: lanes[i] = std::sqrt(a); break;
+				case MathFunction::Pow:
+				case MathFunction::FastPow: lanes[i] = std::pow(a, lanes[i + nativeLanes]); break;
+				}
+			}
+		}
+
+		bool mathFunction(OpCode op, MathTier tier, MathFunction& function)
+		{
+			bool fast = tier == MathTier::Fast;
+
+			switch (op)
+			{
+			case OpCode::Sin: function = MathFunction::Sin; return true;
+			case OpCode::Cos: function = MathFunction::Cos; return true;
+			case OpCode::Tan: function = MathFunction::Tan; return true;
+			case OpCode::Log: function = fast ? MathFunction::FastLog : MathFunction::Log; return true;
+			case OpCode::Exp: function = fast ? MathFunction::FastExp : MathFunction::Exp; return true;
+			case OpCode::Power: function = fast ? MathFunction::FastPow : MathFunction::Pow; return true;
+			default: return false;
+			}
+		}
+
+		std::int32_t spill(std::size_t slot)
+		{
+			return spillOffset + static_cast<std::int32_t>(slot) * spillSlot;
+		}
+
+		std::int32_t slotAddress(std::uint32_t slot)
+		{
+			return slotOffset + static_cast<std::int32_t>(slot) * spillSlot;
+		}
+
+		class CodeGenerator
+		{
+		public:
+			CodeGenerator(const Program& program, MathTier tier, std::int32_t signIndex)
+				: program(program), tier(tier), signOffset(signIndex * static_cast<std::int32_t>(sizeof(float))),
+				oneOffset(signOffset + static_cast<std::int32_t>(sizeof(float))),
+				parameterOffset(oneOffset + static_cast<std::int32_t>(sizeof(float))),
+				frame(frameSize(program.slotCount)) {}
+
+			std::vector<std::uint8_t> run()
+			{
+				prologue();
+
+				assembler.test(blocksRegister, blocksRegister);
+				std::size_t done = assembler.jumpIfZero();
+
+				std::size_t loop = assembler.position();
+				body();
+				storeOutputs();
+				assembler.addImmediate(xsRegister, spillSlot);
+				assembler.addImmediate(ysRegister, spillSlot);
+				assembler.decrement(blocksRegister);
+				assembler.jumpIfNotZero(loop);
+
+				assembler.bind(done);
+				epilogue();
+
+				return assembler.code();
+			}
+		private:
+			const Program& program;
+			MathTier tier;
+			std::int32_t signOffset;
+			std::int32_t oneOffset;
+			std::int32_t parameterOffset; // of the first parameter op's entry in the pool
+			std::int32_t frame;
+			Assembler assembler;
+
+			void prologue()
+			{
+				assembler.push(Gpr::R12);
+				assembler.push(Gpr::R13);
+				assembler.push(Gpr::R14);
+				assembler.push(Gpr::R15);
+				assembler.subImmediate(Gpr::Rsp, frame);
+
+				if (savesXmm)
+				{
+					for (Ymm reg = 6; reg < 16; reg++)
+						assembler.vmovupsStore128(Gpr::Rsp, xmmSaveOffset + 16 * (reg - 6), reg);
+				}
+
+				assembler.mov(xsRegister, argumentRegisters[0]);
+				assembler.mov(ysRegister, argumentRegisters[1]);
+				assembler.mov(blocksRegister, argumentRegisters[2]);
+				assembler.mov(constantsRegister, argumentRegisters[3]);
+			}
+
+			void epilogue()
+			{
+				assembler.vzeroupper();
+
+				if (savesXmm)
+				{
+					for (Ymm reg = 6; reg < 16; reg++)
+						assembler.vmovupsLoad128(reg, Gpr::Rsp, xmmSaveOffset + 16 * (reg - 6));
+				}
+
+				assembler.addImmediate(Gpr::Rsp, frame);
+				assembler.pop(Gpr::R15);
+				assembler.pop(Gpr::R14);
+				assembler.pop(Gpr::R13);
+				assembler.pop(Gpr::R12);
+				assembler.ret();
+			}
+
+			// stack slot i is ymm i
+			void body()
+			{
+				std::size_t depth = 0;
+				std::int32_t constant = 0;
+				std::int32_t parameter = parameterOffset;
+				std::size_t slot = 0;
+
+				for (OpCode op : program.code)
+				{
+					Ymm top = static_cast<Ymm>(depth - 1);
+					Ymm below = static_cast<Ymm>(depth - 2);
+					MathFunction function;
+
+					if (mathFunction(op, tier, function))
+					{
+						callMath(function, depth, op == OpCode::Power ? 2 : 1);
+						if (op == OpCode::Power)
+							depth--;
+						continue;
+					}
+
+					switch (op)
+					{
+					case OpCode::Constant:
+						assembler.vbroadcastss(static_cast<Ymm>(depth++), constantsRegister, constant);
+						constant += static_cast<std::int32_t>(sizeof(float));
+						break;
+					case OpCode::Variable:
+						assembler.vmovupsLoad(static_cast<Ymm>(depth++), xsRegister, 0);
+						break;
+					case OpCode::Parameter:
+						assembler.vbroadcastss(static_cast<Ymm>(depth++), constantsRegister, parameter);
+						parameter += static_cast<std::int32_t>(sizeof(float));
+						slot++;
+						break;
+					case OpCode::Negate:
+						assembler.vbroadcastss(scratch, constantsRegister, signOffset);
+						assembler.vxorps(top, top, scratch);
+						break;
+					case OpCode::Add: assembler.vaddps(below, below, top); depth--; break;
+					case OpCode::Subtract: assembler.vsubps(below, below, top); depth--; break;
+					case OpCode::Multiply: assembler.vmulps(below, below, top); depth--; break;
+					case OpCode::Divide: assembler.vdivps(below, below, top); depth--; break;
+					case OpCode::Sqrt: assembler.vsqrtps(top, top); break;
+					case OpCode::Abs:
+						assembler.vbroadcastss(scratch, constantsRegister, signOffset);
+						assembler.vandnps(top, scratch, top);
+						break;
+					case OpCode::Minimum: assembler.vminps(below, below, top); depth--; break;
+					case OpCode::Maximum: assembler.vmaxps(below, below, top); depth--; break;
+					case OpCode::Less: compare(below, top, lessOrdered); depth--; break;
+					case OpCode::LessEqual: compare(below, top, lessEqualOrdered); depth--; break;
+					case OpCode::Select:
+					{
+						// both branches were computed, Then and Else never skip in native code
+						Ymm condition = static_cast<Ymm>(depth - 3);
+						assembler.vxorps(scratch, scratch, scratch);
+						assembler.vcmpps(scratch, condition, scratch, notEqualUnordered);
+						assembler.vblendvps(condition, top, below, scratch);
+						depth -= 2;
+						break;
+					}
+					case OpCode::Store:
+						assembler.vmovupsStore(Gpr::Rsp, slotAddress(program.slots[slot++]), top);
+						break;
+					case OpCode::Load:
+						assembler.vmovupsLoad(static_cast<Ymm>(depth++), Gpr::Rsp, slotAddress(program.slots[slot++]));
+						break;
+					default: break;
+					}
+				}
+			}
+
+			// 1 or 0 per lane, from the all ones or all zeros mask
+			void compare(Ymm a, Ymm b, std::uint8_t predicate)
+			{
+				assembler.vcmpps(a, a, b, predicate);
+				assembler.vbroadcastss(scratch, constantsRegister, oneOffset);
+				assembler.vandps(a, a, scratch);
+			}
+
+			// output k is stack entry k and goes to block k of the output buffer
+			void storeOutputs()
+			{
+				for (std::size_t output = 0; output < program.outputs; output++)
+				{
+					std::int32_t offset = static_cast<std::int32_t>(output * batchBlockSize * sizeof(float));
+					assembler.vmovupsStore(ysRegister, offset, static_cast<Ymm>(output));
+				}
+			}
+
+			// every ymm register is caller saved, so the whole stack goes through memory
+			void callMath(MathFunction function, std::size_t depth, std::size_t operands)
+			{
+				for (std::size_t slot = 0; slot < depth; slot++)
+					assembler.vmovupsStore(Gpr::Rsp, spill(slot), static_cast<Ymm>(slot));
+
+				assembler.lea(argumentRegisters[0], Gpr::Rsp, spill(depth - operands));
+				assembler.movImmediate(argumentRegisters[1], static_cast<std::uint64_t>(function));
+				assembler.movImmediate(Gpr::Rax, reinterpret_cast<std::uint64_t>(&applyMath));
+				assembler.vzeroupper();
+				assembler.call(Gpr::Rax);
+
+				for (std::size_t slot = 0; slot + operands <= depth; slot++)
+					assembler.vmovupsLoad(static_cast<Ymm>(slot), Gpr::Rsp, spill(slot));
+			}
+		};
+
+		bool supported()
+		{
+			simd::SimdLevel level = simd::detectedLevel();
+			return level == simd::SimdLevel::Avx2 || level == simd::SimdLevel::Avx512;
+		}
+	}
+#endif
+
+	NativeFunction::NativeFunction(ExecutableMemory code, std::vector<float> constants, std::vector<std::uint32_t> parameters, std::size_t outputs)
+		: memory(std::move(code)), pool(std::move(constants)), parameterSlots(std::move(parameters)), outputCount(outputs)
+	{
+		entry = reinterpret_cast<Entry>(const_cast<void*>(memory.data()));
+	}
+
+	const float* NativeFunction::constants(EvaluationScratch& scratch) const
+	{
+		if (parameterSlots.empty())
+			return pool.data();
+
+		std::vector<float>& values = scratch.constants();
+		values.assign(pool.begin(), pool.end());
+		std::size_t first = pool.size() - parameterSlots.size();
+		for (std::size_t i = 0; i < parameterSlots.size(); i++)
+			values[first + i] = static_cast<float>(parameterValue(parameterSlots[i]));
+
+		return values.data();
+	}
+
+	void NativeFunction::evaluate(const float* xs, float* ys, std::size_t count) const
+	{
+		evaluate(xs, ys, count, threadScratch());
+	}
+
+	void NativeFunction::evaluate(const float* xs, float* ys, std::size_t count, EvaluationScratch& scratch) const
+	{
+		const float* values = constants(scratch);
+
+		std::size_t blocks = count / nativeLanes;
+		entry(xs, ys, blocks, values);
+
+		std::size_t done = blocks * nativeLanes;
+		if (done == count)
+			return;
+
+		// the tail runs as one zero padded block
+		float in[nativeLanes] = {};
+		float out[nativeLanes];
+		std::copy(xs + done, xs + count, in);
+		entry(in, out, 1, values);
+		std::copy(out, out + (count - done), ys + done);
+	}
+
+	void NativeFunction::evaluate(const float* xs, float* const* ys, std::size_t count) const
+	{
+		evaluate(xs, ys, count, threadScratch());
+	}
+
+	void NativeFunction::evaluate(const float* xs, float* const* ys, std::size_t count, EvaluationScratch& scratch) const
+	{
+		if (outputCount == 1)
+		{
+			evaluate(xs, ys[0], count, scratch);
+			return;
+		}
+
+		const float* values = constants(scratch);
+
+		// the generated code writes output k to block k of the buffer, one chunk of batchBlockSize at a time
+		float* buffer = scratch.blocks<float>(outputCount * batchBlockSize);
+
+		for (std::size_t done = 0; done < count; done += batchBlockSize)
+		{
+			std::size_t chunk = std::min(batchBlockSize, count - done);
+			std::size_t blocks = chunk / nativeLanes;
+			entry(xs + done, buffer, blocks, values);
+
+			std::size_t filled = blocks * nativeLanes;
+			if (filled != chunk)
+			{
+				float in[nativeLanes] = {};
+				std::copy(xs + done + filled, xs + done + chunk, in);
+				entry(in, buffer + filled, 1, values);
+			}
+
+			for (std::size_t output = 0; output < outputCount; output++)
+			{
+				const float* results = buffer + output * batchBlockSize;
+				std::copy(results, results + chunk, ys[output] + done);
+			}
+		}
+	}
+
+	std::unique_ptr<const NativeFunction> compileNative(const Program& program, MathTier tier)
+	{
+#if PARSER_JIT_X64
+		if (!supported() || program.maxStack > maxRegisters || program.slotCount > maxSlots || program.code.empty())
+			return nullptr;
+
+		// the generated code runs straight through, loops stay on the simd kernels
+		if (std::any_of(program.code.begin(), program.code.end(), [](OpCode op) {
+			return op == OpCode::SumBegin || op == OpCode::ProductBegin;
+		}))
+			return nullptr;
+
+		// native code runs in float only
+		std::vector<float> pool;
+		pool.reserve(program.constants.size() + 2);
+		for (double constant : program.constants)
+			pool.push_back(static_cast<float>(constant));
+
+		std::int32_t signIndex = static_cast<std::int32_t>(pool.size());
+		pool.push_back(-0.f);
+		pool.push_back(1.f);
+
+		// filled in with the current values on every call
+		std::vector<std::uint32_t> parameters;
+		std::size_t slot = 0;
+		for (OpCode op : program.code)
+		{
+			if (op == OpCode::Parameter)
+			{
+				parameters.push_back(program.slots[slot]);
+				pool.push_back(0.f);
+			}
+
+			if (op == OpCode::Store || op == OpCode::Load || op == OpCode::Parameter)
+				slot++;
+		}
+
+		ExecutableMemory memory(CodeGenerator(program, tier, signIndex).run());
+		if (!memory)
+			return nullptr;
+
+		return std::make_unique<const NativeFunction>(std::move(memory), std::move(pool), std::move(parameters), program.outputs);
+#else
+		(void)program;
+		(void)tier;
+		return nullptr;
+#endif
+	}
+}
\ No newline at end of file
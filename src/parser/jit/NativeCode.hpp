@@ -0,0 +1,55 @@
+#pragma once
+#include "ExecutableMemory.hpp"
+#include "../Bytecode.hpp"
+#include "../VirtualMachine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PARSER_JIT_X64 1
+#else
+#define PARSER_JIT_X64 0
+#endif
+
+namespace parser::jit
+{
+	// samples per iteration of the generated loop, one ymm register
+	constexpr std::size_t nativeLanes = 8;
+
+	// a program compiled to avx machine code. The postfix stack lives in ymm registers,
+	// transcendental ops and pow call back into the vector math library
+	class NativeFunction
+	{
+	public:
+		NativeFunction(ExecutableMemory code, std::vector<float> constants, std::vector<std::uint32_t> parameters, std::size_t outputs);
+
+		// xs and ys may alias
+		void evaluate(const float* xs, float* ys, std::size_t count) const;
+		void evaluate(const float* xs, float* ys, std::size_t count, EvaluationScratch& scratch) const;
+
+		// programs with several outputs, ys[k] receives output k
+		void evaluate(const float* xs, float* const* ys, std::size_t count) const;
+		void evaluate(const float* xs, float* const* ys, std::size_t count, EvaluationScratch& scratch) const;
+
+		std::size_t codeSize() const { return memory.size(); }
+	private:
+		// runs blocks * nativeLanes samples
+		using Entry = void (*)(const float* xs, float* ys, std::size_t blocks, const float* constants);
+
+		ExecutableMemory memory;
+		std::vector<float> pool; // the program's constants, the sign mask, 1, then one entry per parameter op
+		std::vector<std::uint32_t> parameterSlots; // of the entries at the end of the pool
+		Entry entry;
+		std::size_t outputCount;
+
+		// the pool with the current parameter values, taken once per call so every sample sees the same ones
+		const float* constants(EvaluationScratch& scratch) const;
+	};
+
+	// nullptr if the cpu has no avx, the program needs more than 15 registers or 64 slots, has loops
+	// of sums or products or no executable memory is available; callers then keep using the interpreter.
+	// The fast tier calls the fast exp, log and pow instead
+	std::unique_ptr<const NativeFunction> compileNative(const Program& program, MathTier tier = MathTier::Full);
+}
\ No newline at end of file
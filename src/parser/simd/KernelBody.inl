@@ -0,0 +1,702 @@
+// shared opcode loop, included once per isa inside an anonymous namespace after VectorMath.inl.
+// Pack describes a float or double register of that isa: width, load, store, broadcast and the arithmetic ops.
+
+template <typename Pack, typename Op>
+void unaryOp(typename Pack::Scalar* top, std::size_t padded, Op op)
+{
+	for (std::size_t i = 0; i < padded; i += Pack::width)
+		Pack::store(top + i, op(Pack::load(top + i)));
+}
+
+template <typename Pack, typename Op>
+void binaryOp(typename Pack::Scalar* below, const typename Pack::Scalar* top, std::size_t padded, Op op)
+{
+	for (std::size_t i = 0; i < padded; i += Pack::width)
+		Pack::store(below + i, op(Pack::load(below + i), Pack::load(top + i)));
+}
+
+// functions without a vector implementation run lane by lane
+template <typename Scalar, typename Func>
+void scalarOp(Scalar* top, std::size_t padded, Func func)
+{
+	for (std::size_t i = 0; i < padded; i++)
+		top[i] = func(top[i]);
+}
+
+// whether the branch after a Then (Else) op has a lane whose condition is true (false); nan counts as true
+template <typename Pack>
+bool anyLaneTakes(OpCode op, const typename Pack::Scalar* condition, std::size_t padded)
+{
+	typename Pack::Register zero = Pack::broadcast(typename Pack::Scalar(0));
+
+	for (std::size_t i = 0; i < padded; i += Pack::width)
+	{
+		typename Pack::Register value = Pack::load(condition + i);
+		typename Pack::Mask taken = op == OpCode::Then ? Pack::notEqual(value, zero) : Pack::equal(value, zero);
+		if (Pack::laneMask(taken) != 0)
+			return true;
+	}
+
+	return false;
+}
+
+// moves pc and the cursors to a jump's target
+inline void resume(const KernelProgram& program, const Jump& target,
+	std::size_t& pc, const double*& constant, const std::uint32_t*& slot, const Jump*& jump)
+{
+	pc = target.pc - 1; // the loop moves on to target.pc
+	constant = program.constants + target.constant;
+	slot = program.slots + target.slot;
+	jump = program.jumps + target.jump;
+}
+
+// Then and Else: returns false if no lane takes the branch and it can be skipped, after moving pc and the
+// cursors past it. The caller then pushes a placeholder entry, which the select never picks
+template <typename Pack>
+bool runBranch(const KernelProgram& program, OpCode op, const typename Pack::Scalar* condition, std::size_t padded,
+	std::size_t& pc, const double*& constant, const std::uint32_t*& slot, const Jump*& jump)
+{
+	const Jump& target = *jump++;
+	if (target.pc == 0 || anyLaneTakes<Pack>(op, condition, padded))
+		return true;
+
+	resume(program, target, pc, constant, slot, jump);
+	return false;
+}
+
+template <typename Pack>
+void fillBlock(typename Pack::Scalar* block, std::size_t padded, typename Pack::Scalar value)
+{
+	typename Pack::Register broadcast = Pack::broadcast(value);
+	for (std::size_t i = 0; i < padded; i += Pack::width)
+		Pack::store(block + i, broadcast);
+}
+
+template <typename Pack>
+void addBlocks(typename Pack::Scalar* block, const typename Pack::Scalar* a, const typename Pack::Scalar* b, std::size_t padded)
+{
+	for (std::size_t i = 0; i < padded; i += Pack::width)
+		Pack::store(block + i, Pack::add(Pack::load(a + i), Pack::load(b + i)));
+}
+
+template <typename Pack>
+void fillFrom(typename Pack::Scalar* block, const typename Pack::Scalar* source, std::size_t padded)
+{
+	for (std::size_t i = 0; i < padded; i += Pack::width)
+		Pack::store(block + i, Pack::load(source + i));
+}
+
+// SumBegin and ProductBegin on the bounds below and at top, lane 0 stands for all of them. state is the first
+// of the four slot blocks: the index, the number of terms left in lane 0, the sum or product so far and the
+// compensation of the sum. Returns false for an empty range after moving past the loop, the caller pushes
+// the result; its value is in result
+template <typename Pack>
+bool beginLoop(const KernelProgram& program, OpCode op, const typename Pack::Scalar* below, const typename Pack::Scalar* top,
+	typename Pack::Scalar* state, std::size_t stride, std::size_t padded, typename Pack::Scalar& result,
+	std::size_t& pc, const double*& constant, const std::uint32_t*& slot, const Jump*& jump)
+{
+	using Scalar = typename Pack::Scalar;
+
+	const Jump& exit = *jump++;
+	Scalar identity = Scalar(op == OpCode::SumBegin ? 0 : 1);
+	double first = std::round(static_cast<double>(below[0]));
+	double terms = loopTerms(first, static_cast<double>(top[0]));
+
+	if (!(terms >= 1.0))
+	{
+		result = terms == 0.0 ? identity : static_cast<Scalar>(terms);
+		resume(program, exit, pc, constant, slot, jump);
+		return false;
+	}
+
+	fillBlock<Pack>(state, padded, static_cast<Scalar>(first));
+	state[stride] = static_cast<Scalar>(terms - 1.0);
+	fillBlock<Pack>(state + 2 * stride, padded, identity);
+	fillBlock<Pack>(state + 3 * stride, padded, Scalar(0));
+	return true;
+}
+
+// SumEnd and ProductEnd after the term is added: true while terms are left, after moving to the next index
+// and back to the start of the body
+template <typename Pack>
+bool nextTerm(const KernelProgram& program, typename Pack::Scalar* state, std::size_t stride, std::size_t padded,
+	std::size_t& pc, const double*& constant, const std::uint32_t*& slot, const Jump*& jump)
+{
+	const Jump& again = *jump++;
+	if (!(state[stride] > 0))
+		return false;
+
+	state[stride] -= 1;
+	unaryOp<Pack>(state, padded, [](typename Pack::Register index) {
+		return Pack::add(index, Pack::broadcast(typename Pack::Scalar(1)));
+	});
+
+	resume(program, again, pc, constant, slot, jump);
+	return true;
+}
+
+// kahan summation lane by lane, as accumulate in Summation.hpp
+template <typename Pack>
+void accumulateBlock(typename Pack::Scalar* sum, typename Pack::Scalar* compensation, const typename Pack::Scalar* term, std::size_t padded)
+{
+	using Register = typename Pack::Register;
+	Register zero = Pack::broadcast(typename Pack::Scalar(0));
+
+	for (std::size_t i = 0; i < padded; i += Pack::width)
+	{
+		Register a = Pack::load(sum + i);
+		Register b = Pack::add(Pack::load(term + i), Pack::load(compensation + i));
+		Register total = Pack::add(a, b);
+		Register sumLarger = Pack::add(Pack::subtract(a, total), b);
+		Register termLarger = Pack::add(Pack::subtract(b, total), a);
+
+		Register lost = Pack::select(Pack::lessEqual(Pack::abs(b), Pack::abs(a)), sumLarger, termLarger);
+		Pack::store(compensation + i, Pack::select(Pack::equal(Pack::subtract(lost, lost), zero), lost, zero));
+		Pack::store(sum + i, total);
+	}
+}
+
+template <typename Pack>
+void runBlockWith(const KernelProgram& program, const typename Pack::Scalar* xs, typename Pack::Scalar* ys, std::size_t count, typename Pack::Scalar* stack)
+{
+	using Scalar = typename Pack::Scalar;
+	using Register = typename Pack::Register;
+
+	// lanes past count hold padding and are never written to ys
+	std::size_t padded = (count + Pack::width - 1) / Pack::width * Pack::width;
+
+	const double* constant = program.constants;
+	const std::uint32_t* slot = program.slots;
+	const Jump* jump = program.jumps;
+	Scalar* slots = stack + program.maxStack * batchBlockSize;
+	Scalar* top = stack - batchBlockSize;
+
+	Register zero = Pack::broadcast(Scalar(0));
+	Register one = Pack::broadcast(Scalar(1));
+
+	for (std::size_t pc = 0; pc < program.codeSize; pc++)
+	{
+		Scalar* below = top - batchBlockSize;
+
+		switch (program.code[pc])
+		{
+		case OpCode::Constant:
+		case OpCode::Parameter:
+		{
+			// a parameter is read once per block, every lane of it sees the same value
+			double source = program.code[pc] == OpCode::Constant ? *constant++ : parameterValue(*slot++);
+			top += batchBlockSize;
+			Register value = Pack::broadcast(static_cast<Scalar>(source));
+			for (std::size_t i = 0; i < padded; i += Pack::width)
+				Pack::store(top + i, value);
+			break;
+		}
+		case OpCode::Variable:
+			top += batchBlockSize;
+			for (std::size_t i = 0; i < count; i++) top[i] = xs[i];
+			for (std::size_t i = count; i < padded; i++) top[i] = 0;
+			break;
+		case OpCode::Negate:
+			unaryOp<Pack>(top, padded, [](Register a) { return Pack::negate(a); });
+			break;
+		case OpCode::Add:
+			binaryOp<Pack>(below, top, padded, [](Register a, Register b) { return Pack::add(a, b); });
+			top = below;
+			break;
+		case OpCode::Subtract:
+			binaryOp<Pack>(below, top, padded, [](Register a, Register b) { return Pack::subtract(a, b); });
+			top = below;
+			break;
+		case OpCode::Multiply:
+			binaryOp<Pack>(below, top, padded, [](Register a, Register b) { return Pack::multiply(a, b); });
+			top = below;
+			break;
+		case OpCode::Divide:
+			binaryOp<Pack>(below, top, padded, [](Register a, Register b) { return Pack::divide(a, b); });
+			top = below;
+			break;
+		case OpCode::Power:
+			if (program.exactMath)
+				for (std::size_t i = 0; i < padded; i++) below[i] = std::pow(below[i], top[i]);
+			else if (program.fastMath)
+				binaryOp<Pack>(below, top, padded, [](Register a, Register b) { return fastPow<Pack>(a, b); });
+			else
+				binaryOp<Pack>(below, top, padded, [](Register a, Register b) { return vectorPow<Pack>(a, b); });
+			top = below;
+			break;
+		case OpCode::Sin:
+			if (program.exactMath) scalarOp(top, padded, [](Scalar a) { return std::sin(a); });
+			else unaryOp<Pack>(top, padded, [](Register a) { return vectorSin<Pack>(a); });
+			break;
+		case OpCode::Cos:
+			if (program.exactMath) scalarOp(top, padded, [](Scalar a) { return std::cos(a); });
+			else unaryOp<Pack>(top, padded, [](Register a) { return vectorCos<Pack>(a); });
+			break;
+		case OpCode::Tan:
+			if (program.exactMath) scalarOp(top, padded, [](Scalar a) { return std::tan(a); });
+			else unaryOp<Pack>(top, padded, [](Register a) { return vectorTan<Pack>(a); });
+			break;
+		case OpCode::Log:
+			if (program.exactMath) scalarOp(top, padded, [](Scalar a) { return std::log(a); });
+			else if (program.fastMath) unaryOp<Pack>(top, padded, [](Register a) { return fastLog<Pack>(a); });
+			else unaryOp<Pack>(top, padded, [](Register a) { return vectorLog<Pack>(a); });
+			break;
+		case OpCode::Exp:
+			if (program.exactMath) scalarOp(top, padded, [](Scalar a) { return std::exp(a); });
+			else if (program.fastMath) unaryOp<Pack>(top, padded, [](Register a) { return fastExp<Pack>(a); });
+			else unaryOp<Pack>(top, padded, [](Register a) { return vectorExp<Pack>(a); });
+			break;
+		case OpCode::Sqrt:
+			unaryOp<Pack>(top, padded, [](Register a) { return Pack::sqrt(a); });
+			break;
+		case OpCode::Abs:
+			unaryOp<Pack>(top, padded, [](Register a) { return Pack::abs(a); });
+			break;
+		case OpCode::Minimum:
+			binaryOp<Pack>(below, top, padded, [](Register a, Register b) { return Pack::min(a, b); });
+			top = below;
+			break;
+		case OpCode::Maximum:
+			binaryOp<Pack>(below, top, padded, [](Register a, Register b) { return Pack::max(a, b); });
+			top = below;
+			break;
+		case OpCode::Less:
+			binaryOp<Pack>(below, top, padded, [&](Register a, Register b) { return Pack::select(Pack::less(a, b), one, zero); });
+			top = below;
+			break;
+		case OpCode::LessEqual:
+			binaryOp<Pack>(below, top, padded, [&](Register a, Register b) { return Pack::select(Pack::lessEqual(a, b), one, zero); });
+			top = below;
+			break;
+		case OpCode::Select:
+		{
+			// blends the branches by the condition, whichever sides were computed
+			Scalar* condition = below - batchBlockSize;
+			for (std::size_t i = 0; i < padded; i += Pack::width)
+			{
+				Register test = Pack::load(condition + i);
+				Pack::store(condition + i, Pack::select(Pack::notEqual(test, zero), Pack::load(below + i), Pack::load(top + i)));
+			}
+			top = condition;
+			break;
+		}
+		case OpCode::Then:
+		case OpCode::Else:
+		{
+			OpCode op = program.code[pc];
+			if (!runBranch<Pack>(program, op, op == OpCode::Then ? top : below, padded, pc, constant, slot, jump))
+				top += batchBlockSize;
+			break;
+		}
+		case OpCode::Store:
+		{
+			Scalar* target = slots + *slot++ * batchBlockSize;
+			for (std::size_t i = 0; i < padded; i += Pack::width)
+				Pack::store(target + i, Pack::load(top + i));
+			break;
+		}
+		case OpCode::Load:
+		{
+			const Scalar* source = slots + *slot++ * batchBlockSize;
+			top += batchBlockSize;
+			for (std::size_t i = 0; i < padded; i += Pack::width)
+				Pack::store(top + i, Pack::load(source + i));
+			break;
+		}
+		case OpCode::Pop:
+			top = below;
+			break;
+		case OpCode::SumBegin:
+		case OpCode::ProductBegin:
+		{
+			Scalar* state = slots + *slot++ * batchBlockSize;
+			Scalar result;
+			top = below - batchBlockSize;
+			if (!beginLoop<Pack>(program, program.code[pc], below, below + batchBlockSize, state, batchBlockSize, padded, result, pc, constant, slot, jump))
+			{
+				top += batchBlockSize;
+				fillBlock<Pack>(top, padded, result);
+			}
+			break;
+		}
+		case OpCode::SumEnd:
+		case OpCode::ProductEnd:
+		{
+			Scalar* state = slots + *slot++ * batchBlockSize;
+			Scalar* total = state + 2 * batchBlockSize;
+			Scalar* compensation = state + 3 * batchBlockSize;
+			bool sum = program.code[pc] == OpCode::SumEnd;
+
+			if (sum)
+				accumulateBlock<Pack>(total, compensation, top, padded);
+			else
+				binaryOp<Pack>(total, top, padded, [](Register a, Register b) { return Pack::multiply(a, b); });
+
+			if (nextTerm<Pack>(program, state, batchBlockSize, padded, pc, constant, slot, jump))
+				top = below;
+			else if (sum)
+				addBlocks<Pack>(top, total, compensation, padded);
+			else
+				fillFrom<Pack>(top, total, padded);
+			break;
+		}
+		}
+	}
+
+	// programs with several outputs leave them in the bottom stack blocks for the caller
+	if (ys)
+		for (std::size_t i = 0; i < count; i++)
+			ys[i] = top[i];
+}
+
+// forward mode differentiation: every stack entry and slot is a value block followed by the block of
+// its derivative with respect to x, both advanced by the same op in one sweep
+
+template <typename Scalar>
+Scalar libmFunction(MathFunction function, Scalar a, Scalar b)
+{
+	switch (function)
+	{
+	case MathFunction::Sin: return std::sin(a);
+	case MathFunction::Cos: return std::cos(a);
+	case MathFunction::Tan: return std::tan(a);
+	case MathFunction::Log:
+	case MathFunction::FastLog: return std::log(a);
+	case MathFunction::Exp:
+	case MathFunction::FastExp: return std::exp(a);
+	case MathFunction::Sqrt: return std::sqrt(a);
+	case MathFunction::Pow:
+	case MathFunction::FastPow: return std::pow(a, b);
+	}
+
+	return a;
+}
+
+// the same function the value kernel would apply, so values match it bit for bit
+template <typename Pack>
+typename Pack::Register dualMath(bool exact, MathFunction function, typename Pack::Register a, typename Pack::Register b)
+{
+	using Scalar = typename Pack::Scalar;
+
+	if (!exact)
+		return mathRegister<Pack>(function, a, b);
+
+	alignas(64) Scalar first[Pack::width];
+	alignas(64) Scalar second[Pack::width];
+	Pack::store(first, a);
+	Pack::store(second, b);
+
+	for (std::size_t i = 0; i < Pack::width; i++)
+		first[i] = libmFunction(function, first[i], second[i]);
+
+	return Pack::load(first);
+}
+
+template <typename Pack, typename Op>
+void dualUnaryOp(typename Pack::Scalar* top, std::size_t padded, Op op)
+{
+	typename Pack::Scalar* slope = top + batchBlockSize;
+
+	for (std::size_t i = 0; i < padded; i += Pack::width)
+	{
+		typename Pack::Register value = Pack::load(top + i);
+		typename Pack::Register derivative = Pack::load(slope + i);
+		op(value, derivative);
+		Pack::store(top + i, value);
+		Pack::store(slope + i, derivative);
+	}
+}
+
+template <typename Pack, typename Op>
+void dualBinaryOp(typename Pack::Scalar* below, const typename Pack::Scalar* top, std::size_t padded, Op op)
+{
+	typename Pack::Scalar* belowSlope = below + batchBlockSize;
+	const typename Pack::Scalar* topSlope = top + batchBlockSize;
+
+	for (std::size_t i = 0; i < padded; i += Pack::width)
+	{
+		typename Pack::Register value = Pack::load(below + i);
+		typename Pack::Register derivative = Pack::load(belowSlope + i);
+		op(value, derivative, Pack::load(top + i), Pack::load(topSlope + i));
+		Pack::store(below + i, value);
+		Pack::store(belowSlope + i, derivative);
+	}
+}
+
+template <typename Pack>
+void runDualBlockWith(const KernelProgram& program, const typename Pack::Scalar* xs, typename Pack::Scalar* ys,
+	typename Pack::Scalar* dys, std::size_t count, typename Pack::Scalar* stack)
+{
+	using Scalar = typename Pack::Scalar;
+	using Register = typename Pack::Register;
+
+	constexpr std::size_t entry = 2 * batchBlockSize;
+	std::size_t padded = (count + Pack::width - 1) / Pack::width * Pack::width;
+	bool exact = program.exactMath;
+
+	const double* constant = program.constants;
+	const std::uint32_t* slot = program.slots;
+	const Jump* jump = program.jumps;
+	Scalar* slots = stack + program.maxStack * entry;
+	Scalar* top = stack - entry;
+
+	Register zero = Pack::broadcast(Scalar(0));
+	Register one = Pack::broadcast(Scalar(1));
+
+	for (std::size_t pc = 0; pc < program.codeSize; pc++)
+	{
+		Scalar* below = top - entry;
+
+		switch (program.code[pc])
+		{
+		case OpCode::Constant:
+		case OpCode::Parameter:
+		{
+			double source = program.code[pc] == OpCode::Constant ? *constant++ : parameterValue(*slot++);
+			top += entry;
+			Register value = Pack::broadcast(static_cast<Scalar>(source));
+			for (std::size_t i = 0; i < padded; i += Pack::width)
+			{
+				Pack::store(top + i, value);
+				Pack::store(top + batchBlockSize + i, zero);
+			}
+			break;
+		}
+		case OpCode::Variable:
+			top += entry;
+			for (std::size_t i = 0; i < count; i++) top[i] = xs[i];
+			for (std::size_t i = count; i < padded; i++) top[i] = 0;
+			for (std::size_t i = 0; i < padded; i += Pack::width) Pack::store(top + batchBlockSize + i, one);
+			break;
+		case OpCode::Negate:
+			dualUnaryOp<Pack>(top, padded, [](Register& a, Register& da) {
+				a = Pack::negate(a);
+				da = Pack::negate(da);
+			});
+			break;
+		case OpCode::Add:
+			dualBinaryOp<Pack>(below, top, padded, [](Register& a, Register& da, Register b, Register db) {
+				a = Pack::add(a, b);
+				da = Pack::add(da, db);
+			});
+			top = below;
+			break;
+		case OpCode::Subtract:
+			dualBinaryOp<Pack>(below, top, padded, [](Register& a, Register& da, Register b, Register db) {
+				a = Pack::subtract(a, b);
+				da = Pack::subtract(da, db);
+			});
+			top = below;
+			break;
+		case OpCode::Multiply:
+			dualBinaryOp<Pack>(below, top, padded, [](Register& a, Register& da, Register b, Register db) {
+				da = Pack::add(Pack::multiply(da, b), Pack::multiply(a, db));
+				a = Pack::multiply(a, b);
+			});
+			top = below;
+			break;
+		case OpCode::Divide:
+			// (a / b)' = (a' - (a / b) b') / b
+			dualBinaryOp<Pack>(below, top, padded, [](Register& a, Register& da, Register b, Register db) {
+				a = Pack::divide(a, b);
+				da = Pack::divide(Pack::subtract(da, Pack::multiply(a, db)), b);
+			});
+			top = below;
+			break;
+		case OpCode::Power:
+			// (a^b)' = b a^(b - 1) a' + a^b log(a) b'; each term only where its slope is nonzero,
+			// so constant exponents work for negative bases and constant bases need no a^(b - 1)
+			dualBinaryOp<Pack>(below, top, padded, [&](Register& a, Register& da, Register b, Register db) {
+				Register power = dualMath<Pack>(exact, MathFunction::Pow, a, b);
+				Register baseTerm = Pack::multiply(Pack::multiply(b,
+					dualMath<Pack>(exact, MathFunction::Pow, a, Pack::subtract(b, one))), da);
+				Register exponentTerm = Pack::multiply(Pack::multiply(power,
+					dualMath<Pack>(exact, MathFunction::Log, a, a)), db);
+
+				da = Pack::add(
+					Pack::select(Pack::notEqual(da, zero), baseTerm, zero),
+					Pack::select(Pack::notEqual(db, zero), exponentTerm, zero));
+				a = power;
+			});
+			top = below;
+			break;
+		case OpCode::Sin:
+			dualUnaryOp<Pack>(top, padded, [&](Register& a, Register& da) {
+				da = Pack::multiply(dualMath<Pack>(exact, MathFunction::Cos, a, a), da);
+				a = dualMath<Pack>(exact, MathFunction::Sin, a, a);
+			});
+			break;
+		case OpCode::Cos:
+			dualUnaryOp<Pack>(top, padded, [&](Register& a, Register& da) {
+				da = Pack::negate(Pack::multiply(dualMath<Pack>(exact, MathFunction::Sin, a, a), da));
+				a = dualMath<Pack>(exact, MathFunction::Cos, a, a);
+			});
+			break;
+		case OpCode::Tan:
+			// tan' = 1 + tan^2
+			dualUnaryOp<Pack>(top, padded, [&](Register& a, Register& da) {
+				a = dualMath<Pack>(exact, MathFunction::Tan, a, a);
+				da = Pack::multiply(Pack::add(one, Pack::multiply(a, a)), da);
+			});
+			break;
+		case OpCode::Log:
+			dualUnaryOp<Pack>(top, padded, [&](Register& a, Register& da) {
+				da = Pack::divide(da, a);
+				a = dualMath<Pack>(exact, MathFunction::Log, a, a);
+			});
+			break;
+		case OpCode::Exp:
+			dualUnaryOp<Pack>(top, padded, [&](Register& a, Register& da) {
+				a = dualMath<Pack>(exact, MathFunction::Exp, a, a);
+				da = Pack::multiply(a, da);
+			});
+			break;
+		case OpCode::Sqrt:
+			dualUnaryOp<Pack>(top, padded, [](Register& a, Register& da) {
+				a = Pack::sqrt(a);
+				da = Pack::divide(da, Pack::add(a, a));
+			});
+			break;
+		case OpCode::Abs:
+			dualUnaryOp<Pack>(top, padded, [&](Register& a, Register& da) {
+				da = Pack::select(Pack::less(a, zero), Pack::negate(da), da);
+				a = Pack::abs(a);
+			});
+			break;
+		case OpCode::Minimum:
+			dualBinaryOp<Pack>(below, top, padded, [](Register& a, Register& da, Register b, Register db) {
+				da = Pack::select(Pack::less(a, b), da, db);
+				a = Pack::min(a, b);
+			});
+			top = below;
+			break;
+		case OpCode::Maximum:
+			dualBinaryOp<Pack>(below, top, padded, [](Register& a, Register& da, Register b, Register db) {
+				da = Pack::select(Pack::less(b, a), da, db);
+				a = Pack::max(a, b);
+			});
+			top = below;
+			break;
+		case OpCode::Less:
+			dualBinaryOp<Pack>(below, top, padded, [&](Register& a, Register& da, Register b, Register) {
+				a = Pack::select(Pack::less(a, b), one, zero);
+				da = zero;
+			});
+			top = below;
+			break;
+		case OpCode::LessEqual:
+			dualBinaryOp<Pack>(below, top, padded, [&](Register& a, Register& da, Register b, Register) {
+				a = Pack::select(Pack::lessEqual(a, b), one, zero);
+				da = zero;
+			});
+			top = below;
+			break;
+		case OpCode::Select:
+		{
+			// the condition entry receives the blended value and derivative
+			Scalar* condition = below - entry;
+			for (std::size_t i = 0; i < padded; i += Pack::width)
+			{
+				typename Pack::Mask mask = Pack::notEqual(Pack::load(condition + i), zero);
+				Pack::store(condition + i, Pack::select(mask, Pack::load(below + i), Pack::load(top + i)));
+				Pack::store(condition + batchBlockSize + i,
+					Pack::select(mask, Pack::load(below + batchBlockSize + i), Pack::load(top + batchBlockSize + i)));
+			}
+			top = condition;
+			break;
+		}
+		case OpCode::Then:
+		case OpCode::Else:
+		{
+			OpCode op = program.code[pc];
+			if (!runBranch<Pack>(program, op, op == OpCode::Then ? top : below, padded, pc, constant, slot, jump))
+				top += entry;
+			break;
+		}
+		case OpCode::Store:
+		{
+			Scalar* target = slots + *slot++ * entry;
+			for (std::size_t i = 0; i < padded; i += Pack::width)
+			{
+				Pack::store(target + i, Pack::load(top + i));
+				Pack::store(target + batchBlockSize + i, Pack::load(top + batchBlockSize + i));
+			}
+			break;
+		}
+		case OpCode::Load:
+		{
+			const Scalar* source = slots + *slot++ * entry;
+			top += entry;
+			for (std::size_t i = 0; i < padded; i += Pack::width)
+			{
+				Pack::store(top + i, Pack::load(source + i));
+				Pack::store(top + batchBlockSize + i, Pack::load(source + batchBlockSize + i));
+			}
+			break;
+		}
+		case OpCode::Pop:
+			top = below;
+			break;
+		case OpCode::SumBegin:
+		case OpCode::ProductBegin:
+		{
+			// the index and the identity have no slope, the derivative blocks of the sum follow its value's
+			Scalar* state = slots + *slot++ * entry;
+			Scalar result;
+			top = below - entry;
+			if (!beginLoop<Pack>(program, program.code[pc], below, below + entry, state, entry, padded, result, pc, constant, slot, jump))
+			{
+				top += entry;
+				fillBlock<Pack>(top, padded, result);
+				fillBlock<Pack>(top + batchBlockSize, padded, Scalar(0));
+				break;
+			}
+
+			for (std::size_t block = 0; block < 4; block++)
+				fillBlock<Pack>(state + block * entry + batchBlockSize, padded, Scalar(0));
+			break;
+		}
+		case OpCode::SumEnd:
+		case OpCode::ProductEnd:
+		{
+			Scalar* state = slots + *slot++ * entry;
+			Scalar* total = state + 2 * entry;
+			Scalar* compensation = state + 3 * entry;
+			bool sum = program.code[pc] == OpCode::SumEnd;
+
+			if (sum)
+			{
+				accumulateBlock<Pack>(total, compensation, top, padded);
+				accumulateBlock<Pack>(total + batchBlockSize, compensation + batchBlockSize, top + batchBlockSize, padded);
+			}
+			else
+			{
+				dualBinaryOp<Pack>(total, top, padded, [](Register& a, Register& da, Register b, Register db) {
+					da = Pack::add(Pack::multiply(da, b), Pack::multiply(a, db));
+					a = Pack::multiply(a, b);
+				});
+			}
+
+			if (nextTerm<Pack>(program, state, entry, padded, pc, constant, slot, jump))
+				top = below;
+			else if (sum)
+			{
+				addBlocks<Pack>(top, total, compensation, padded);
+				addBlocks<Pack>(top + batchBlockSize, total + batchBlockSize, compensation + batchBlockSize, padded);
+			}
+			else
+			{
+				fillFrom<Pack>(top, total, padded);
+				fillFrom<Pack>(top + batchBlockSize, total + batchBlockSize, padded);
+			}
+			break;
+		}
+		}
+	}
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		ys[i] = top[i];
+		dys[i] = top[batchBlockSize + i];
+	}
+}
\ No newline at end of file
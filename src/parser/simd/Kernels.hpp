@@ -0,0 +1,101 @@
+#pragma once
+#include "SimdLevel.hpp"
+#include "../Parameters.hpp"
+#include "../Summation.hpp"
+#include "../VirtualMachine.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace parser::simd
+{
+	// raw view of a Program, so the isa specific translation units never instantiate std containers
+	struct KernelProgram
+	{
+		const OpCode* code;
+		std::size_t codeSize;
+		const double* constants; // rounded to the lane type when broadcast
+		const std::uint32_t* slots; // also names the parameter slots
+		const Jump* jumps; // where Then and Else continue when no lane takes their branch
+		std::size_t maxStack; // the slot blocks start after this many stack blocks
+		bool exactMath; // libm per lane instead of the vector math library
+		bool fastMath; // the fast tier of exp, log and pow, exactMath takes precedence
+	};
+
+	enum class MathFunction
+	{
+		Sin,
+		Cos,
+		Tan,
+		Log,
+		Exp,
+		Sqrt,
+		Pow,
+		FastExp, // the fast tier, relative error below fastMathError in float
+		FastLog,
+		FastPow
+	};
+
+	// evaluates up to batchBlockSize samples; stack holds maxStack + slotCount blocks of batchBlockSize values.
+	// With ys null the results stay on the stack, output k in block k
+	template <typename T>
+	using BlockKernel = void (*)(const KernelProgram& program, const T* xs, T* ys, std::size_t count, T* stack);
+
+	void runBlockScalar(const KernelProgram& program, const float* xs, float* ys, std::size_t count, float* stack);
+	void runBlockScalar(const KernelProgram& program, const double* xs, double* ys, std::size_t count, double* stack);
+	void runBlockSse42(const KernelProgram& program, const float* xs, float* ys, std::size_t count, float* stack);
+	void runBlockSse42(const KernelProgram& program, const double* xs, double* ys, std::size_t count, double* stack);
+	void runBlockAvx2(const KernelProgram& program, const float* xs, float* ys, std::size_t count, float* stack);
+	void runBlockAvx2(const KernelProgram& program, const double* xs, double* ys, std::size_t count, double* stack);
+	void runBlockAvx512(const KernelProgram& program, const float* xs, float* ys, std::size_t count, float* stack);
+	void runBlockAvx512(const KernelProgram& program, const double* xs, double* ys, std::size_t count, double* stack);
+
+	// kernel for float or double lanes
+	template <typename T>
+	BlockKernel<T> blockKernel(SimdLevel level);
+
+	template <>
+	BlockKernel<float> blockKernel<float>(SimdLevel level);
+
+	template <>
+	BlockKernel<double> blockKernel<double>(SimdLevel level);
+
+	// value and derivative with respect to x for up to batchBlockSize samples; every stack entry and slot
+	// is two blocks, the value followed by its derivative, so stack holds twice as many blocks
+	template <typename T>
+	using DualBlockKernel = void (*)(const KernelProgram& program, const T* xs, T* ys, T* dys, std::size_t count, T* stack);
+
+	void runDualBlockScalar(const KernelProgram& program, const float* xs, float* ys, float* dys, std::size_t count, float* stack);
+	void runDualBlockScalar(const KernelProgram& program, const double* xs, double* ys, double* dys, std::size_t count, double* stack);
+	void runDualBlockSse42(const KernelProgram& program, const float* xs, float* ys, float* dys, std::size_t count, float* stack);
+	void runDualBlockSse42(const KernelProgram& program, const double* xs, double* ys, double* dys, std::size_t count, double* stack);
+	void runDualBlockAvx2(const KernelProgram& program, const float* xs, float* ys, float* dys, std::size_t count, float* stack);
+	void runDualBlockAvx2(const KernelProgram& program, const double* xs, double* ys, double* dys, std::size_t count, double* stack);
+	void runDualBlockAvx512(const KernelProgram& program, const float* xs, float* ys, float* dys, std::size_t count, float* stack);
+	void runDualBlockAvx512(const KernelProgram& program, const double* xs, double* ys, double* dys, std::size_t count, double* stack);
+
+	template <typename T>
+	DualBlockKernel<T> dualBlockKernel(SimdLevel level);
+
+	template <>
+	DualBlockKernel<float> dualBlockKernel<float>(SimdLevel level);
+
+	template <>
+	DualBlockKernel<double> dualBlockKernel<double>(SimdLevel level);
+
+	// applies one function of the vector math library to count values, b is only read by pow
+	void vectorMath(SimdLevel level, MathFunction function, const float* a, const float* b, float* out, std::size_t count);
+	void vectorMath(SimdLevel level, MathFunction function, const double* a, const double* b, double* out, std::size_t count);
+
+	void vectorMathScalar(MathFunction function, const float* a, const float* b, float* out, std::size_t count);
+	void vectorMathScalar(MathFunction function, const double* a, const double* b, double* out, std::size_t count);
+	void vectorMathSse42(MathFunction function, const float* a, const float* b, float* out, std::size_t count);
+	void vectorMathSse42(MathFunction function, const double* a, const double* b, double* out, std::size_t count);
+	void vectorMathAvx2(MathFunction function, const float* a, const float* b, float* out, std::size_t count);
+	void vectorMathAvx2(MathFunction function, const double* a, const double* b, double* out, std::size_t count);
+	void vectorMathAvx512(MathFunction function, const float* a, const float* b, float* out, std::size_t count);
+	void vectorMathAvx512(MathFunction function, const double* a, const double* b, double* out, std::size_t count);
+
+	// one ymm register worth of floats in place, for the native code tier; pow reads its exponents
+	// from the eight floats after lanes, which must be readable for every function
+	void vectorMathLanesAvx2(MathFunction function, float* lanes);
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "Kernels.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if PARSER_SIMD_X86
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace parser::simd
+{
+	namespace
+	{
+		struct Avx2Float
+		{
+			using Scalar = float;
+			using Register = __m256;
+			using Mask = __m256;
+			using Bits = __m256i;
+			static constexpr std::size_t width = 8;
+			static constexpr bool hasFma = true;
+
+			static Register load(const float* p) { return _mm256_loadu_ps(p); }
+			static void store(float* p, Register a) { _mm256_storeu_ps(p, a); }
+			static Register broadcast(float value) { return _mm256_set1_ps(value); }
+
+			static Register negate(Register a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.f)); }
+			static Register add(Register a, Register b) { return _mm256_add_ps(a, b); }
+			static Register subtract(Register a, Register b) { return _mm256_sub_ps(a, b); }
+			static Register multiply(Register a, Register b) { return _mm256_mul_ps(a, b); }
+			static Register divide(Register a, Register b) { return _mm256_div_ps(a, b); }
+			static Register sqrt(Register a) { return _mm256_sqrt_ps(a); }
+			static Register abs(Register a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+			static Register fma(Register a, Register b, Register c) { return _mm256_fmadd_ps(a, b, c); }
+			static Register min(Register a, Register b) { return _mm256_min_ps(a, b); }
+			static Register max(Register a, Register b) { return _mm256_max_ps(a, b); }
+
+			static Mask less(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+			static Mask lessEqual(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+			static Mask equal(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+			static Mask notEqual(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+			static Register select(Mask mask, Register a, Register b) { return _mm256_blendv_ps(b, a, mask); }
+			static Mask maskAnd(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+			static Mask maskNot(Mask a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+			static std::uint32_t laneMask(Mask mask) { return static_cast<std::uint32_t>(_mm256_movemask_ps(mask)); }
+
+			static Bits toBits(Register a) { return _mm256_castps_si256(a); }
+			static Register fromBits(Bits a) { return _mm256_castsi256_ps(a); }
+			static Bits broadcastBits(std::uint32_t value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+			static Bits bitsAdd(Bits a, Bits b) { return _mm256_add_epi32(a, b); }
+			static Bits bitsSubtract(Bits a, Bits b) { return _mm256_sub_epi32(a, b); }
+			static Bits bitsAnd(Bits a, Bits b) { return _mm256_and_si256(a, b); }
+			static Bits shiftMantissaLeft(Bits a) { return _mm256_slli_epi32(a, 23); }
+			static Bits shiftMantissaRight(Bits a) { return _mm256_srli_epi32(a, 23); }
+		};
+
+		struct Avx2Double
+		{
+			using Scalar = double;
+			using Register = __m256d;
+			using Mask = __m256d;
+			using Bits = __m256i;
+			static constexpr std::size_t width = 4;
+			static constexpr bool hasFma = true;
+
+			static Register load(const double* p) { return _mm256_loadu_pd(p); }
+			static void store(double* p, Register a) { _mm256_storeu_pd(p, a); }
+			static Register broadcast(double value) { return _mm256_set1_pd(value); }
+
+			static Register negate(Register a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+			static Register add(Register a, Register b) { return _mm256_add_pd(a, b); }
+			static Register subtract(Register a, Register b) { return _mm256_sub_pd(a, b); }
+			static Register multiply(Register a, Register b) { return _mm256_mul_pd(a, b); }
+			static Register divide(Register a, Register b) { return _mm256_div_pd(a, b); }
+			static Register sqrt(Register a) { return _mm256_sqrt_pd(a); }
+			static Register abs(Register a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+			static Register fma(Register a, Register b, Register c) { return _mm256_fmadd_pd(a, b, c); }
+			static Register min(Register a, Register b) { return _mm256_min_pd(a, b); }
+			static Register max(Register a, Register b) { return _mm256_max_pd(a, b); }
+
+			static Mask less(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+			static Mask lessEqual(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+			static Mask equal(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+			static Mask notEqual(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ); }
+			static Register select(Mask mask, Register a, Register b) { return _mm256_blendv_pd(b, a, mask); }
+			static Mask maskAnd(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+			static Mask maskNot(Mask a) { return _mm256_xor_pd(a, _mm256_castsi256_pd(_mm256_set1_epi32(-1))); }
+			static std::uint32_t laneMask(Mask mask) { return static_cast<std::uint32_t>(_mm256_movemask_pd(mask)); }
+
+			static Bits toBits(Register a) { return _mm256_castpd_si256(a); }
+			static Register fromBits(Bits a) { return _mm256_castsi256_pd(a); }
+			static Bits broadcastBits(std::uint64_t value) { return _mm256_set1_epi64x(static_cast<long long>(value)); }
+			static Bits bitsAdd(Bits a, Bits b) { return _mm256_add_epi64(a, b); }
+			static Bits bitsSubtract(Bits a, Bits b) { return _mm256_sub_epi64(a, b); }
+			static Bits bitsAnd(Bits a, Bits b) { return _mm256_and_si256(a, b); }
+			static Bits shiftMantissaLeft(Bits a) { return _mm256_slli_epi64(a, 52); }
+			static Bits shiftMantissaRight(Bits a) { return _mm256_srli_epi64(a, 52); }
+		};
+
+#include "VectorMath.inl"
+#include "KernelBody.inl"
+	}
+
+	void runBlockAvx2(const KernelProgram& program, const float* xs, float* ys, std::size_t count, float* stack)
+	{
+		runBlockWith<Avx2Float>(program, xs, ys, count, stack);
+		_mm256_zeroupper();
+	}
+
+	void runBlockAvx2(const KernelProgram& program, const double* xs, double* ys, std::size_t count, double* stack)
+	{
+		runBlockWith<Avx2Double>(program, xs, ys, count, stack);
+		_mm256_zeroupper();
+	}
+
+	void runDualBlockAvx2(const KernelProgram& program, const float* xs, float* ys, float* dys, std::size_t count, float* stack)
+	{
+		runDualBlockWith<Avx2Float>(program, xs, ys, dys, count, stack);
+		_mm256_zeroupper();
+	}
+
+	void runDualBlockAvx2(const KernelProgram& program, const double* xs, double* ys, double* dys, std::size_t count, double* stack)
+	{
+		runDualBlockWith<Avx2Double>(program, xs, ys, dys, count, stack);
+		_mm256_zeroupper();
+	}
+
+	void vectorMathAvx2(MathFunction function, const float* a, const float* b, float* out, std::size_t count)
+	{
+		applyMath<Avx2Float>(function, a, b, out, count);
+		_mm256_zeroupper();
+	}
+
+	void vectorMathLanesAvx2(MathFunction function, float* lanes)
+	{
+		Avx2Float::store(lanes, mathRegister<Avx2Float>(function,
+			Avx2Float::load(lanes), Avx2Float::load(lanes + Avx2Float::width)));
+		_mm256_zeroupper();
+	}
+
+	void vectorMathAvx2(MathFunction function, const double* a, const double* b, double* out, std::size_t count)
+	{
+		applyMath<Avx2Double>(function, a, b, out, count);
+		_mm256_zeroupper();
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+#endif
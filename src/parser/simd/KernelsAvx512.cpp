@@ -0,0 +1,159 @@
+#include "Kernels.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if PARSER_SIMD_X86
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx512f")
+#endif
+
+namespace parser::simd
+{
+	namespace
+	{
+		// avx512f has no float bitwise ops, so sign flips go through the integer side
+		struct Avx512Float
+		{
+			using Scalar = float;
+			using Register = __m512;
+			using Mask = __mmask16;
+			using Bits = __m512i;
+			static constexpr std::size_t width = 16;
+			static constexpr bool hasFma = true;
+
+			static Register load(const float* p) { return _mm512_loadu_ps(p); }
+			static void store(float* p, Register a) { _mm512_storeu_ps(p, a); }
+			static Register broadcast(float value) { return _mm512_set1_ps(value); }
+
+			static Register negate(Register a)
+			{
+				return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32(INT32_MIN)));
+			}
+
+			static Register add(Register a, Register b) { return _mm512_add_ps(a, b); }
+			static Register subtract(Register a, Register b) { return _mm512_sub_ps(a, b); }
+			static Register multiply(Register a, Register b) { return _mm512_mul_ps(a, b); }
+			static Register divide(Register a, Register b) { return _mm512_div_ps(a, b); }
+			static Register sqrt(Register a) { return _mm512_sqrt_ps(a); }
+			static Register abs(Register a) { return _mm512_abs_ps(a); }
+			static Register fma(Register a, Register b, Register c) { return _mm512_fmadd_ps(a, b, c); }
+			static Register min(Register a, Register b) { return _mm512_min_ps(a, b); }
+			static Register max(Register a, Register b) { return _mm512_max_ps(a, b); }
+
+			static Mask less(Register a, Register b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+			static Mask lessEqual(Register a, Register b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+			static Mask equal(Register a, Register b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+			static Mask notEqual(Register a, Register b) { return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ); }
+			static Register select(Mask mask, Register a, Register b) { return _mm512_mask_blend_ps(mask, b, a); }
+			static Mask maskAnd(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+			static Mask maskNot(Mask a) { return static_cast<Mask>(~a); }
+			static std::uint32_t laneMask(Mask mask) { return mask; }
+
+			static Bits toBits(Register a) { return _mm512_castps_si512(a); }
+			static Register fromBits(Bits a) { return _mm512_castsi512_ps(a); }
+			static Bits broadcastBits(std::uint32_t value) { return _mm512_set1_epi32(static_cast<int>(value)); }
+			static Bits bitsAdd(Bits a, Bits b) { return _mm512_add_epi32(a, b); }
+			static Bits bitsSubtract(Bits a, Bits b) { return _mm512_sub_epi32(a, b); }
+			static Bits bitsAnd(Bits a, Bits b) { return _mm512_and_si512(a, b); }
+			static Bits shiftMantissaLeft(Bits a) { return _mm512_slli_epi32(a, 23); }
+			static Bits shiftMantissaRight(Bits a) { return _mm512_srli_epi32(a, 23); }
+		};
+
+		struct Avx512Double
+		{
+			using Scalar = double;
+			using Register = __m512d;
+			using Mask = __mmask8;
+			using Bits = __m512i;
+			static constexpr std::size_t width = 8;
+			static constexpr bool hasFma = true;
+
+			static Register load(const double* p) { return _mm512_loadu_pd(p); }
+			static void store(double* p, Register a) { _mm512_storeu_pd(p, a); }
+			static Register broadcast(double value) { return _mm512_set1_pd(value); }
+
+			static Register negate(Register a)
+			{
+				return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(INT64_MIN)));
+			}
+
+			static Register add(Register a, Register b) { return _mm512_add_pd(a, b); }
+			static Register subtract(Register a, Register b) { return _mm512_sub_pd(a, b); }
+			static Register multiply(Register a, Register b) { return _mm512_mul_pd(a, b); }
+			static Register divide(Register a, Register b) { return _mm512_div_pd(a, b); }
+			static Register sqrt(Register a) { return _mm512_sqrt_pd(a); }
+			static Register abs(Register a) { return _mm512_abs_pd(a); }
+			static Register fma(Register a, Register b, Register c) { return _mm512_fmadd_pd(a, b, c); }
+			static Register min(Register a, Register b) { return _mm512_min_pd(a, b); }
+			static Register max(Register a, Register b) { return _mm512_max_pd(a, b); }
+
+			static Mask less(Register a, Register b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+			static Mask lessEqual(Register a, Register b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+			static Mask equal(Register a, Register b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+			static Mask notEqual(Register a, Register b) { return _mm512_cmp_pd_mask(a, b, _CMP_NEQ_UQ); }
+			static Register select(Mask mask, Register a, Register b) { return _mm512_mask_blend_pd(mask, b, a); }
+			static Mask maskAnd(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+			static Mask maskNot(Mask a) { return static_cast<Mask>(~a); }
+			static std::uint32_t laneMask(Mask mask) { return mask; }
+
+			static Bits toBits(Register a) { return _mm512_castpd_si512(a); }
+			static Register fromBits(Bits a) { return _mm512_castsi512_pd(a); }
+			static Bits broadcastBits(std::uint64_t value) { return _mm512_set1_epi64(static_cast<long long>(value)); }
+			static Bits bitsAdd(Bits a, Bits b) { return _mm512_add_epi64(a, b); }
+			static Bits bitsSubtract(Bits a, Bits b) { return _mm512_sub_epi64(a, b); }
+			static Bits bitsAnd(Bits a, Bits b) { return _mm512_and_si512(a, b); }
+			static Bits shiftMantissaLeft(Bits a) { return _mm512_slli_epi64(a, 52); }
+			static Bits shiftMantissaRight(Bits a) { return _mm512_srli_epi64(a, 52); }
+		};
+
+#include "VectorMath.inl"
+#include "KernelBody.inl"
+	}
+
+	void runBlockAvx512(const KernelProgram& program, const float* xs, float* ys, std::size_t count, float* stack)
+	{
+		runBlockWith<Avx512Float>(program, xs, ys, count, stack);
+		_mm256_zeroupper();
+	}
+
+	void runBlockAvx512(const KernelProgram& program, const double* xs, double* ys, std::size_t count, double* stack)
+	{
+		runBlockWith<Avx512Double>(program, xs, ys, count, stack);
+		_mm256_zeroupper();
+	}
+
+	void runDualBlockAvx512(const KernelProgram& program, const float* xs, float* ys, float* dys, std::size_t count, float* stack)
+	{
+		runDualBlockWith<Avx512Float>(program, xs, ys, dys, count, stack);
+		_mm256_zeroupper();
+	}
+
+	void runDualBlockAvx512(const KernelProgram& program, const double* xs, double* ys, double* dys, std::size_t count, double* stack)
+	{
+		runDualBlockWith<Avx512Double>(program, xs, ys, dys, count, stack);
+		_mm256_zeroupper();
+	}
+
+	void vectorMathAvx512(MathFunction function, const float* a, const float* b, float* out, std::size_t count)
+	{
+		applyMath<Avx512Float>(function, a, b, out, count);
+		_mm256_zeroupper();
+	}
+
+	void vectorMathAvx512(MathFunction function, const double* a, const double* b, double* out, std::size_t count)
+	{
+		applyMath<Avx512Double>(function, a, b, out, count);
+		_mm256_zeroupper();
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+#endif
@@ -0,0 +1,199 @@
+#include "Kernels.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace parser::simd
+{
+	namespace
+	{
+		template <typename T, typename BitsType>
+		struct ScalarPack
+		{
+			using Scalar = T;
+			using Register = T;
+			using Mask = bool;
+			using Bits = BitsType;
+			static constexpr std::size_t width = 1;
+			static constexpr bool hasFma = false;
+			static constexpr int mantissaBits = std::numeric_limits<T>::digits - 1;
+
+			static Register load(const T* p) { return *p; }
+			static void store(T* p, Register a) { *p = a; }
+			static Register broadcast(T value) { return value; }
+
+			static Register negate(Register a) { return -a; }
+			static Register add(Register a, Register b) { return a + b; }
+			static Register subtract(Register a, Register b) { return a - b; }
+			static Register multiply(Register a, Register b) { return a * b; }
+			static Register divide(Register a, Register b) { return a / b; }
+			static Register sqrt(Register a) { return std::sqrt(a); }
+			static Register abs(Register a) { return std::fabs(a); }
+
+			// same operand order semantics as minps/maxps
+			static Register min(Register a, Register b) { return a < b ? a : b; }
+			static Register max(Register a, Register b) { return a > b ? a : b; }
+
+			static Mask less(Register a, Register b) { return a < b; }
+			static Mask lessEqual(Register a, Register b) { return a <= b; }
+			static Mask equal(Register a, Register b) { return a == b; }
+			static Mask notEqual(Register a, Register b) { return a != b; }
+			static Register select(Mask mask, Register a, Register b) { return mask ? a : b; }
+			static Mask maskAnd(Mask a, Mask b) { return a && b; }
+			static Mask maskNot(Mask a) { return !a; }
+			static std::uint32_t laneMask(Mask mask) { return mask ? 1u : 0u; }
+
+			static Bits toBits(Register a)
+			{
+				Bits bits;
+				std::memcpy(&bits, &a, sizeof(bits));
+				return bits;
+			}
+
+			static Register fromBits(Bits bits)
+			{
+				Register a;
+				std::memcpy(&a, &bits, sizeof(a));
+				return a;
+			}
+
+			static Bits broadcastBits(Bits value) { return value; }
+			static Bits bitsAdd(Bits a, Bits b) { return a + b; }
+			static Bits bitsSubtract(Bits a, Bits b) { return a - b; }
+			static Bits bitsAnd(Bits a, Bits b) { return a & b; }
+			static Bits shiftMantissaLeft(Bits a) { return a << mantissaBits; }
+			static Bits shiftMantissaRight(Bits a) { return a >> mantissaBits; }
+		};
+
+		using ScalarFloat = ScalarPack<float, std::uint32_t>;
+		using ScalarDouble = ScalarPack<double, std::uint64_t>;
+
+#include "VectorMath.inl"
+#include "KernelBody.inl"
+	}
+
+	void runBlockScalar(const KernelProgram& program, const float* xs, float* ys, std::size_t count, float* stack)
+	{
+		runBlockWith<ScalarFloat>(program, xs, ys, count, stack);
+	}
+
+	void runBlockScalar(const KernelProgram& program, const double* xs, double* ys, std::size_t count, double* stack)
+	{
+		runBlockWith<ScalarDouble>(program, xs, ys, count, stack);
+	}
+
+	void runDualBlockScalar(const KernelProgram& program, const float* xs, float* ys, float* dys, std::size_t count, float* stack)
+	{
+		runDualBlockWith<ScalarFloat>(program, xs, ys, dys, count, stack);
+	}
+
+	void runDualBlockScalar(const KernelProgram& program, const double* xs, double* ys, double* dys, std::size_t count, double* stack)
+	{
+		runDualBlockWith<ScalarDouble>(program, xs, ys, dys, count, stack);
+	}
+
+	void vectorMathScalar(MathFunction function, const float* a, const float* b, float* out, std::size_t count)
+	{
+		applyMath<ScalarFloat>(function, a, b, out, count);
+	}
+
+	void vectorMathScalar(MathFunction function, const double* a, const double* b, double* out, std::size_t count)
+	{
+		applyMath<ScalarDouble>(function, a, b, out, count);
+	}
+
+	namespace
+	{
+		template <typename T>
+		BlockKernel<T> selectKernel(SimdLevel level)
+		{
+#if PARSER_SIMD_X86
+			switch (level)
+			{
+			case SimdLevel::Sse42: return runBlockSse42;
+			case SimdLevel::Avx2: return runBlockAvx2;
+			case SimdLevel::Avx512: return runBlockAvx512;
+			default: break;
+			}
+#else
+			(void)level;
+#endif
+			return runBlockScalar;
+		}
+
+		template <typename T>
+		DualBlockKernel<T> selectDualKernel(SimdLevel level)
+		{
+#if PARSER_SIMD_X86
+			switch (level)
+			{
+			case SimdLevel::Sse42: return runDualBlockSse42;
+			case SimdLevel::Avx2: return runDualBlockAvx2;
+			case SimdLevel::Avx512: return runDualBlockAvx512;
+			default: break;
+			}
+#else
+			(void)level;
+#endif
+			return runDualBlockScalar;
+		}
+	}
+
+	template <>
+	BlockKernel<float> blockKernel<float>(SimdLevel level)
+	{
+		return selectKernel<float>(level);
+	}
+
+	template <>
+	BlockKernel<double> blockKernel<double>(SimdLevel level)
+	{
+		return selectKernel<double>(level);
+	}
+
+	template <>
+	DualBlockKernel<float> dualBlockKernel<float>(SimdLevel level)
+	{
+		return selectDualKernel<float>(level);
+	}
+
+	template <>
+	DualBlockKernel<double> dualBlockKernel<double>(SimdLevel level)
+	{
+		return selectDualKernel<double>(level);
+	}
+
+	void vectorMath(SimdLevel level, MathFunction function, const float* a, const float* b, float* out, std::size_t count)
+	{
+#if PARSER_SIMD_X86
+		switch (level)
+		{
+		case SimdLevel::Sse42: return vectorMathSse42(function, a, b, out, count);
+		case SimdLevel::Avx2: return vectorMathAvx2(function, a, b, out, count);
+		case SimdLevel::Avx512: return vectorMathAvx512(function, a, b, out, count);
+		default: break;
+		}
+#else
+		(void)level;
+#endif
+		vectorMathScalar(function, a, b, out, count);
+	}
+
+	void vectorMath(SimdLevel level, MathFunction function, const double* a, const double* b, double* out, std::size_t count)
+	{
+#if PARSER_SIMD_X86
+		switch (level)
+		{
+		case SimdLevel::Sse42: return vectorMathSse42(function, a, b, out, count);
+		case SimdLevel::Avx2: return vectorMathAvx2(function, a, b, out, count);
+		case SimdLevel::Avx512: return vectorMathAvx512(function, a, b, out, count);
+		default: break;
+		}
+#else
+		(void)level;
+#endif
+		vectorMathScalar(function, a, b, out, count);
+	}
+}
@@ -0,0 +1,143 @@
+#include "Kernels.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if PARSER_SIMD_X86
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("sse4.2")
+#endif
+
+namespace parser::simd
+{
+	namespace
+	{
+		struct Sse42Float
+		{
+			using Scalar = float;
+			using Register = __m128;
+			using Mask = __m128;
+			using Bits = __m128i;
+			static constexpr std::size_t width = 4;
+			static constexpr bool hasFma = false;
+
+			static Register load(const float* p) { return _mm_loadu_ps(p); }
+			static void store(float* p, Register a) { _mm_storeu_ps(p, a); }
+			static Register broadcast(float value) { return _mm_set1_ps(value); }
+
+			static Register negate(Register a) { return _mm_xor_ps(a, _mm_set1_ps(-0.f)); }
+			static Register add(Register a, Register b) { return _mm_add_ps(a, b); }
+			static Register subtract(Register a, Register b) { return _mm_sub_ps(a, b); }
+			static Register multiply(Register a, Register b) { return _mm_mul_ps(a, b); }
+			static Register divide(Register a, Register b) { return _mm_div_ps(a, b); }
+			static Register sqrt(Register a) { return _mm_sqrt_ps(a); }
+			static Register abs(Register a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+			static Register min(Register a, Register b) { return _mm_min_ps(a, b); }
+			static Register max(Register a, Register b) { return _mm_max_ps(a, b); }
+
+			static Mask less(Register a, Register b) { return _mm_cmplt_ps(a, b); }
+			static Mask lessEqual(Register a, Register b) { return _mm_cmple_ps(a, b); }
+			static Mask equal(Register a, Register b) { return _mm_cmpeq_ps(a, b); }
+			static Mask notEqual(Register a, Register b) { return _mm_cmpneq_ps(a, b); }
+			static Register select(Mask mask, Register a, Register b) { return _mm_blendv_ps(b, a, mask); }
+			static Mask maskAnd(Mask a, Mask b) { return _mm_and_ps(a, b); }
+			static Mask maskNot(Mask a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+			static std::uint32_t laneMask(Mask mask) { return static_cast<std::uint32_t>(_mm_movemask_ps(mask)); }
+
+			static Bits toBits(Register a) { return _mm_castps_si128(a); }
+			static Register fromBits(Bits a) { return _mm_castsi128_ps(a); }
+			static Bits broadcastBits(std::uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+			static Bits bitsAdd(Bits a, Bits b) { return _mm_add_epi32(a, b); }
+			static Bits bitsSubtract(Bits a, Bits b) { return _mm_sub_epi32(a, b); }
+			static Bits bitsAnd(Bits a, Bits b) { return _mm_and_si128(a, b); }
+			static Bits shiftMantissaLeft(Bits a) { return _mm_slli_epi32(a, 23); }
+			static Bits shiftMantissaRight(Bits a) { return _mm_srli_epi32(a, 23); }
+		};
+
+		struct Sse42Double
+		{
+			using Scalar = double;
+			using Register = __m128d;
+			using Mask = __m128d;
+			using Bits = __m128i;
+			static constexpr std::size_t width = 2;
+			static constexpr bool hasFma = false;
+
+			static Register load(const double* p) { return _mm_loadu_pd(p); }
+			static void store(double* p, Register a) { _mm_storeu_pd(p, a); }
+			static Register broadcast(double value) { return _mm_set1_pd(value); }
+
+			static Register negate(Register a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+			static Register add(Register a, Register b) { return _mm_add_pd(a, b); }
+			static Register subtract(Register a, Register b) { return _mm_sub_pd(a, b); }
+			static Register multiply(Register a, Register b) { return _mm_mul_pd(a, b); }
+			static Register divide(Register a, Register b) { return _mm_div_pd(a, b); }
+			static Register sqrt(Register a) { return _mm_sqrt_pd(a); }
+			static Register abs(Register a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+			static Register min(Register a, Register b) { return _mm_min_pd(a, b); }
+			static Register max(Register a, Register b) { return _mm_max_pd(a, b); }
+
+			static Mask less(Register a, Register b) { return _mm_cmplt_pd(a, b); }
+			static Mask lessEqual(Register a, Register b) { return _mm_cmple_pd(a, b); }
+			static Mask equal(Register a, Register b) { return _mm_cmpeq_pd(a, b); }
+			static Mask notEqual(Register a, Register b) { return _mm_cmpneq_pd(a, b); }
+			static Register select(Mask mask, Register a, Register b) { return _mm_blendv_pd(b, a, mask); }
+			static Mask maskAnd(Mask a, Mask b) { return _mm_and_pd(a, b); }
+			static Mask maskNot(Mask a) { return _mm_xor_pd(a, _mm_castsi128_pd(_mm_set1_epi32(-1))); }
+			static std::uint32_t laneMask(Mask mask) { return static_cast<std::uint32_t>(_mm_movemask_pd(mask)); }
+
+			static Bits toBits(Register a) { return _mm_castpd_si128(a); }
+			static Register fromBits(Bits a) { return _mm_castsi128_pd(a); }
+			static Bits broadcastBits(std::uint64_t value) { return _mm_set1_epi64x(static_cast<long long>(value)); }
+			static Bits bitsAdd(Bits a, Bits b) { return _mm_add_epi64(a, b); }
+			static Bits bitsSubtract(Bits a, Bits b) { return _mm_sub_epi64(a, b); }
+			static Bits bitsAnd(Bits a, Bits b) { return _mm_and_si128(a, b); }
+			static Bits shiftMantissaLeft(Bits a) { return _mm_slli_epi64(a, 52); }
+			static Bits shiftMantissaRight(Bits a) { return _mm_srli_epi64(a, 52); }
+		};
+
+
+#include "VectorMath.inl"
+#include "KernelBody.inl"
+	}
+
+	void runBlockSse42(const KernelProgram& program, const float* xs, float* ys, std::size_t count, float* stack)
+	{
+		runBlockWith<Sse42Float>(program, xs, ys, count, stack);
+	}
+
+	void runBlockSse42(const KernelProgram& program, const double* xs, double* ys, std::size_t count, double* stack)
+	{
+		runBlockWith<Sse42Double>(program, xs, ys, count, stack);
+	}
+
+	void runDualBlockSse42(const KernelProgram& program, const float* xs, float* ys, float* dys, std::size_t count, float* stack)
+	{
+		runDualBlockWith<Sse42Float>(program, xs, ys, dys, count, stack);
+	}
+
+	void runDualBlockSse42(const KernelProgram& program, const double* xs, double* ys, double* dys, std::size_t count, double* stack)
+	{
+		runDualBlockWith<Sse42Double>(program, xs, ys, dys, count, stack);
+	}
+
+	void vectorMathSse42(MathFunction function, const float* a, const float* b, float* out, std::size_t count)
+	{
+		applyMath<Sse42Float>(function, a, b, out, count);
+	}
+
+	void vectorMathSse42(MathFunction function, const double* a, const double* b, double* out, std::size_t count)
+	{
+		applyMath<Sse42Double>(function, a, b, out, count);
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+#endif
@@ -0,0 +1,104 @@
+#include "SimdLevel.hpp"
+
+#if PARSER_SIMD_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace parser::simd
+{
+	namespace
+	{
+#if PARSER_SIMD_X86
+		struct CpuidRegisters
+		{
+			unsigned int eax, ebx, ecx, edx;
+		};
+
+		CpuidRegisters cpuid(unsigned int leaf, unsigned int subleaf)
+		{
+			CpuidRegisters regs{};
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+			regs = { static_cast<unsigned int>(info[0]), static_cast<unsigned int>(info[1]),
+				static_cast<unsigned int>(info[2]), static_cast<unsigned int>(info[3]) };
+#else
+			__cpuid_count(leaf, subleaf, regs.eax, regs.ebx, regs.ecx, regs.edx);
+#endif
+			return regs;
+		}
+
+		// register state the os saves on context switches
+		unsigned long long enabledStateMask()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			unsigned int low, high;
+			__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return (static_cast<unsigned long long>(high) << 32) | low;
+#endif
+		}
+
+		bool bit(unsigned int value, int index)
+		{
+			return (value >> index) & 1u;
+		}
+
+		SimdLevel detect()
+		{
+			if (cpuid(0, 0).eax < 7)
+				return SimdLevel::Scalar;
+
+			CpuidRegisters basic = cpuid(1, 0);
+			CpuidRegisters extended = cpuid(7, 0);
+
+			if (!bit(basic.ecx, 20))
+				return SimdLevel::Scalar;
+
+			// without osxsave the os does not preserve the ymm/zmm registers
+			if (!bit(basic.ecx, 27))
+				return SimdLevel::Sse42;
+
+			unsigned long long state = enabledStateMask();
+			bool avxState = (state & 0x6) == 0x6;
+			bool avx512State = (state & 0xe6) == 0xe6;
+
+			bool avx2 = bit(basic.ecx, 28) && bit(basic.ecx, 12) && bit(extended.ebx, 5);
+			bool avx512 = bit(extended.ebx, 16);
+
+			if (avx2 && avx512 && avx512State) return SimdLevel::Avx512;
+			if (avx2 && avxState) return SimdLevel::Avx2;
+			return SimdLevel::Sse42;
+		}
+#else
+		SimdLevel detect()
+		{
+			return SimdLevel::Scalar;
+		}
+#endif
+	}
+
+	SimdLevel detectedLevel()
+	{
+		static const SimdLevel level = detect();
+		return level;
+	}
+
+	const char* levelName(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::Scalar: return "scalar";
+		case SimdLevel::Sse42: return "sse4.2";
+		case SimdLevel::Avx2: return "avx2";
+		case SimdLevel::Avx512: return "avx-512";
+		}
+
+		return "unknown";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PARSER_SIMD_X86 1
+#else
+#define PARSER_SIMD_X86 0
+#endif
+
+namespace parser::simd
+{
+	enum class SimdLevel
+	{
+		Scalar,
+		Sse42, // 4 float lanes
+		Avx2, // 8 float lanes
+		Avx512 // 16 float lanes
+	};
+
+	// widest level supported by both the cpu and the os, queried once via cpuid
+	SimdLevel detectedLevel();
+
+	const char* levelName(SimdLevel level);
+}
\ No newline at end of file
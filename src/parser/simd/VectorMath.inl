@@ -0,0 +1,701 @@
+// vectorized sin, cos, tan, log, exp and pow, included once per isa inside an anonymous namespace
+// right after that isa's packs. Arguments are reduced with Cody-Waite splitting and the reduced
+// range is evaluated with the minimax polynomials of cephes (float) and fdlibm (double).
+// Lanes outside the reduced range (huge trig arguments or ones right at a multiple of pi/2,
+// pow with zero/inf/nan) use libm.
+//
+// max error against libm evaluated in the next wider precision, as reported by the "accuracy"
+// console command and checked by --check (float: 2^24 evenly spread bit patterns, double: 2^20
+// random ones):
+//   sin        float 1.5 ulp (|x| < 8192)   double 2.01 ulp (|x| < 2^19 pi/2)
+//   cos        float 1.5 ulp (|x| < 8192)   double 2 ulp (|x| < 2^19 pi/2)
+//   tan        float 2.51 ulp               double 2.5 ulp
+//   exp        float 1.01 ulp               double 1.3 ulp
+//   log        float 0.9 ulp                double 0.8 ulp
+//   pow        float 1.5 ulp                double 1.61 ulp
+// sqrt is the correctly rounded hardware instruction.
+//
+// the fast tier of exp, log and pow keeps the reductions but evaluates shorter polynomials without
+// the extra precision carried through pow, relative error below fastMathError wherever the result
+// is a normal number
+
+template <typename T>
+struct MathConstants;
+
+template <>
+struct MathConstants<float>
+{
+	// adding and subtracting 1.5 * 2^23 rounds to the nearest integer,
+	// the low mantissa bits of the sum then hold that integer
+	static constexpr float roundMagic = 12582912.f;
+	static constexpr std::uint32_t roundMagicBits = 0x4b400000u;
+	static constexpr std::uint32_t exponentBias = 127;
+
+	static constexpr float smallestNormal = 1.17549435e-38f;
+	static constexpr float subnormalScale = 33554432.f; // 2^25
+	static constexpr float subnormalExponent = 25.f;
+	static constexpr float splitter = 4097.f; // 2^12 + 1, splits the mantissa into halves
+
+	static constexpr float log2e = 1.44269504088896341f;
+	static constexpr float log2eLow = 1.925963033500011079e-8f;
+	static constexpr float ln2 = 0.693147180559945309f;
+
+	static constexpr float expMin = -104.f;
+	static constexpr float expMax = 89.f;
+	static constexpr float expLn2High = 0.693359375f;
+	static constexpr float expLn2Low = -2.12194440e-4f;
+	static constexpr float expCoefficients[] = {
+		1.9875691500e-4f, 1.3981999507e-3f, 8.3334519073e-3f, 4.1665795894e-2f, 1.6666665459e-1f, 5.0000001201e-1f
+	};
+
+	static constexpr std::uint32_t logOffset = 0x3f800000u - 0x3f3504f3u; // moves the mantissa to [sqrt(1/2), sqrt(2))
+	static constexpr std::uint32_t logMantissaMask = 0x007fffffu;
+	static constexpr std::uint32_t logSqrtHalfBits = 0x3f3504f3u;
+	static constexpr float logLn2High = 6.9313812256e-01f;
+	static constexpr float logLn2Low = 9.0580006145e-06f;
+	static constexpr float logEvenCoefficients[] = { 0.24279078841f, 0.40000972152f }; // Lg4, Lg2
+	static constexpr float logOddCoefficients[] = { 0.28498786688f, 0.66666662693f }; // Lg3, Lg1
+
+	static constexpr float twoOverPi = 0.636619772367581343f;
+	static constexpr float pio2Part1 = 1.5703125f;
+	static constexpr float pio2Part2 = 4.837512969970703125e-4f;
+	static constexpr float pio2Part3 = 7.54978995489188216e-8f;
+	static constexpr float trigLimit = 8192.f;
+	static constexpr float trigCancellation = 1.4901161e-8f; // 2^-26, r this close to a zero loses too many bits
+	static constexpr float sinCoefficients[] = { -1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f };
+	static constexpr float cosCoefficients[] = { 2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f };
+	static constexpr float tanCoefficients[] = {
+		9.38540185543e-3f, 3.11992232697e-3f, 2.44301354525e-2f, 5.34112807005e-2f, 1.33387994085e-1f, 3.33331568548e-1f
+	};
+
+	static constexpr float powExponentLimit = 4194304.f; // 2^22, larger exponents use libm
+	static constexpr float powClamp = 160.f;
+
+	static constexpr float fastExpCoefficients[] = { 1.f / 24.f, 1.f / 6.f, 0.5f, 1.f, 1.f }; // taylor to r^4
+	static constexpr float fastLogCoefficients[] = { 0.4f, 0.666666667f, 2.f }; // 2 atanh(s) to s^5
+};
+
+template <>
+struct MathConstants<double>
+{
+	static constexpr double roundMagic = 6755399441055744.0; // 1.5 * 2^52
+	static constexpr std::uint64_t roundMagicBits = 0x4338000000000000ull;
+	static constexpr std::uint64_t exponentBias = 1023;
+
+	static constexpr double smallestNormal = 2.2250738585072014e-308;
+	static constexpr double subnormalScale = 18014398509481984.0; // 2^54
+	static constexpr double subnormalExponent = 54.0;
+	static constexpr double splitter = 134217729.0; // 2^27 + 1
+
+	static constexpr double log2e = 1.4426950408889634;
+	static constexpr double log2eLow = 2.0355273740931033e-17;
+	static constexpr double ln2 = 0.69314718055994530942;
+
+	static constexpr double expMin = -746.0;
+	static constexpr double expMax = 710.0;
+	static constexpr double expLn2High = 6.93145751953125e-1;
+	static constexpr double expLn2Low = 1.42860682030941723212e-6;
+	static constexpr double expNumerator[] = {
+		1.26177193074810590878e-4, 3.02994407707441961300e-2, 9.99999999999999999910e-1
+	};
+	static constexpr double expDenominator[] = {
+		3.00198505138664455042e-6, 2.52448340349684104192e-3, 2.27265548208155028766e-1, 2.00000000000000000009e0
+	};
+
+	static constexpr std::uint64_t logOffset = 0x00095f6200000000ull;
+	static constexpr std::uint64_t logMantissaMask = 0x000fffffffffffffull;
+	static constexpr std::uint64_t logSqrtHalfBits = 0x3fe6a09e00000000ull;
+	static constexpr double logLn2High = 6.93147180369123816490e-01;
+	static constexpr double logLn2Low = 1.90821492927058770002e-10;
+	static constexpr double logEvenCoefficients[] = {
+		1.531383769920937332e-01, 2.222219843214978396e-01, 3.999999999940941908e-01 // Lg6, Lg4, Lg2
+	};
+	static constexpr double logOddCoefficients[] = {
+		1.479819860511658591e-01, 1.818357216161805012e-01, 2.857142874366239149e-01, 6.666666666666735130e-01 // Lg7, Lg5, Lg3, Lg1
+	};
+
+	static constexpr double twoOverPi = 6.36619772367581382433e-01;
+	static constexpr double pio2Part1 = 1.57079632673412561417e+00; // 33 bits each, so q * part is exact
+	static constexpr double pio2Part2 = 6.07710050630396597660e-11;
+	static constexpr double pio2Part3 = 2.02226624871116645580e-21;
+	static constexpr double trigLimit = 823549.6; // 2^19 * pi/2
+	static constexpr double trigCancellation = 8.673617379884035e-19; // 2^-60
+	static constexpr double sinCoefficients[] = {
+		1.58969099521155010221e-10, -2.50507602534068634195e-08, 2.75573137070700676789e-06,
+		-1.98412698298579493134e-04, 8.33333333332248946124e-03, -1.66666666666666324348e-01
+	};
+	static constexpr double cosCoefficients[] = {
+		-1.13596475577881948265e-11, 2.08757232129817482790e-09, -2.75573143513906633035e-07,
+		2.48015872894767294178e-05, -1.38888888888741095749e-03, 4.16666666666666019037e-02
+	};
+	static constexpr double tanNumerator[] = {
+		-1.30936939181383777646e4, 1.15351664838587416140e6, -1.79565251976484877988e7
+	};
+	static constexpr double tanDenominator[] = {
+		1.0, 1.36812963470692954678e4, -1.32089234440210967447e6, 2.50083801823357915839e7, -5.38695755929454629881e7
+	};
+
+	static constexpr double powExponentLimit = 2251799813685248.0; // 2^51
+	static constexpr double powClamp = 1100.0;
+
+	static constexpr double fastExpCoefficients[] = { 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0 };
+	static constexpr double fastLogCoefficients[] = { 0.4, 2.0 / 3.0, 2.0 };
+};
+
+template <typename Pack, std::size_t N>
+typename Pack::Register horner(typename Pack::Register x, const typename Pack::Scalar (&coefficients)[N])
+{
+	typename Pack::Register sum = Pack::broadcast(coefficients[0]);
+	for (std::size_t i = 1; i < N; i++)
+		sum = Pack::add(Pack::multiply(sum, x), Pack::broadcast(coefficients[i]));
+
+	return sum;
+}
+
+// x rounded to the nearest integer, valid for |x| < 2^22 (float) or 2^51 (double)
+template <typename Pack>
+typename Pack::Register roundToInteger(typename Pack::Register x)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+	typename Pack::Register magic = Pack::broadcast(Constants::roundMagic);
+	return Pack::subtract(Pack::add(x, magic), magic);
+}
+
+// two's complement integer held by an integral valued x
+template <typename Pack>
+typename Pack::Bits toInteger(typename Pack::Register x)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+	return Pack::bitsSubtract(
+		Pack::toBits(Pack::add(x, Pack::broadcast(Constants::roundMagic))),
+		Pack::broadcastBits(Constants::roundMagicBits));
+}
+
+template <typename Pack>
+typename Pack::Register fromInteger(typename Pack::Bits n)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+	return Pack::subtract(
+		Pack::fromBits(Pack::bitsAdd(n, Pack::broadcastBits(Constants::roundMagicBits))),
+		Pack::broadcast(Constants::roundMagic));
+}
+
+// 2^n for integral n inside the normal exponent range
+template <typename Pack>
+typename Pack::Register exp2Integer(typename Pack::Register n)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+	return Pack::fromBits(Pack::shiftMantissaLeft(
+		Pack::bitsAdd(toInteger<Pack>(n), Pack::broadcastBits(Constants::exponentBias))));
+}
+
+// p * 2^n for integral n up to twice the exponent range, split so subnormal results still round
+template <typename Pack>
+typename Pack::Register scaleByPowerOfTwo(typename Pack::Register p, typename Pack::Register n)
+{
+	typename Pack::Register half = roundToInteger<Pack>(Pack::multiply(n, Pack::broadcast(typename Pack::Scalar(0.5))));
+	return Pack::multiply(Pack::multiply(p, exp2Integer<Pack>(half)), exp2Integer<Pack>(Pack::subtract(n, half)));
+}
+
+template <typename Pack>
+typename Pack::Mask isNan(typename Pack::Register x)
+{
+	return Pack::notEqual(x, x);
+}
+
+template <typename Pack>
+typename Pack::Mask isFinite(typename Pack::Register x)
+{
+	using Scalar = typename Pack::Scalar;
+	return Pack::less(Pack::abs(x), Pack::broadcast(std::numeric_limits<Scalar>::infinity()));
+}
+
+// recomputes the lanes selected by mask with the scalar libm function
+template <typename Pack, typename Func>
+typename Pack::Register libmLanes(typename Pack::Register result, typename Pack::Mask mask, typename Pack::Register a, Func func)
+{
+	std::uint32_t lanes = Pack::laneMask(mask);
+	if (lanes == 0)
+		return result;
+
+	alignas(64) typename Pack::Scalar in[Pack::width];
+	alignas(64) typename Pack::Scalar out[Pack::width];
+	Pack::store(in, a);
+	Pack::store(out, result);
+
+	for (std::size_t i = 0; i < Pack::width; i++)
+	{
+		if ((lanes >> i) & 1u)
+			out[i] = func(in[i]);
+	}
+
+	return Pack::load(out);
+}
+
+template <typename Pack, typename Func>
+typename Pack::Register libmLanes(typename Pack::Register result, typename Pack::Mask mask,
+	typename Pack::Register a, typename Pack::Register b, Func func)
+{
+	std::uint32_t lanes = Pack::laneMask(mask);
+	if (lanes == 0)
+		return result;
+
+	alignas(64) typename Pack::Scalar first[Pack::width];
+	alignas(64) typename Pack::Scalar second[Pack::width];
+	alignas(64) typename Pack::Scalar out[Pack::width];
+	Pack::store(first, a);
+	Pack::store(second, b);
+	Pack::store(out, result);
+
+	for (std::size_t i = 0; i < Pack::width; i++)
+	{
+		if ((lanes >> i) & 1u)
+			out[i] = func(first[i], second[i]);
+	}
+
+	return Pack::load(out);
+}
+
+// exp(r) for |r| <= ln2 / 2
+template <typename Pack>
+typename Pack::Register expReduced(typename Pack::Register r)
+{
+	using Scalar = typename Pack::Scalar;
+	using Constants = MathConstants<Scalar>;
+	using Register = typename Pack::Register;
+
+	Register one = Pack::broadcast(Scalar(1));
+	Register z = Pack::multiply(r, r);
+
+	if constexpr (std::is_same_v<Scalar, float>)
+	{
+		Register p = horner<Pack>(r, Constants::expCoefficients);
+		return Pack::add(Pack::add(Pack::multiply(p, z), r), one);
+	}
+	else
+	{
+		// Pade form: exp(r) = 1 + 2 r P(r^2) / (Q(r^2) - r P(r^2))
+		Register px = Pack::multiply(r, horner<Pack>(z, Constants::expNumerator));
+		Register q = horner<Pack>(z, Constants::expDenominator);
+		Register ratio = Pack::divide(px, Pack::subtract(q, px));
+		return Pack::add(one, Pack::add(ratio, ratio));
+	}
+}
+
+template <typename Pack>
+typename Pack::Register vectorExp(typename Pack::Register x)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+	using Register = typename Pack::Register;
+
+	// outside the clamp the result already over- or underflows
+	Register c = Pack::max(Pack::min(x, Pack::broadcast(Constants::expMax)), Pack::broadcast(Constants::expMin));
+	Register n = roundToInteger<Pack>(Pack::multiply(c, Pack::broadcast(Constants::log2e)));
+
+	Register r = Pack::subtract(c, Pack::multiply(n, Pack::broadcast(Constants::expLn2High)));
+	r = Pack::subtract(r, Pack::multiply(n, Pack::broadcast(Constants::expLn2Low)));
+
+	Register result = scaleByPowerOfTwo<Pack>(expReduced<Pack>(r), n);
+	return Pack::select(isNan<Pack>(x), x, result);
+}
+
+// splits a positive, finite x into x = 2^k * (1 + f) with 1 + f in [sqrt(1/2), sqrt(2))
+template <typename Pack>
+void logReduce(typename Pack::Register x, typename Pack::Register& k, typename Pack::Register& f)
+{
+	using Scalar = typename Pack::Scalar;
+	using Constants = MathConstants<Scalar>;
+	using Register = typename Pack::Register;
+	using Bits = typename Pack::Bits;
+
+	typename Pack::Mask subnormal = Pack::less(x, Pack::broadcast(Constants::smallestNormal));
+	x = Pack::select(subnormal, Pack::multiply(x, Pack::broadcast(Constants::subnormalScale)), x);
+
+	Bits bits = Pack::bitsAdd(Pack::toBits(x), Pack::broadcastBits(Constants::logOffset));
+	Bits exponent = Pack::bitsSubtract(Pack::shiftMantissaRight(bits), Pack::broadcastBits(Constants::exponentBias));
+	Bits mantissa = Pack::bitsAdd(
+		Pack::bitsAnd(bits, Pack::broadcastBits(Constants::logMantissaMask)),
+		Pack::broadcastBits(Constants::logSqrtHalfBits));
+
+	Register adjust = Pack::select(subnormal, Pack::broadcast(Constants::subnormalExponent), Pack::broadcast(Scalar(0)));
+	k = Pack::subtract(fromInteger<Pack>(exponent), adjust);
+	f = Pack::subtract(Pack::fromBits(mantissa), Pack::broadcast(Scalar(1)));
+}
+
+// log(1 + f) - f + f^2 / 2, the small correction term of the fdlibm log
+template <typename Pack>
+typename Pack::Register logCorrection(typename Pack::Register f, typename Pack::Register hfsq)
+{
+	using Scalar = typename Pack::Scalar;
+	using Constants = MathConstants<Scalar>;
+	using Register = typename Pack::Register;
+
+	Register s = Pack::divide(f, Pack::add(Pack::broadcast(Scalar(2)), f));
+	Register z = Pack::multiply(s, s);
+	Register w = Pack::multiply(z, z);
+	Register even = Pack::multiply(w, horner<Pack>(w, Constants::logEvenCoefficients));
+	Register odd = Pack::multiply(z, horner<Pack>(w, Constants::logOddCoefficients));
+	Register r = Pack::add(odd, even);
+
+	return Pack::subtract(Pack::multiply(s, Pack::add(hfsq, r)), hfsq);
+}
+
+template <typename Pack>
+typename Pack::Register vectorLog(typename Pack::Register x)
+{
+	using Scalar = typename Pack::Scalar;
+	using Constants = MathConstants<Scalar>;
+	using Register = typename Pack::Register;
+
+	Register k, f;
+	logReduce<Pack>(x, k, f);
+
+	Register hfsq = Pack::multiply(Pack::broadcast(Scalar(0.5)), Pack::multiply(f, f));
+	Register correction = logCorrection<Pack>(f, hfsq);
+	Register result = Pack::add(
+		Pack::add(Pack::add(correction, Pack::multiply(k, Pack::broadcast(Constants::logLn2Low))), f),
+		Pack::multiply(k, Pack::broadcast(Constants::logLn2High)));
+
+	Register infinity = Pack::broadcast(std::numeric_limits<Scalar>::infinity());
+	result = Pack::select(Pack::equal(x, infinity), infinity, result);
+	result = Pack::select(Pack::equal(x, Pack::broadcast(Scalar(0))), Pack::negate(infinity), result);
+	result = Pack::select(Pack::less(x, Pack::broadcast(Scalar(0))), Pack::broadcast(std::numeric_limits<Scalar>::quiet_NaN()), result);
+	return Pack::select(isNan<Pack>(x), x, result);
+}
+
+// x = q * pi/2 + r with |r| <= pi/4
+template <typename Pack>
+void trigReduce(typename Pack::Register x, typename Pack::Register& q, typename Pack::Register& r)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+
+	q = roundToInteger<Pack>(Pack::multiply(x, Pack::broadcast(Constants::twoOverPi)));
+	r = Pack::subtract(x, Pack::multiply(q, Pack::broadcast(Constants::pio2Part1)));
+	r = Pack::subtract(r, Pack::multiply(q, Pack::broadcast(Constants::pio2Part2)));
+	r = Pack::subtract(r, Pack::multiply(q, Pack::broadcast(Constants::pio2Part3)));
+}
+
+// lanes the reduction cannot handle: huge arguments and those so close to a multiple of pi/2
+// that the cancellation in x - q * pi/2 leaves r with only a few correct bits
+template <typename Pack>
+typename Pack::Mask trigFallback(typename Pack::Register x, typename Pack::Register r)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+	typename Pack::Register ax = Pack::abs(x);
+
+	return Pack::maskNot(Pack::maskAnd(
+		Pack::less(ax, Pack::broadcast(Constants::trigLimit)),
+		Pack::lessEqual(Pack::multiply(ax, Pack::broadcast(Constants::trigCancellation)), Pack::abs(r))));
+}
+
+template <typename Pack>
+typename Pack::Register sinReduced(typename Pack::Register r)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+	typename Pack::Register z = Pack::multiply(r, r);
+	return Pack::add(r, Pack::multiply(Pack::multiply(z, r), horner<Pack>(z, Constants::sinCoefficients)));
+}
+
+template <typename Pack>
+typename Pack::Register cosReduced(typename Pack::Register r)
+{
+	using Scalar = typename Pack::Scalar;
+	using Constants = MathConstants<Scalar>;
+	using Register = typename Pack::Register;
+
+	Register z = Pack::multiply(r, r);
+	Register tail = Pack::multiply(Pack::multiply(z, z), horner<Pack>(z, Constants::cosCoefficients));
+	Register hz = Pack::multiply(Pack::broadcast(Scalar(0.5)), z);
+	Register w = Pack::subtract(Pack::broadcast(Scalar(1)), hz);
+
+	// w + ((1 - w) - hz) keeps the rounding error of 1 - z/2
+	return Pack::add(w, Pack::add(Pack::subtract(Pack::subtract(Pack::broadcast(Scalar(1)), w), hz), tail));
+}
+
+// mask of lanes whose integral q has the given bit set
+template <typename Pack>
+typename Pack::Mask quadrantBit(typename Pack::Register q, std::uint32_t bit)
+{
+	using Scalar = typename Pack::Scalar;
+	typename Pack::Bits value = Pack::bitsAnd(toInteger<Pack>(q), Pack::broadcastBits(bit));
+	return Pack::equal(fromInteger<Pack>(value), Pack::broadcast(Scalar(bit)));
+}
+
+template <typename Pack>
+typename Pack::Register sinOrCos(typename Pack::Register x, bool cosine)
+{
+	using Scalar = typename Pack::Scalar;
+	using Register = typename Pack::Register;
+
+	Register q, r;
+	trigReduce<Pack>(x, q, r);
+
+	// cos(x) = sin(x + pi/2), so it is just one quadrant further
+	if (cosine)
+		q = Pack::add(q, Pack::broadcast(Scalar(1)));
+
+	Register s = sinReduced<Pack>(r);
+	Register c = cosReduced<Pack>(r);
+	Register result = Pack::select(quadrantBit<Pack>(q, 1), c, s);
+	result = Pack::select(quadrantBit<Pack>(q, 2), Pack::negate(result), result);
+
+	typename Pack::Mask fallback = trigFallback<Pack>(x, r);
+	if (cosine)
+		return libmLanes<Pack>(result, fallback, x, [](Scalar a) { return std::cos(a); });
+
+	return libmLanes<Pack>(result, fallback, x, [](Scalar a) { return std::sin(a); });
+}
+
+template <typename Pack>
+typename Pack::Register vectorSin(typename Pack::Register x)
+{
+	return sinOrCos<Pack>(x, false);
+}
+
+template <typename Pack>
+typename Pack::Register vectorCos(typename Pack::Register x)
+{
+	return sinOrCos<Pack>(x, true);
+}
+
+template <typename Pack>
+typename Pack::Register vectorTan(typename Pack::Register x)
+{
+	using Scalar = typename Pack::Scalar;
+	using Constants = MathConstants<Scalar>;
+	using Register = typename Pack::Register;
+
+	Register q, r;
+	trigReduce<Pack>(x, q, r);
+
+	Register z = Pack::multiply(r, r);
+	Register t;
+
+	if constexpr (std::is_same_v<Scalar, float>)
+	{
+		t = Pack::add(r, Pack::multiply(Pack::multiply(z, r), horner<Pack>(z, Constants::tanCoefficients)));
+	}
+	else
+	{
+		Register ratio = Pack::divide(horner<Pack>(z, Constants::tanNumerator), horner<Pack>(z, Constants::tanDenominator));
+		t = Pack::add(r, Pack::multiply(Pack::multiply(r, z), ratio));
+	}
+
+	// tan(r + pi/2) = -1 / tan(r)
+	Register result = Pack::select(quadrantBit<Pack>(q, 1), Pack::divide(Pack::broadcast(Scalar(-1)), t), t);
+
+	return libmLanes<Pack>(result, trigFallback<Pack>(x, r), x, [](Scalar a) { return std::tan(a); });
+}
+
+// exact product a * b = high + low, with Dekker's splitting on isas without fma
+template <typename Pack>
+void twoProduct(typename Pack::Register a, typename Pack::Register b, typename Pack::Register& high, typename Pack::Register& low)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+	using Register = typename Pack::Register;
+
+	if constexpr (Pack::hasFma)
+	{
+		high = Pack::multiply(a, b);
+		low = Pack::fma(a, b, Pack::negate(high));
+		return;
+	}
+
+	Register splitter = Pack::broadcast(Constants::splitter);
+	Register ca = Pack::multiply(a, splitter);
+	Register aHigh = Pack::subtract(ca, Pack::subtract(ca, a));
+	Register aLow = Pack::subtract(a, aHigh);
+	Register cb = Pack::multiply(b, splitter);
+	Register bHigh = Pack::subtract(cb, Pack::subtract(cb, b));
+	Register bLow = Pack::subtract(b, bHigh);
+
+	high = Pack::multiply(a, b);
+	low = Pack::subtract(Pack::multiply(aHigh, bHigh), high);
+	low = Pack::add(low, Pack::multiply(aHigh, bLow));
+	low = Pack::add(low, Pack::multiply(aLow, bHigh));
+	low = Pack::add(low, Pack::multiply(aLow, bLow));
+}
+
+// exact sum a + b = sum + error (Knuth)
+template <typename Pack>
+void twoSum(typename Pack::Register a, typename Pack::Register b, typename Pack::Register& sum, typename Pack::Register& error)
+{
+	sum = Pack::add(a, b);
+	typename Pack::Register bVirtual = Pack::subtract(sum, a);
+	typename Pack::Register aVirtual = Pack::subtract(sum, bVirtual);
+	error = Pack::add(Pack::subtract(a, aVirtual), Pack::subtract(b, bVirtual));
+}
+
+// result holds |x|^y; adds the sign for negative bases and recomputes zero, infinite and nan bases
+// and huge exponents with libm
+template <typename Pack>
+typename Pack::Register powSpecialCases(typename Pack::Register x, typename Pack::Register y, typename Pack::Register result)
+{
+	using Scalar = typename Pack::Scalar;
+	using Constants = MathConstants<Scalar>;
+	using Register = typename Pack::Register;
+	using Mask = typename Pack::Mask;
+
+	Register zero = Pack::broadcast(Scalar(0));
+
+	// negative bases only have real powers for integral exponents, odd ones keep the sign
+	Register half = Pack::multiply(y, Pack::broadcast(Scalar(0.5)));
+	Mask integral = Pack::equal(roundToInteger<Pack>(y), y);
+	Mask odd = Pack::maskAnd(integral, Pack::notEqual(roundToInteger<Pack>(half), half));
+	Register negative = Pack::select(integral,
+		Pack::select(odd, Pack::negate(result), result),
+		Pack::broadcast(std::numeric_limits<Scalar>::quiet_NaN()));
+	result = Pack::select(Pack::less(x, zero), negative, result);
+
+	Mask regular = Pack::maskAnd(
+		Pack::maskAnd(isFinite<Pack>(x), Pack::notEqual(x, zero)),
+		Pack::less(Pack::abs(y), Pack::broadcast(Constants::powExponentLimit)));
+
+	return libmLanes<Pack>(result, Pack::maskNot(regular), x, y, [](Scalar a, Scalar b) { return std::pow(a, b); });
+}
+
+template <typename Pack>
+typename Pack::Register vectorPow(typename Pack::Register x, typename Pack::Register y)
+{
+	using Scalar = typename Pack::Scalar;
+	using Constants = MathConstants<Scalar>;
+	using Register = typename Pack::Register;
+
+	Register ax = Pack::abs(x);
+
+	// log2|x| = k + (f + t) * log2(e) as an unevaluated sum high + low
+	Register k, f;
+	logReduce<Pack>(ax, k, f);
+	Register hfsq = Pack::multiply(Pack::broadcast(Scalar(0.5)), Pack::multiply(f, f));
+	Register t = logCorrection<Pack>(f, hfsq);
+
+	// ln(1 + f) = f + t, renormalized so the low part only holds rounding error
+	Register lnHigh, lnLow;
+	twoSum<Pack>(f, t, lnHigh, lnLow);
+
+	Register productHigh, productLow;
+	twoProduct<Pack>(lnHigh, Pack::broadcast(Constants::log2e), productHigh, productLow);
+	productLow = Pack::add(productLow, Pack::add(
+		Pack::multiply(lnHigh, Pack::broadcast(Constants::log2eLow)),
+		Pack::multiply(lnLow, Pack::broadcast(Constants::log2e))));
+
+	Register high, low;
+	twoSum<Pack>(k, productHigh, high, low);
+	low = Pack::add(low, productLow);
+
+	// y * log2|x| = n + r, then 2^(n + r) = 2^n * exp(r * ln2)
+	Register yHigh, yLow;
+	twoProduct<Pack>(y, high, yHigh, yLow);
+	yLow = Pack::add(yLow, Pack::multiply(y, low));
+
+	Register clamp = Pack::broadcast(Constants::powClamp);
+	yHigh = Pack::max(Pack::min(yHigh, clamp), Pack::negate(clamp));
+
+	Register n = roundToInteger<Pack>(yHigh);
+	Register r = Pack::add(Pack::subtract(yHigh, n), yLow);
+	Register result = scaleByPowerOfTwo<Pack>(expReduced<Pack>(Pack::multiply(r, Pack::broadcast(Constants::ln2))), n);
+
+	return powSpecialCases<Pack>(x, y, result);
+}
+
+// fast tier: one step reduction by ln2 and a degree 4 polynomial
+template <typename Pack>
+typename Pack::Register fastExp(typename Pack::Register x)
+{
+	using Constants = MathConstants<typename Pack::Scalar>;
+	using Register = typename Pack::Register;
+
+	Register c = Pack::max(Pack::min(x, Pack::broadcast(Constants::expMax)), Pack::broadcast(Constants::expMin));
+	Register n = roundToInteger<Pack>(Pack::multiply(c, Pack::broadcast(Constants::log2e)));
+	Register r = Pack::subtract(c, Pack::multiply(n, Pack::broadcast(Constants::ln2)));
+
+	Register result = scaleByPowerOfTwo<Pack>(horner<Pack>(r, Constants::fastExpCoefficients), n);
+	return Pack::select(isNan<Pack>(x), x, result);
+}
+
+// log(1 + f) = 2 atanh(s) with s = f / (2 + f), |s| < 0.172
+template <typename Pack>
+typename Pack::Register fastLogReduced(typename Pack::Register k, typename Pack::Register f)
+{
+	using Scalar = typename Pack::Scalar;
+	using Constants = MathConstants<Scalar>;
+	using Register = typename Pack::Register;
+
+	Register s = Pack::divide(f, Pack::add(Pack::broadcast(Scalar(2)), f));
+	Register series = Pack::multiply(s, horner<Pack>(Pack::multiply(s, s), Constants::fastLogCoefficients));
+	return Pack::add(Pack::multiply(k, Pack::broadcast(Constants::ln2)), series);
+}
+
+template <typename Pack>
+typename Pack::Register fastLog(typename Pack::Register x)
+{
+	using Scalar = typename Pack::Scalar;
+	using Register = typename Pack::Register;
+
+	Register k, f;
+	logReduce<Pack>(x, k, f);
+	Register result = fastLogReduced<Pack>(k, f);
+
+	Register infinity = Pack::broadcast(std::numeric_limits<Scalar>::infinity());
+	result = Pack::select(Pack::equal(x, infinity), infinity, result);
+	result = Pack::select(Pack::equal(x, Pack::broadcast(Scalar(0))), Pack::negate(infinity), result);
+	result = Pack::select(Pack::less(x, Pack::broadcast(Scalar(0))), Pack::broadcast(std::numeric_limits<Scalar>::quiet_NaN()), result);
+	return Pack::select(isNan<Pack>(x), x, result);
+}
+
+// exp(y log|x|) without the extra precision of vectorPow, the error grows with |y log x|
+template <typename Pack>
+typename Pack::Register fastPow(typename Pack::Register x, typename Pack::Register y)
+{
+	typename Pack::Register k, f;
+	logReduce<Pack>(Pack::abs(x), k, f);
+
+	typename Pack::Register result = fastExp<Pack>(Pack::multiply(y, fastLogReduced<Pack>(k, f)));
+	return powSpecialCases<Pack>(x, y, result);
+}
+
+template <typename Pack>
+typename Pack::Register mathRegister(MathFunction function, typename Pack::Register x, typename Pack::Register y)
+{
+	switch (function)
+	{
+	case MathFunction::Sin: return vectorSin<Pack>(x);
+	case MathFunction::Cos: return vectorCos<Pack>(x);
+	case MathFunction::Tan: return vectorTan<Pack>(x);
+	case MathFunction::Log: return vectorLog<Pack>(x);
+	case MathFunction::Exp: return vectorExp<Pack>(x);
+	case MathFunction::Sqrt: return Pack::sqrt(x);
+	case MathFunction::Pow: return vectorPow<Pack>(x, y);
+	case MathFunction::FastExp: return fastExp<Pack>(x);
+	case MathFunction::FastLog: return fastLog<Pack>(x);
+	case MathFunction::FastPow: return fastPow<Pack>(x, y);
+	}
+
+	return x;
+}
+
+template <typename Pack>
+void applyMath(MathFunction function, const typename Pack::Scalar* a, const typename Pack::Scalar* b,
+	typename Pack::Scalar* out, std::size_t count)
+{
+	using Scalar = typename Pack::Scalar;
+
+	for (std::size_t i = 0; i < count; i += Pack::width)
+	{
+		// the last partial pack is padded with ones, which is inside every domain
+		alignas(64) Scalar first[Pack::width];
+		alignas(64) Scalar second[Pack::width];
+		alignas(64) Scalar result[Pack::width];
+		std::size_t lanes = count - i < Pack::width ? count - i : Pack::width;
+
+		for (std::size_t lane = 0; lane < Pack::width; lane++)
+		{
+			first[lane] = lane < lanes ? a[i + lane] : Scalar(1);
+			second[lane] = lane < lanes && b ? b[i + lane] : Scalar(1);
+		}
+
+		Pack::store(result, mathRegister<Pack>(function, Pack::load(first), Pack::load(second)));
+		for (std::size_t lane = 0; lane < lanes; lane++)
+			out[i + lane] = result[lane];
+	}
+}
\ No newline at end of file
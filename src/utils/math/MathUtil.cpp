@@ -1,51 +1,370 @@
 #include "MathUtil.hpp"
+#include "../../parser/Domain.hpp"
+#include "../../parser/Parallel.hpp"
+#include "../../parser/VirtualMachine.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace math
 {
 	sf::Vector2f worldToScreen(const sf::Vector2f& world, const Viewport& view)
 	{
-		float x = (world.x - view.offsetX) * view.scale + view.width / 2.f;
-		float y = view.height / 2.f - (world.y - view.offsetY) * view.scale;
+		double x = (world.x - view.offsetX) * view.scale + view.width / 2.0;
+		double y = view.height / 2.0 - (world.y - view.offsetY) * view.scale;
 
-		return { x, y };
+		return { static_cast<float>(x), static_cast<float>(y) };
 	}
 
 	sf::Vector2f screenToWorld(const sf::Vector2f& screen, const Viewport& view)
 	{
-		float x = (screen.x - view.width / 2.f) / view.scale + view.offsetX;
-		float y = (view.height / 2.f - screen.y) / view.scale + view.offsetY;
+		double x = (screen.x - view.width / 2.0) / view.scale + view.offsetX;
+		double y = (view.height / 2.0 - screen.y) / view.scale + view.offsetY;
 
-		return { x, y };
+		return { static_cast<float>(x), static_cast<float>(y) };
 	}
 
-	sf::VertexArray sampleFunction(
-		const std::function<float(float)>& func,
-		const Viewport& view,
-		float step
-	)
+	namespace
 	{
-		sf::VertexArray graph(sf::PrimitiveType::LineStrip);
+		// rounding errors may grow this many ulp inside an expression before they show up as a pixel
+		constexpr double precisionHeadroom = 64.0;
+
+		// proxies span this many screen widths and stay within this many pixels of the function
+		constexpr double proxyWidths = 3.0;
+		constexpr double proxyPixels = 0.25;
+
+		// a proxy stays in use until its error reaches this many pixels
+		constexpr double proxyMaxPixels = 1.0;
+
+		// the relative error of a fast function may grow this much in the ops after it
+		constexpr double fastMathHeadroom = 4.0;
+
+		std::atomic<double> fastMathPixels = 1.0;
+
+		// samples on different pieces are only split if the gap between them is this many times the
+		// steps beside it, and at least this many pixels; where the pieces meet the gap is one step
+		constexpr double jumpSteps = 4.0;
+		constexpr double jumpPixels = 2.0;
+
+		template <typename T>
+		bool resolvesPixels(const Viewport& view)
+		{
+			double magnitude = std::max(
+				std::fabs(view.offsetX) + view.width / 2.0 / view.scale,
+				std::fabs(view.offsetY) + view.height / 2.0 / view.scale
+			);
+
+			double epsilon = static_cast<double>(std::numeric_limits<T>::epsilon());
+			return magnitude * epsilon * precisionHeadroom <= 1.0 / view.scale;
+		}
+
+		// the error is relative to the value, so the largest visible y decides how many pixels it is
+		bool fastMathResolves(const Viewport& view)
+		{
+			double magnitude = std::fabs(view.offsetY) + view.height / 2.0 / view.scale;
+			return magnitude * parser::fastMathError * fastMathHeadroom <= fastMathPixels / view.scale;
+		}
+
+		std::size_t sampleCount(const Viewport& view, double step)
+		{
+			return static_cast<std::size_t>(view.width / view.scale / step) + 1;
+		}
+
+		// the stretch of x the samples cover, for domain analysis
+		parser::Interval visibleRange(const Viewport& view, double step)
+		{
+			double left = view.offsetX - view.width / 2.0 / view.scale;
+			return { left, left + static_cast<double>(sampleCount(view, step) - 1) * step };
+		}
+
+		template <typename T>
+		struct Samples
+		{
+			std::vector<T> xs;
+			std::vector<std::size_t> runs; // first sample of every part of the domain, in increasing order
+		};
+
+		// the points of the sample grid that lie inside the domain, the grid itself does not depend on it
+		template <typename T>
+		Samples<T> samplePositions(const Viewport& view, double step, const std::vector<parser::Interval>& domain)
+		{
+			T worldLeft = static_cast<T>(view.offsetX) - static_cast<T>(view.width / 2.0 / view.scale);
+			double left = view.offsetX - view.width / 2.0 / view.scale;
+			double count = static_cast<double>(sampleCount(view, step));
+
+			Samples<T> samples;
+			for (const parser::Interval& range : domain)
+			{
+				double first = std::max(std::ceil((range.lo - left) / step), 0.0);
+				double last = std::min(std::floor((range.hi - left) / step), count - 1.0);
+				if (first > last)
+					continue;
+
+				samples.runs.push_back(samples.xs.size());
+				for (std::size_t i = static_cast<std::size_t>(first); i <= static_cast<std::size_t>(last); i++)
+					samples.xs.push_back(worldLeft + static_cast<T>(i) * static_cast<T>(step));
+			}
+
+			return samples;
+		}
+
+		// piece number of every sample, empty if the function is not piecewise
+		template <typename T>
+		std::vector<T> samplePieces(const parser::Program& pieces, const std::vector<T>& xs)
+		{
+			std::vector<T> numbers;
+			if (!pieces.code.empty())
+			{
+				numbers.resize(xs.size());
+				parser::executeBatch(pieces, xs.data(), numbers.data(), xs.size());
+			}
 
-		float worldLeft = screenToWorld({ 0.f, 0.f }, view).x;
-		float worldRight = screenToWorld({ view.width, 0.f }, view).x;
+			return numbers;
+		}
 
-		for (float x = worldLeft; x <= worldRight; x += step)
+		// the offset is subtracted in T, only the distance from the center is rounded to float. Neighbouring
+		// finite samples are joined by a line unless they lie on different parts of the domain, or on
+		// different pieces with a jump between them
+		template <typename T>
+		sf::VertexArray toGraph(const Samples<T>& samples, const T* ys, const std::vector<T>& pieces, const Viewport& view)
 		{
-			float y = func(x);
+			const std::vector<T>& xs = samples.xs;
+
+			sf::VertexArray graph(sf::PrimitiveType::Lines);
+
+			T offsetX = static_cast<T>(view.offsetX);
+			T offsetY = static_cast<T>(view.offsetY);
+
+			using std::isfinite;
 
-			if (std::isfinite(y))
+			auto screenY = [&](std::size_t i) {
+				return view.height / 2.0 - static_cast<double>(ys[i] - offsetY) * view.scale;
+			};
+
+			sf::Vertex previous;
+			std::size_t previousIndex = 0;
+			double previousStep = 0.0; // in pixels, to the sample before on the same piece
+			bool started = false;
+			std::size_t run = 0;
+
+			for (std::size_t i = 0; i < xs.size(); i++)
 			{
-				sf::Vector2f screen = worldToScreen({ x, y }, view);
+				if (run < samples.runs.size() && samples.runs[run] == i)
+				{
+					started = false;
+					run++;
+				}
+
+				bool runEnds = run < samples.runs.size() && samples.runs[run] == i + 1;
 
-				sf::Vertex vertex;
-				vertex.position = screen;
-				vertex.color = sf::Color::White;
+				if (isfinite(ys[i]))
+				{
+					double x = static_cast<double>(xs[i] - offsetX) * view.scale + view.width / 2.0;
+					double y = screenY(i);
 
-				graph.append(vertex);
+					sf::Vertex vertex;
+					vertex.position = { static_cast<float>(x), static_cast<float>(y) };
+					vertex.color = sf::Color::White;
+
+					double step = std::fabs(y - previous.position.y);
+					bool joined = started;
+					if (started && !pieces.empty() && !(pieces[i] == pieces[previousIndex]))
+					{
+						// the step after this sample, if the next one is on its piece
+						double nextStep = 0.0;
+						if (i + 1 < xs.size() && !runEnds && isfinite(ys[i + 1]) && pieces[i + 1] == pieces[i])
+							nextStep = std::fabs(screenY(i + 1) - y);
+
+						joined = step <= std::max(jumpSteps * std::max(previousStep, nextStep), jumpPixels);
+					}
+
+					if (joined)
+					{
+						graph.append(previous);
+						graph.append(vertex);
+					}
+
+					previousStep = joined ? step : 0.0;
+					previous = vertex;
+					previousIndex = i;
+					started = true;
+				}
 			}
+
+			return graph;
+		}
+
+		template <typename T>
+		sf::VertexArray sample(const parser::CompiledExpression& func, const Viewport& view, double step,
+			parser::MathTier tier = parser::MathTier::Full)
+		{
+			Samples<T> samples = samplePositions<T>(view, step, parser::definedRanges(func.tree(), visibleRange(view, step), step));
+			const std::vector<T>& xs = samples.xs;
+			std::vector<T> ys(xs.size());
+
+			// the workers share func and write disjoint parts of ys, each in its own scratch
+			std::size_t grain = parser::parallelGrain(parser::sampleCost(func.tree(), { func.tree().root }));
+			parser::parallelFor(xs.size(), grain, [&](std::size_t first, std::size_t last) {
+				if constexpr (std::is_same_v<T, float>)
+					func.evaluate(xs.data() + first, ys.data() + first, last - first, tier);
+				else
+					func.evaluate(xs.data() + first, ys.data() + first, last - first);
+			});
+
+			return toGraph(samples, ys.data(), samplePieces(func.pieces(), xs), view);
+		}
+
+		sf::VertexArray sample(const parser::ChebyshevProxy& proxy, const Viewport& view, double step)
+		{
+			Samples<double> samples = samplePositions<double>(view, step, proxy.domain());
+			const std::vector<double>& xs = samples.xs;
+			std::vector<double> ys(xs.size());
+
+			proxy.evaluate(xs.data(), ys.data(), xs.size());
+
+			return toGraph(samples, ys.data(), samplePieces(proxy.expression().pieces(), xs), view);
+		}
+
+		template <typename T>
+		std::vector<sf::VertexArray> sample(const parser::FusedPlan& plan, const Viewport& view, double step,
+			parser::MathTier tier = parser::MathTier::Full)
+		{
+			// the union of the domains, every function is evaluated at the same points
+			Samples<T> samples = samplePositions<T>(view, step,
+				parser::definedRanges(plan.tree(), plan.outputs(), visibleRange(view, step), step));
+			const std::vector<T>& xs = samples.xs;
+			std::size_t count = xs.size();
+
+			// one row of results per function
+			std::vector<T> results(plan.size() * count);
+			std::vector<T*> ys(plan.size());
+			for (std::size_t k = 0; k < plan.size(); k++)
+				ys[k] = results.data() + k * count;
+
+			std::size_t grain = parser::parallelGrain(parser::sampleCost(plan.tree(), plan.outputs()));
+			parser::parallelFor(count, grain, [&](std::size_t first, std::size_t last) {
+				std::vector<T*> rows(ys.size());
+				for (std::size_t k = 0; k < rows.size(); k++)
+					rows[k] = ys[k] + first;
+
+				if constexpr (std::is_same_v<T, float>)
+					plan.evaluate(xs.data() + first, rows.data(), last - first, tier);
+				else
+					plan.evaluate(xs.data() + first, rows.data(), last - first);
+			});
+
+			std::vector<sf::VertexArray> graphs;
+			graphs.reserve(plan.size());
+			for (std::size_t k = 0; k < plan.size(); k++)
+				graphs.push_back(toGraph(samples, ys[k], samplePieces(plan.pieces(k), xs), view));
+
+			return graphs;
+		}
+	}
+
+	parser::Precision requiredPrecision(const Viewport& view)
+	{
+		if (resolvesPixels<float>(view))
+			return parser::Precision::Float;
+
+		if (resolvesPixels<double>(view))
+			return parser::Precision::Double;
+
+		// double-double is opt in only, it costs too much to switch to on its own
+		return parser::Precision::LongDouble;
+	}
+
+	void setFastMathBound(double pixels)
+	{
+		fastMathPixels = pixels;
+	}
+
+	double fastMathBound()
+	{
+		return fastMathPixels;
+	}
+
+	parser::Precision fastPrecision(const Viewport& view)
+	{
+		if (resolvesPixels<float>(view) && fastMathResolves(view))
+			return parser::Precision::FastFloat;
+
+		return requiredPrecision(view);
+	}
+
+	sf::VertexArray sampleFunction(
+		const parser::CompiledExpression& func,
+		const Viewport& view,
+		double step,
+		parser::Precision precision
+	)
+	{
+		if (precision == parser::Precision::Auto)
+			precision = requiredPrecision(view);
+		else if (precision == parser::Precision::Fast)
+			precision = fastPrecision(view);
+
+		switch (precision)
+		{
+		case parser::Precision::FastFloat: return sample<float>(func, view, step, parser::MathTier::Fast);
+		case parser::Precision::Double: return sample<double>(func, view, step);
+		case parser::Precision::LongDouble: return sample<long double>(func, view, step);
+		case parser::Precision::DoubleDouble: return sample<parser::DoubleDouble>(func, view, step);
+		default: return sample<float>(func, view, step);
+		}
+	}
+
+	std::vector<sf::VertexArray> sampleFunctions(
+		const parser::FusedPlan& plan,
+		const Viewport& view,
+		double step,
+		parser::Precision precision
+	)
+	{
+		if (precision == parser::Precision::Auto)
+			precision = requiredPrecision(view);
+		else if (precision == parser::Precision::Fast)
+			precision = fastPrecision(view);
+
+		switch (precision)
+		{
+		case parser::Precision::FastFloat: return sample<float>(plan, view, step, parser::MathTier::Fast);
+		case parser::Precision::Double: return sample<double>(plan, view, step);
+		case parser::Precision::LongDouble: return sample<long double>(plan, view, step);
+		case parser::Precision::DoubleDouble: return sample<parser::DoubleDouble>(plan, view, step);
+		default: return sample<float>(plan, view, step);
 		}
-		
-		return graph;
+	}
+
+	std::shared_ptr<const parser::ChebyshevProxy> buildProxy(
+		std::shared_ptr<const parser::CompiledExpression> func,
+		const Viewport& view
+	)
+	{
+		double width = view.width / view.scale;
+		parser::Interval range(view.offsetX - width * proxyWidths / 2.0, view.offsetX + width * proxyWidths / 2.0);
+
+		return std::make_shared<const parser::ChebyshevProxy>(std::move(func), range, proxyPixels / view.scale);
+	}
+
+	bool proxyCovers(const parser::ChebyshevProxy& proxy, const Viewport& view)
+	{
+		double width = view.width / view.scale;
+		parser::Interval visible(view.offsetX - width / 2.0, view.offsetX + width / 2.0);
+
+		return proxy.covers(visible, proxyMaxPixels / view.scale);
+	}
+
+	sf::VertexArray sampleFunction(
+		const parser::ChebyshevProxy& proxy,
+		const Viewport& view,
+		double step
+	)
+	{
+		return sample(proxy, view, step);
 	}
 }
\ No newline at end of file
@@ -1,26 +1,71 @@
 #pragma once
 #include <SFML/Graphics.hpp>
-#include <functional>
+#include "../../parser/ChebyshevProxy.hpp"
+#include "../../parser/CompiledExpression.hpp"
+#include "../../parser/FusedPlan.hpp"
+#include "../../parser/Precision.hpp"
+#include <memory>
+#include <vector>
 
 namespace math
 {
 	struct Viewport
 	{
-		float width;
-		float height;
+		double width;
+		double height;
 
-		float scale; // zoom (pixel per unit)
-		float offsetX; // shift in world cords
-		float offsetY;
+		double scale; // zoom (pixel per unit)
+		double offsetX; // shift in world cords
+		double offsetY;
 	};
 
 	sf::Vector2f worldToScreen(const sf::Vector2f& world, const Viewport& view);
 
 	sf::Vector2f screenToWorld(const sf::Vector2f& screen, const Viewport& view);
 
+	// cheapest type that still resolves single pixels everywhere in the viewport,
+	// with some headroom for rounding errors that build up inside the expression
+	parser::Precision requiredPrecision(const Viewport& view);
+
+	// largest error in pixels the fast math tier may put into a plotted value, 1 by default
+	void setFastMathBound(double pixels);
+	double fastMathBound();
+
+	// FastFloat while the fast tier's worst case error over the visible range of y is below the bound,
+	// requiredPrecision otherwise, so zooming in switches back to the full tier
+	parser::Precision fastPrecision(const Viewport& view);
+
+	// samples and world coordinates are kept in the chosen type until they are turned into pixels;
+	// Auto resolves through requiredPrecision, Fast through fastPrecision
+	sf::VertexArray sampleFunction(
+		const parser::CompiledExpression& func,
+		const Viewport& view,
+		double step = 0.01,
+		parser::Precision precision = parser::Precision::Float
+	);
+
+	// one graph per function of the plan, every function sampled in the same pass
+	std::vector<sf::VertexArray> sampleFunctions(
+		const parser::FusedPlan& plan,
+		const Viewport& view,
+		double step = 0.01,
+		parser::Precision precision = parser::Precision::Float
+	);
+
+	// chebyshev proxy of func around the viewport: three screen widths wide and within a quarter pixel,
+	// so it lasts through panning by a screen either way and zooming in 4x
+	std::shared_ptr<const parser::ChebyshevProxy> buildProxy(
+		std::shared_ptr<const parser::CompiledExpression> func,
+		const Viewport& view
+	);
+
+	// false once the viewport has left the proxy's range, zoomed in past its tolerance or a parameter changed
+	bool proxyCovers(const parser::ChebyshevProxy& proxy, const Viewport& view);
+
+	// samples the proxy instead of its expression, in double
 	sf::VertexArray sampleFunction(
-		const std::function<float(float)>& func,
+		const parser::ChebyshevProxy& proxy,
 		const Viewport& view,
-		float step = 0.01f
+		double step = 0.01
 	);
 }
\ No newline at end of file